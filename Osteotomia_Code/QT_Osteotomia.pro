@@ -26,7 +26,7 @@ win32 {
     QMAKE_CXX = ccache g++
 
     INCLUDEPATH += /usr/local/include/opencv
-    LIBS += -L/usr/local/lib -lopencv_core -lopencv_imgcodecs -lopencv_highgui -lopencv_imgproc -lpthread
+    LIBS += -L/usr/local/lib -lopencv_core -lopencv_imgcodecs -lopencv_highgui -lopencv_imgproc -lpthread -lz
 }
 
 SOURCES += main.cpp\
@@ -42,6 +42,7 @@ SOURCES += main.cpp\
     library/base/src/huffmanTable.cpp \
     library/base/src/memory.cpp \
     library/base/src/memoryStream.cpp \
+    library/base/src/readAheadStream.cpp \
     library/base/src/stream.cpp \
     library/base/src/streamController.cpp \
     library/base/src/streamReader.cpp \
@@ -101,6 +102,13 @@ SOURCES += main.cpp\
     library/imebra/src/YBRFULLToRGB.cpp \
     library/imebra/src/YBRPARTIALToRGB.cpp \
     dicomloader.cpp \
+    asyncloader.cpp \
+    imagepyramid.cpp \
+    renderer.cpp \
+    renderworker.cpp \
+    overlay.cpp \
+    pngexporter.cpp \
+    dicomexporter.cpp \
     utils.cpp \
     layoutwindow.cpp \
     ioprocessor.cpp \
@@ -122,6 +130,7 @@ HEADERS  += mainwindow.h \
     library/base/include/memory.h \
     library/base/include/memoryStream.h \
     library/base/include/nullStream.h \
+    library/base/include/readAheadStream.h \
     library/base/include/stream.h \
     library/base/include/streamController.h \
     library/base/include/streamReader.h \
@@ -187,6 +196,13 @@ HEADERS  += mainwindow.h \
     library/imebra/include/YBRPARTIALToRGB.h \
     config.h \
     dicomloader.h \
+    asyncloader.h \
+    imagepyramid.h \
+    renderer.h \
+    renderworker.h \
+    overlay.h \
+    pngexporter.h \
+    dicomexporter.h \
     cvimagewidget.h \
     utils.h \
     layoutwindow.h \
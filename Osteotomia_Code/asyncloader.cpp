@@ -0,0 +1,204 @@
+#include "asyncloader.h"
+
+AsyncLoader::AsyncLoader(ProgressCallback progressCallback, FinishedCallback finishedCallback, PreviewCallback previewCallback, size_t cacheSize) :
+    progressCallback_(progressCallback),
+    finishedCallback_(finishedCallback),
+    previewCallback_(previewCallback),
+    previewScale_(0),
+    cacheSize_(cacheSize),
+    cachedBytes_(0),
+    hasLoad_(false),
+    working_(false),
+    generation_(0),
+    stop_(false)
+{
+    thread_ = std::thread(&AsyncLoader::run, this);
+}
+
+AsyncLoader::~AsyncLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+void AsyncLoader::load(const std::wstring& path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    // The image is already being prefetched: just wait for it
+    if(working_ && current_.prefetch && current_.path == path)
+    {
+        current_.prefetch = false;
+        current_.generation = generation_;
+        hasLoad_ = false;
+        return;
+    }
+    hasLoad_ = true;
+    loadPath_ = path;
+    condition_.notify_all();
+}
+
+void AsyncLoader::cancel()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    hasLoad_ = false;
+}
+
+void AsyncLoader::prefetch(const std::wstring& path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if((working_ && current_.path == path) || std::find(prefetchQueue_.begin(), prefetchQueue_.end(), path) != prefetchQueue_.end())
+    {
+        return;
+    }
+    for(auto& cached : cache_)
+    {
+        if(cached.first == path)
+        {
+            return;
+        }
+    }
+    prefetchQueue_.push_back(path);
+    condition_.notify_all();
+}
+
+void AsyncLoader::setPreviewScale(std::uint32_t scale)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    previewScale_ = scale;
+}
+
+bool AsyncLoader::isLoading()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hasLoad_ || (working_ && !current_.prefetch && current_.generation == generation_);
+}
+
+bool AsyncLoader::isCancelled()
+{
+    // A prefetch is cancelled by any load, a load by a newer load() or cancel()
+    return stop_ || (current_.prefetch ? hasLoad_ : current_.generation != generation_);
+}
+
+void AsyncLoader::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+        condition_.wait(lock, [this]() { return stop_ || hasLoad_ || !prefetchQueue_.empty(); });
+        if(stop_)
+        {
+            break;
+        }
+
+        if(hasLoad_)
+        {
+            current_.path = loadPath_;
+            current_.prefetch = false;
+            hasLoad_ = false;
+        }
+        else
+        {
+            current_.path = prefetchQueue_.front();
+            current_.prefetch = true;
+            prefetchQueue_.pop_front();
+        }
+        current_.generation = generation_;
+        working_ = true;
+        std::wstring path = current_.path;
+
+        std::shared_ptr<DicomImage> image = getCached(path);
+        if(!image)
+        {
+            std::uint32_t previewScale = current_.prefetch ? 0 : previewScale_;
+            lock.unlock();
+            int lastStage = -1;
+            int lastPercent = -1;
+            DicomLoader loader;
+            loader.setProgressCallback([this, &lastStage, &lastPercent](DicomLoader::Stage stage, int percent)
+            {
+                bool notify;
+                {
+                    std::lock_guard<std::mutex> guard(mutex_);
+                    if(isCancelled())
+                    {
+                        return false;
+                    }
+                    notify = !current_.prefetch;
+                }
+                // The codecs report once per row: notify only the changes
+                if(notify && (stage != lastStage || percent != lastPercent))
+                {
+                    lastStage = stage;
+                    lastPercent = percent;
+                    progressCallback_(stage, percent);
+                }
+                return true;
+            });
+            if(previewScale > 1)
+            {
+                loader.setPreviewCallback([this, &path](std::shared_ptr<DicomImage> preview)
+                {
+                    {
+                        std::lock_guard<std::mutex> guard(mutex_);
+                        if(current_.prefetch || isCancelled())
+                        {
+                            return;
+                        }
+                    }
+                    previewCallback_(path, preview);
+                }, previewScale);
+            }
+            image = loader.loadImage(path.c_str());
+            lock.lock();
+            if(image)
+            {
+                addToCache(path, image);
+            }
+        }
+
+        working_ = false;
+        if(!current_.prefetch && !isCancelled())
+        {
+            lock.unlock();
+            finishedCallback_(path, image);
+            lock.lock();
+        }
+    }
+}
+
+std::shared_ptr<DicomImage> AsyncLoader::getCached(const std::wstring& path)
+{
+    for(auto it = cache_.begin(); it != cache_.end(); ++it)
+    {
+        if(it->first == path)
+        {
+            cache_.splice(cache_.begin(), cache_, it);
+            return cache_.front().second;
+        }
+    }
+    return NULL;
+}
+
+void AsyncLoader::addToCache(const std::wstring& path, std::shared_ptr<DicomImage> image)
+{
+    size_t bytes = image->image.step * image->image.rows;
+    if(bytes > cacheSize_)
+    {
+        return;
+    }
+    cache_.push_front(std::make_pair(path, image));
+    cachedBytes_ += bytes;
+    // Drop the least recently used images
+    while(cachedBytes_ > cacheSize_)
+    {
+        const cv::Mat& dropped = cache_.back().second->image;
+        cachedBytes_ -= dropped.step * dropped.rows;
+        cache_.pop_back();
+    }
+}
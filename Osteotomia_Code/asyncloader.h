@@ -0,0 +1,77 @@
+#ifndef ASYNCLOADER_H
+#define ASYNCLOADER_H
+
+#include <thread>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <functional>
+#include <string>
+#include "dicomloader.h"
+
+// Loads the DICOM images in a background thread. A single image is loaded at a time: a new load() cancels the
+// previous one. The loaded images are kept in a cache bounded by its size in bytes, so an image that has been
+// prefetched (or loaded recently) is returned without reading it again.
+// load() can notify a reduced preview of the JPEG images that are not in the cache before their full decoding (see
+// DicomLoader::setPreviewCallback()).
+// The callbacks are called from the loading thread.
+class AsyncLoader
+{
+public:
+    typedef std::function<void(DicomLoader::Stage stage, int percent)> ProgressCallback;
+    // image is NULL when the file cannot be loaded; cancelled loadings are not notified
+    typedef std::function<void(const std::wstring& path, std::shared_ptr<DicomImage> image)> FinishedCallback;
+    // Called before FinishedCallback with the image reduced by the preview scale; the preview is not cached
+    typedef std::function<void(const std::wstring& path, std::shared_ptr<DicomImage> preview)> PreviewCallback;
+
+    AsyncLoader(ProgressCallback progressCallback, FinishedCallback finishedCallback, PreviewCallback previewCallback, size_t cacheSize);
+    ~AsyncLoader();
+    // Load an image, cancelling the one being loaded
+    void load(const std::wstring& path);
+    // Cancel the image being loaded (prefetching goes on)
+    void cancel();
+    // Load an image in the cache when the thread is idle; load() has the precedence
+    void prefetch(const std::wstring& path);
+    // Scale of the previews decoded by the next loadings (0 or 1 for none)
+    void setPreviewScale(std::uint32_t scale);
+    bool isLoading();
+
+private:
+    struct Job
+    {
+        std::wstring path;
+        bool prefetch;
+        unsigned int generation;
+    };
+
+    void run();
+    // Called with mutex_ locked
+    bool isCancelled();
+    std::shared_ptr<DicomImage> getCached(const std::wstring& path);
+    void addToCache(const std::wstring& path, std::shared_ptr<DicomImage> image);
+
+    ProgressCallback progressCallback_;
+    FinishedCallback finishedCallback_;
+    PreviewCallback previewCallback_;
+    std::uint32_t previewScale_;
+    size_t cacheSize_;
+    size_t cachedBytes_;
+    // most recently used first
+    std::list<std::pair<std::wstring, std::shared_ptr<DicomImage>>> cache_;
+    std::deque<std::wstring> prefetchQueue_;
+    bool hasLoad_;
+    std::wstring loadPath_;
+    Job current_;
+    bool working_;
+    // incremented by load() and cancel(): the loadings with an older generation are cancelled
+    unsigned int generation_;
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread thread_;
+};
+
+#endif // ASYNCLOADER_H
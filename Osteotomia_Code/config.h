@@ -17,6 +17,12 @@
 #define WEDGE_LOCATION_FACTOR 0.119
 #define WEDGE_ANGLE 0.3
 #define WARNING_LIMIT 0.2
+#define LOADER_CACHE_SIZE (512 * 1024 * 1024)
+#define PYRAMID_MIN_SIZE 256
+#define WINDOW_DEFAULT_CENTER 32768
+#define WINDOW_DEFAULT_WIDTH 65536
+#define WINDOW_STEP 64
+#define FRAME_INTERVAL 16
 
 #define SET_FILENAME "./settings.ini"
 #define SET_CLAHE_TILE_GRID_SIZE 8
@@ -34,5 +40,10 @@
 #define SET_AUTO_LINEAR_STEP 1
 #define SET_AUTO_LINEAR_SIZE 1
 #define SET_AUTO_SCALE 8
+#define SET_PREFETCH_NEXT true
+#define SET_LOAD_PREVIEW_SCALE 8
+#define SET_PNG_COMPRESSION 6
+#define SET_DICOM_PREVIEW_SIZE 1024
+#define SET_MEMORY_POOL_SIZE 256
 
 #endif // CONFIG_H
@@ -4,7 +4,9 @@
 #include <QWidget>
 #include <QImage>
 #include <QPainter>
+#include <QPaintEvent>
 #include <opencv2/opencv.hpp>
+#include "overlay.h"
 
 class CVImageWidget : public QWidget
 {
@@ -27,42 +29,43 @@ public:
         return qimage_.size();
     }
 
-public slots:
+    // Show a rendered frame (CV_8UC4, 0xffRRGGBB) without copying it: its memory must not change until the
+    // next frame is shown. The widget's size is not changed (a frame rendered before a resize can arrive after it)
+    void showFrame(const cv::Mat& frame)
+    {
+        qimage_ = QImage(frame.data, frame.cols, frame.rows, static_cast<int>(frame.step), QImage::Format_RGB32);
+        update();
+    }
 
-    void showImage(const cv::Mat& image)
+    // Annotations painted over the image: only the area covered by the old and the new ones is repainted
+    void setOverlay(const Overlay& overlay)
     {
-        // Convert the image to the RGB888 format
-        switch (image.type())
+        QRegion dirty = toQRect(overlay_.bounds()) | toQRect(overlay.bounds());
+        overlay_ = overlay;
+        if(!dirty.isEmpty())
         {
-        case CV_8UC1:
-            cv::cvtColor(image, tmp_, CV_GRAY2RGB);
-            break;
-        case CV_8UC3:
-            cv::cvtColor(image, tmp_, CV_BGR2RGB);
-            break;
-        default: assert(false && "Image type is not supported!");
+            update(dirty);
         }
-        // QImage needs the data to be stored continuously in memory
-        assert(tmp_.isContinuous());
-        // Assign OpenCV's image buffer to the QImage. Note that the bytesPerLine parameter
-        // (http://qt-project.org/doc/qt-4.8/qimage.html#QImage-6) is 3*width because each pixel
-        // has three bytes.
-        qimage_ = QImage(tmp_.data, tmp_.cols, tmp_.rows, tmp_.cols*3, QImage::Format_RGB888);
-        this->setFixedSize(image.cols, image.rows);
-        repaint();
     }
 
 protected:
-    void paintEvent(QPaintEvent* /*event*/)
+    void paintEvent(QPaintEvent* event)
     {
-        // Display the image
+        // Display the image (only the area to repaint) and the annotations over it
         QPainter painter(this);
-        painter.drawImage(QPoint(0,0), qimage_);
+        QRect rect = event->rect();
+        painter.drawImage(rect.topLeft(), qimage_, rect);
+        overlay_.paint(painter);
         painter.end();
     }
 
+    static QRect toQRect(const cv::Rect& rect)
+    {
+        return QRect(rect.x, rect.y, rect.width, rect.height);
+    }
+
     QImage qimage_;
-    cv::Mat tmp_;
+    Overlay overlay_;
 };
 
 #endif // CVIMAGEWIDGET_H
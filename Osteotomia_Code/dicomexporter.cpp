@@ -0,0 +1,350 @@
+#include "dicomexporter.h"
+#include "renderer.h"
+#include "config.h"
+#include <ctime>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+
+namespace
+{
+typedef puntoexe::ptr<puntoexe::imebra::dataSet> DataSetPtr;
+
+const wchar_t* const PRESENTATION_STATE_SOP_CLASS = L"1.2.840.10008.5.1.4.1.1.11.1";
+const wchar_t* const SECONDARY_CAPTURE_SOP_CLASS = L"1.2.840.10008.5.1.4.1.1.7";
+const wchar_t* const EXPLICIT_LITTLE_ENDIAN = L"1.2.840.10008.1.2.1";
+const wchar_t* const IMPLEMENTATION_CLASS_UID = L"2.25.195339126403787862512934165398724910113";
+// Largest angle (degrees) of the segments of the polylines that approximate the arcs
+const double ARC_STEP = 10.0;
+
+// Tags of the source copied to the exported objects (patient and study)
+const std::uint16_t COPIED_TAGS[][2] =
+{
+    {0x0008, 0x0020}, {0x0008, 0x0030}, {0x0008, 0x0050}, {0x0008, 0x0090},
+    {0x0010, 0x0010}, {0x0010, 0x0020}, {0x0010, 0x0030}, {0x0010, 0x0040},
+    {0x0020, 0x000D}, {0x0020, 0x0010}
+};
+
+// Reads the tags copied or referenced by the exported objects, stopping before the pixel data
+DataSetPtr readHeader(const std::wstring& path)
+{
+    puntoexe::imebra::codecs::parseFilter filter;
+    for(const std::uint16_t* tag : COPIED_TAGS)
+    {
+        filter.addTag(tag[0], tag[1]);
+    }
+    filter.addTag(0x0008, 0x0005) // charset
+          .addTag(0x0008, 0x0016).addTag(0x0008, 0x0018).addTag(0x0020, 0x000E) // references
+          .addTag(0x0028, 0x0004).addTag(0x0028, 0x0101).addTag(0x0028, 0x0102);
+    return DicomLoader::readHeader(path.c_str(), filter);
+}
+
+// The patient, study, series, SOP common and file meta information modules
+void setCommonModules(DataSetPtr header, DataSetPtr dataSet, const std::wstring& sopClass, const std::wstring& sopInstance,
+                      const std::wstring& seriesUid, const char* modality)
+{
+    for(const std::uint16_t* tag : COPIED_TAGS)
+    {
+        if(header->getTag(tag[0], 0, tag[1]) == 0)
+        {
+            continue;
+        }
+        dataSet->setUnicodeString(tag[0], 0, tag[1], 0, header->getUnicodeString(tag[0], 0, tag[1], 0));
+    }
+    dataSet->setUnicodeString(0x0008, 0, 0x0016, 0, sopClass);
+    dataSet->setUnicodeString(0x0008, 0, 0x0018, 0, sopInstance);
+    dataSet->setString(0x0008, 0, 0x0060, 0, modality);
+    dataSet->setString(0x0008, 0, 0x0070, 0, APP_NAME);
+    dataSet->setUnicodeString(0x0020, 0, 0x000E, 0, seriesUid);
+    dataSet->setUnsignedLong(0x0020, 0, 0x0011, 0, 1);
+    dataSet->setUnsignedLong(0x0020, 0, 0x0013, 0, 1);
+
+    std::time_t now = std::time(NULL);
+    std::tm* local = std::localtime(&now);
+    const std::uint16_t dateTags[][2] = {{0x0008, 0x0012}, {0x0008, 0x0013}, {0x0008, 0x0023}, {0x0008, 0x0033}};
+    for(const std::uint16_t* tag : dateTags)
+    {
+        dataSet->getDataHandler(tag[0], 0, tag[1], 0, true)->setDate(0, local->tm_year + 1900, local->tm_mon + 1, local->tm_mday,
+                                                                    local->tm_hour, local->tm_min, local->tm_sec, 0, 0, 0);
+    }
+
+    std::uint8_t version[] = {0, 1};
+    dataSet->getDataHandlerRaw(0x0002, 0, 0x0001, 0, true, "OB")->copyFrom(version, sizeof(version));
+    dataSet->setUnicodeString(0x0002, 0, 0x0002, 0, sopClass);
+    dataSet->setUnicodeString(0x0002, 0, 0x0003, 0, sopInstance);
+    dataSet->setUnicodeString(0x0002, 0, 0x0010, 0, EXPLICIT_LITTLE_ENDIAN);
+    dataSet->setUnicodeString(0x0002, 0, 0x0012, 0, IMPLEMENTATION_CLASS_UID);
+}
+
+// Sequence item that references the source image
+DataSetPtr imageReference(DataSetPtr header)
+{
+    DataSetPtr item(new puntoexe::imebra::dataSet);
+    item->setUnicodeString(0x0008, 0, 0x1150, 0, header->getUnicodeString(0x0008, 0, 0x0016, 0));
+    item->setUnicodeString(0x0008, 0, 0x1155, 0, header->getUnicodeString(0x0008, 0, 0x0018, 0));
+    return item;
+}
+
+void appendItem(DataSetPtr dataSet, std::uint16_t group, std::uint16_t tag, DataSetPtr item)
+{
+    dataSet->getTag(group, 0, tag, true)->appendDataSet(item);
+}
+
+void setPoints(DataSetPtr graphic, const std::vector<cv::Point2d>& points, const char* type, bool filled)
+{
+    graphic->setString(0x0070, 0, 0x0005, 0, "PIXEL");
+    graphic->setUnsignedLong(0x0070, 0, 0x0020, 0, 2);
+    graphic->setUnsignedLong(0x0070, 0, 0x0021, 0, static_cast<std::uint32_t>(points.size()));
+    for(size_t i = 0; i < points.size(); ++i)
+    {
+        graphic->setDouble(0x0070, 0, 0x0022, static_cast<std::uint32_t>(i * 2), points[i].x);
+        graphic->setDouble(0x0070, 0, 0x0022, static_cast<std::uint32_t>(i * 2 + 1), points[i].y);
+    }
+    graphic->setString(0x0070, 0, 0x0023, 0, type);
+    graphic->setString(0x0070, 0, 0x0024, 0, filled ? "Y" : "N");
+}
+
+bool writeDataSet(const std::wstring& filename, DataSetPtr dataSet)
+{
+    try
+    {
+        puntoexe::ptr<puntoexe::stream> file(new puntoexe::stream);
+        file->openFile(filename, std::ios::out);
+        puntoexe::ptr<puntoexe::streamWriter> writer(new puntoexe::streamWriter(file));
+        puntoexe::ptr<puntoexe::imebra::codecs::dicomCodec> codec(new puntoexe::imebra::codecs::dicomCodec);
+        codec->write(writer, dataSet);
+    }
+    catch(...)
+    {
+        return false;
+    }
+    return true;
+}
+}
+
+bool DicomExporter::writePresentationState(const std::wstring& filename, const DicomImage& source, const Overlay& overlay,
+                                           double windowCenter, double windowWidth)
+{
+    DataSetPtr header;
+    try
+    {
+        header = readHeader(source.path);
+    }
+    catch(...)
+    {
+        return false;
+    }
+    DataSetPtr dataSet(new puntoexe::imebra::dataSet);
+    setCommonModules(header, dataSet, PRESENTATION_STATE_SOP_CLASS, newUid(), newUid(), "PR");
+
+    // Presentation state identification
+    dataSet->setString(0x0070, 0, 0x0080, 0, "OSTEOTOMY");
+    dataSet->setString(0x0070, 0, 0x0081, 0, "Osteotomy plan");
+    dataSet->setUnicodeString(0x0070, 0, 0x0082, 0, dataSet->getUnicodeString(0x0008, 0, 0x0023, 0));
+    dataSet->setUnicodeString(0x0070, 0, 0x0083, 0, dataSet->getUnicodeString(0x0008, 0, 0x0033, 0));
+    dataSet->setString(0x0070, 0, 0x0084, 0, "");
+
+    // The source image
+    DataSetPtr series(new puntoexe::imebra::dataSet);
+    series->setUnicodeString(0x0020, 0, 0x000E, 0, header->getUnicodeString(0x0020, 0, 0x000E, 0));
+    appendItem(series, 0x0008, 0x1140, imageReference(header));
+    appendItem(dataSet, 0x0008, 0x1115, series);
+
+    // The whole frame, fitted in the viewer
+    DataSetPtr area(new puntoexe::imebra::dataSet);
+    area->setSignedLong(0x0070, 0, 0x0052, 0, 1);
+    area->setSignedLong(0x0070, 0, 0x0052, 1, 1);
+    area->setSignedLong(0x0070, 0, 0x0053, 0, source.frameSize.width);
+    area->setSignedLong(0x0070, 0, 0x0053, 1, source.frameSize.height);
+    area->setString(0x0070, 0, 0x0100, 0, "SCALE TO FIT");
+    area->setSignedLong(0x0070, 0, 0x0102, 0, 1);
+    area->setSignedLong(0x0070, 0, 0x0102, 1, 1);
+    appendItem(dataSet, 0x0070, 0x005A, area);
+
+    // The window in the stored values: convertTo16Bit() shifted them by 4 bits and inverted them (after turning
+    // MONOCHROME1 into MONOCHROME2), as DicomLoader::readAttributes() did with the window of the file
+    bool monochrome1 = (header->getUnicodeString(0x0028, 0, 0x0004, 0) == L"MONOCHROME1");
+    double center = (0xffff - windowCenter) / 16.0;
+    if(monochrome1)
+    {
+        std::uint32_t highBit = DicomLoader::getHighBit(header);
+        center = static_cast<double>((1u << (highBit + 1)) - 1) - center;
+    }
+    DataSetPtr voi(new puntoexe::imebra::dataSet);
+    voi->setDouble(0x0028, 0, 0x1050, 0, center);
+    voi->setDouble(0x0028, 0, 0x1051, 0, std::max(1.0, windowWidth / 16.0));
+    appendItem(dataSet, 0x0028, 0x3110, voi);
+    // The inversion of convertTo16Bit(): the images are shown as negatives
+    dataSet->setString(0x2050, 0, 0x0020, 0, monochrome1 ? "IDENTITY" : "INVERSE");
+
+    // The overlay's pixels are source.image's: the annotations are in the frame's pixels (their centers are at .5)
+    double scaleX = source.image.cols > 0 ? static_cast<double>(source.region.width) / source.image.cols : 1.0;
+    double scaleY = source.image.rows > 0 ? static_cast<double>(source.region.height) / source.image.rows : 1.0;
+    auto toFrame = [&](double x, double y)
+    {
+        return cv::Point2d(source.region.x + (x + 0.5) * scaleX, source.region.y + (y + 0.5) * scaleY);
+    };
+
+    // A layer for each color (the presentation state has no color per object)
+    std::map<std::vector<double>, DataSetPtr> layers;
+    for(const Overlay::Shape& shape : overlay.shapes())
+    {
+        std::vector<double> color(shape.color.val, shape.color.val + 3);
+        DataSetPtr& annotation = layers[color];
+        if(annotation == 0)
+        {
+            std::stringstream name;
+            name << "PLAN" << layers.size();
+            annotation = DataSetPtr(new puntoexe::imebra::dataSet);
+            annotation->setString(0x0070, 0, 0x0002, 0, name.str());
+
+            DataSetPtr layer(new puntoexe::imebra::dataSet);
+            layer->setString(0x0070, 0, 0x0002, 0, name.str());
+            layer->setUnsignedLong(0x0070, 0, 0x0062, 0, static_cast<std::uint32_t>(layers.size()));
+            double luminance = 0.114 * color[0] + 0.587 * color[1] + 0.299 * color[2];
+            layer->setUnsignedLong(0x0070, 0, 0x0066, 0, static_cast<std::uint32_t>(luminance * 257));
+            for(int i = 0; i < 3; ++i)
+            {
+                // RGB, the color is BGR
+                layer->setUnsignedLong(0x0070, 0, 0x0067, i, static_cast<std::uint32_t>(color[2 - i] * 257));
+            }
+            appendItem(dataSet, 0x0070, 0x0060, layer);
+            appendItem(dataSet, 0x0070, 0x0001, annotation);
+        }
+
+        DataSetPtr object(new puntoexe::imebra::dataSet);
+        std::vector<cv::Point2d> points;
+        switch(shape.type)
+        {
+            case Overlay::CIRCLE:
+                // The center and a point of the circumference
+                points.push_back(toFrame(shape.a.x, shape.a.y));
+                points.push_back(toFrame(shape.a.x + shape.radius, shape.a.y));
+                setPoints(object, points, "CIRCLE", true);
+                break;
+            case Overlay::LINE:
+                points.push_back(toFrame(shape.a.x, shape.a.y));
+                points.push_back(toFrame(shape.b.x, shape.b.y));
+                setPoints(object, points, "POLYLINE", false);
+                break;
+            case Overlay::ARC:
+            {
+                int segments = std::max(1, static_cast<int>(std::ceil(std::abs(shape.sweep) / ARC_STEP)));
+                for(int i = 0; i <= segments; ++i)
+                {
+                    // clockwise angles, as the image's rows go down
+                    double angle = (shape.start + shape.sweep * i / segments) * CV_PI / 180.0;
+                    points.push_back(toFrame(shape.a.x + shape.radius * std::cos(angle), shape.a.y + shape.radius * std::sin(angle)));
+                }
+                setPoints(object, points, "POLYLINE", false);
+            }
+            break;
+            case Overlay::TEXT:
+            {
+                int baseline = 0;
+                cv::Size size = cv::getTextSize(shape.text, cv::FONT_HERSHEY_SIMPLEX, shape.fontScale, 1, &baseline);
+                cv::Point2d topLeft(toFrame(shape.a.x, shape.a.y - size.height));
+                cv::Point2d bottomRight(toFrame(shape.a.x + size.width, shape.a.y + baseline));
+                object->setString(0x0070, 0, 0x0003, 0, "PIXEL");
+                object->setString(0x0070, 0, 0x0006, 0, shape.text);
+                object->setDouble(0x0070, 0, 0x0010, 0, topLeft.x);
+                object->setDouble(0x0070, 0, 0x0010, 1, topLeft.y);
+                object->setDouble(0x0070, 0, 0x0011, 0, bottomRight.x);
+                object->setDouble(0x0070, 0, 0x0011, 1, bottomRight.y);
+                object->setString(0x0070, 0, 0x0012, 0, "LEFT");
+            }
+            break;
+        }
+        appendItem(annotation, 0x0070, shape.type == Overlay::TEXT ? 0x0008 : 0x0009, object);
+    }
+
+    return writeDataSet(filename, dataSet);
+}
+
+bool DicomExporter::writeSecondaryCapture(const std::wstring& filename, const DicomImage& source, const cv::Mat& level,
+                                          const Overlay& overlay, double windowCenter, double windowWidth, int maxSize)
+{
+    if(level.empty() || source.image.empty() || maxSize <= 0)
+    {
+        return false;
+    }
+    DataSetPtr header;
+    try
+    {
+        header = readHeader(source.path);
+    }
+    catch(...)
+    {
+        return false;
+    }
+
+    // Rendered from the reduced level, with the annotations over it (their sizes are not reduced)
+    double scale = std::min(1.0, static_cast<double>(maxSize) / std::max(source.image.cols, source.image.rows));
+    cv::Mat preview(std::max(1, cvRound(source.image.rows * scale)), std::max(1, cvRound(source.image.cols * scale)), CV_8UC4);
+    Renderer renderer;
+    renderer.setWindow(windowCenter, windowWidth);
+    renderer.render(level, cv::Rect(0, 0, level.cols, level.rows), preview);
+    overlay.rasterize(preview, cv::Point(), static_cast<double>(preview.cols) / source.image.cols);
+
+    DataSetPtr dataSet(new puntoexe::imebra::dataSet);
+    setCommonModules(header, dataSet, SECONDARY_CAPTURE_SOP_CLASS, newUid(), newUid(), "OT");
+    dataSet->setString(0x0008, 0, 0x0064, 0, "WSD");
+    dataSet->setString(0x0008, 0, 0x2111, 0, "Osteotomy plan");
+    appendItem(dataSet, 0x0008, 0x2112, imageReference(header));
+
+    try
+    {
+        puntoexe::ptr<puntoexe::imebra::image> image(new puntoexe::imebra::image);
+        std::uint32_t rowSize, channelPixelSize, channelsNumber;
+        image->create(preview.cols, preview.rows, puntoexe::imebra::image::depthU8, L"RGB", 7);
+        puntoexe::ptr<puntoexe::imebra::handlers::dataHandlerNumericBase> handler = image->getDataHandler(true, &rowSize, &channelPixelSize, &channelsNumber);
+        std::uint8_t* pixels = handler->getMemoryBuffer();
+        for(int y = 0; y < preview.rows; ++y)
+        {
+            const std::uint8_t* in = preview.ptr<std::uint8_t>(y);
+            for(int x = 0; x < preview.cols; ++x, in += 4)
+            {
+                *pixels++ = in[2];
+                *pixels++ = in[1];
+                *pixels++ = in[0];
+            }
+        }
+        handler.release();
+        dataSet->setImage(0, image, EXPLICIT_LITTLE_ENDIAN, puntoexe::imebra::codecs::codec::veryHigh);
+    }
+    catch(...)
+    {
+        return false;
+    }
+    return writeDataSet(filename, dataSet);
+}
+
+std::wstring DicomExporter::newUid()
+{
+    static std::mutex mutex;
+    static std::mt19937_64 generator(std::random_device{}() ^ static_cast<std::uint64_t>(std::time(NULL)));
+    std::uint32_t words[4];
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(std::uint32_t& word : words)
+        {
+            word = static_cast<std::uint32_t>(generator());
+        }
+    }
+    // 128 bit number to decimal: divide the 32 bit words by 10 until they are 0
+    std::wstring digits;
+    while(words[0] != 0 || words[1] != 0 || words[2] != 0 || words[3] != 0)
+    {
+        std::uint64_t remainder = 0;
+        for(std::uint32_t& word : words)
+        {
+            std::uint64_t value = (remainder << 32) | word;
+            word = static_cast<std::uint32_t>(value / 10);
+            remainder = value % 10;
+        }
+        digits.insert(digits.begin(), static_cast<wchar_t>(L'0' + remainder));
+    }
+    return L"2.25." + (digits.empty() ? std::wstring(L"0") : digits);
+}
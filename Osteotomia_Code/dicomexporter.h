@@ -0,0 +1,30 @@
+#ifndef DICOMEXPORTER_H
+#define DICOMEXPORTER_H
+
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "dicomloader.h"
+#include "overlay.h"
+
+// Saves a plan as small DICOM objects that reference the original image instead of copying its pixels: a
+// Grayscale Softcopy Presentation State with the annotations (as graphic and text objects) and the window, and
+// optionally a reduced Secondary Capture with the annotations burned in, for viewers without GSPS support.
+// The patient, study and image references are read again from the header of the source file.
+class DicomExporter
+{
+public:
+    // overlay is in the pixels of source.image and the window in its 16bit values (as Renderer::setWindow());
+    // false if the source's header cannot be read or the file cannot be written
+    static bool writePresentationState(const std::wstring& filename, const DicomImage& source, const Overlay& overlay,
+                                       double windowCenter, double windowWidth);
+    // level is source.image or a reduction of it (e.g. a pyramid level): it is rendered through the window to fit
+    // in maxSize x maxSize pixels
+    static bool writeSecondaryCapture(const std::wstring& filename, const DicomImage& source, const cv::Mat& level,
+                                      const Overlay& overlay, double windowCenter, double windowWidth, int maxSize);
+
+private:
+    // A new UID ("2.25." and a random 128 bit number)
+    static std::wstring newUid();
+};
+
+#endif // DICOMEXPORTER_H
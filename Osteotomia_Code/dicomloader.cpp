@@ -1,6 +1,60 @@
 #include "dicomloader.h"
+#include <stdexcept>
 
-DicomLoader::DicomLoader()
+// Tags bigger than this (the pixel data) are not read by the parsing: the codecs read them from the file while
+// they decode them, and the read ahead stream reads the following blocks in the meantime
+#define LAZY_LOAD_SIZE (256 * 1024)
+
+namespace
+{
+// Forward the codec's progress to the loader, which can cancel the decoding
+class DecodeProgress : public puntoexe::imebra::codecs::decodeProgress
+{
+public:
+    DecodeProgress(std::function<bool(int)> callback) : callback_(callback) {}
+    bool onProgress(std::uint32_t done, std::uint32_t total)
+    {
+        return callback_(total == 0 ? 100 : static_cast<int>((static_cast<std::uint64_t>(done) * 100) / total));
+    }
+private:
+    std::function<bool(int)> callback_;
+};
+
+// Notify the position reached by the reads on the file (percentage of its size), which can cancel the loading
+class ReadProgressStream : public puntoexe::baseStream
+{
+public:
+    ReadProgressStream(puntoexe::ptr<puntoexe::baseStream> stream, std::uint64_t size, std::function<bool(int)> callback) :
+        stream_(stream), size_(size), callback_(callback) {}
+    void write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength)
+    {
+        stream_->write(startPosition, pBuffer, bufferLength);
+    }
+    std::uint32_t read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
+    {
+        std::uint64_t end = std::min<std::uint64_t>(startPosition + bufferLength, size_);
+        if(!callback_(static_cast<int>((end * 100) / size_)))
+        {
+            throw std::runtime_error("The loading has been cancelled");
+        }
+        return stream_->read(startPosition, pBuffer, bufferLength);
+    }
+private:
+    puntoexe::ptr<puntoexe::baseStream> stream_;
+    std::uint64_t size_;
+    std::function<bool(int)> callback_;
+};
+
+// The DCT based JPEG images skip most of the IDCT when they are decoded at a reduced scale
+bool hasReducedDecode(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet)
+{
+    std::wstring transferSyntax = dataSet->getUnicodeString(0x0002, 0, 0x0010, 0);
+    return transferSyntax == L"1.2.840.10008.1.2.4.50" || transferSyntax == L"1.2.840.10008.1.2.4.51";
+}
+}
+
+DicomLoader::DicomLoader() :
+    previewScale_(0)
 {
 	// Change max resolution to load bigger images
 	puntoexe::ptr<puntoexe::imebra::codecs::codecFactory> factory(puntoexe::imebra::codecs::codecFactory::getCodecFactory());
@@ -12,7 +66,28 @@ DicomLoader::~DicomLoader()
 
 }
 
-std::shared_ptr<DicomImage> DicomLoader::loadImage(const wchar_t* path)
+void DicomLoader::setProgressCallback(ProgressCallback callback)
+{
+    progress_ = callback;
+}
+
+void DicomLoader::setPreviewCallback(PreviewCallback callback, std::uint32_t scale)
+{
+    preview_ = callback;
+    previewScale_ = scale;
+}
+
+bool DicomLoader::progress(Stage stage, int percent)
+{
+    return !progress_ || progress_(stage, percent);
+}
+
+std::shared_ptr<DicomImage> DicomLoader::loadImage(const wchar_t* path, std::uint32_t scale)
+{
+    return loadImage(path, cv::Rect(), scale);
+}
+
+std::shared_ptr<DicomImage> DicomLoader::loadImage(const wchar_t* path, const cv::Rect& region, std::uint32_t scale)
 {
 #ifdef _MSC_VER
     std::ifstream file(path, std::ios::binary | std::ios::ate);
@@ -30,64 +105,163 @@ std::shared_ptr<DicomImage> DicomLoader::loadImage(const wchar_t* path)
     }
 
     std::streamsize size = file.tellg();
-    if(size == 0)
+    if(size <= 0)
     {
         return NULL;
     }
+    file.close();
 
-    file.seekg(0, std::ios::beg);
+    // The file is parsed while a background thread reads it in advance. The read progress is notified until the
+    // parsing ends: the codecs notify the decoding of the pixel data, read from the file at the same time
+    bool parsing = true;
+    puntoexe::ptr<puntoexe::imebra::dataSet> dataSet;
+    try
+    {
+        puntoexe::ptr<puntoexe::stream> fileStream(new puntoexe::stream);
+        fileStream->openFile(path, std::ios::in);
+        puntoexe::ptr<puntoexe::baseStream> readStream(new ReadProgressStream(
+            puntoexe::ptr<puntoexe::baseStream>(new puntoexe::readAheadStream(fileStream)), static_cast<std::uint64_t>(size),
+            [this, &parsing](int percent) { return !parsing || progress(READ, percent); }));
+        puntoexe::ptr<puntoexe::streamReader> reader(new puntoexe::streamReader(readStream));
+        dataSet = puntoexe::imebra::codecs::codecFactory::getCodecFactory()->load(reader, LAZY_LOAD_SIZE);
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+    parsing = false;
+    if(!progress(DECODE, 0))
+    {
+        return NULL;
+    }
 
-    std::vector<char> buffer(size);
-    file.read(buffer.data(), size);
+    if(preview_ && previewScale_ > 1 && scale <= 1 && region.area() == 0 && hasReducedDecode(dataSet))
+    {
+        std::shared_ptr<DicomImage> preview(new DicomImage);
+        preview->path = path;
+        try
+        {
+            if(!decodeDirect(dataSet, preview->image, previewScale_, preview->region) &&
+               !decodeModality(dataSet, preview->image, previewScale_, preview->region))
+            {
+                return NULL;
+            }
+        }
+        catch (...)
+        {
+            return NULL;
+        }
+        // A cancelled decoding or conversion leaves the image empty
+        if(preview->image.empty())
+        {
+            return NULL;
+        }
+        readAttributes(dataSet, *preview);
+        preview_(preview);
+    }
 
-    const uint8_t* bufferPointer = reinterpret_cast<const uint8_t*>(buffer.data());
-    puntoexe::ptr<puntoexe::memory> memory (new puntoexe::memory);
-    memory->assign(bufferPointer, buffer.size() & 0xFFFFFFFF);
-    puntoexe::ptr<puntoexe::memoryStream> readStream(new puntoexe::memoryStream(memory));
+	// Create DicomImage struct
+	std::shared_ptr<DicomImage> dicomImage(new DicomImage);
+	dicomImage->path = path;
 
-	puntoexe::ptr<puntoexe::streamReader> reader(new puntoexe::streamReader(readStream));
-    puntoexe::ptr<puntoexe::imebra::dataSet> dataSet;
+    // Just read the 1st image
     try
     {
-        dataSet = puntoexe::imebra::codecs::codecFactory::getCodecFactory()->load(reader);
+        if(scale == 0)
+        {
+            scale = 1;
+        }
+        dicomImage->region = region;
+        if(!decodeDirect(dataSet, dicomImage->image, scale, dicomImage->region) &&
+           !decodeModality(dataSet, dicomImage->image, scale, dicomImage->region))
+        {
+            return NULL;
+        }
     }
     catch (...)
+    {
+        // Includes the decoding cancelled by the progress callback
+        return NULL;
+    }
+    // A cancelled decoding or conversion leaves the image empty
+    if(dicomImage->image.empty() || !progress(CONVERT, 100))
     {
         return NULL;
     }
 
-    // Just read the 1st image
-    puntoexe::ptr<puntoexe::imebra::image> firstImage;
+    readAttributes(dataSet, *dicomImage);
+
+	return dicomImage;
+}
+
+std::shared_ptr<DicomImage> DicomLoader::loadHeader(const wchar_t* path)
+{
+    puntoexe::ptr<puntoexe::imebra::dataSet> dataSet;
     try
     {
-        firstImage = dataSet->getModalityImage(0);
+        puntoexe::imebra::codecs::parseFilter filter;
+        filter.addTag(0x0008, 0x0005) // charset
+              .addTag(0x0010, 0x0010).addTag(0x0010, 0x0030).addTag(0x0010, 0x0040)
+              .addTag(0x0028, 0x0004).addTag(0x0028, 0x0010).addTag(0x0028, 0x0011)
+              .addTag(0x0028, 0x0101).addTag(0x0028, 0x0102) // bits, for the window of MONOCHROME1 images
+              .addTag(0x0028, 0x1050).addTag(0x0028, 0x1051).addTag(0x0028, 0x1055); // window
+        dataSet = readHeader(path, filter);
     }
     catch (...)
     {
         return NULL;
     }
 
-	assert (firstImage.get() != NULL);
+    std::shared_ptr<DicomImage> dicomImage(new DicomImage);
+    dicomImage->path = path;
+    readAttributes(dataSet, *dicomImage);
+    return dicomImage;
+}
 
-	// Retrieve the image's size in pixels
-	std::uint32_t sizeX, sizeY;
-	firstImage->getSize(&sizeX, &sizeY);
+puntoexe::ptr<puntoexe::imebra::dataSet> DicomLoader::readHeader(const wchar_t* path, puntoexe::imebra::codecs::parseFilter& filter)
+{
+    // The file is read through the stream's small buffer: skipped tags are never read
+    puntoexe::ptr<puntoexe::stream> file(new puntoexe::stream);
+    file->openFile(path, std::ios::in);
+    puntoexe::ptr<puntoexe::streamReader> reader(new puntoexe::streamReader(file));
 
-	std::uint32_t rowSize, channelPixelSize, channelsNumber;
-	puntoexe::ptr<puntoexe::imebra::handlers::dataHandlerNumericBase> myHandler = firstImage->getDataHandler(false, &rowSize, &channelPixelSize, &channelsNumber);
+    filter.m_bStopAtPixelData = true;
+    return puntoexe::imebra::codecs::codecFactory::getCodecFactory()->load(reader, 0xffffffff, &filter);
+}
 
-	// Create DicomImage struct
-	std::shared_ptr<DicomImage> dicomImage(new DicomImage);
-	dicomImage->image = cvCreateImage(cvSize(sizeX, sizeY), IPL_DEPTH_16U, channelsNumber);
-	IplImage *img = dicomImage->image;
-	int i = 0;
+void DicomLoader::readAttributes(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet, DicomImage& dicomImage)
+{
+    dicomImage.frameSize = cv::Size(dataSet->getUnsignedLong(0x0028, 0, 0x0011, 0), dataSet->getUnsignedLong(0x0028, 0, 0x0010, 0));
+
+    // 1st VOI window of the file (a VOI LUT table has no center/width and is not used)
+    dicomImage.windowCenter = 0;
+    dicomImage.windowWidth = 0;
+    puntoexe::imebra::transforms::VOILUT voiLut(dataSet);
+    std::uint32_t voiLutId = voiLut.getVOILUTId(0);
+    if(voiLutId != 0)
+    {
+        std::int32_t center = 0, width = 0;
+        voiLut.setVOILUT(voiLutId);
+        voiLut.getCenterWidth(&center, &width);
+        if(width > 0)
+        {
+            // The values are inverted for MONOCHROME1 images and then by convertTo16Bit()
+            if(dataSet->getUnicodeString(0x0028, 0, 0x0004, 0) == L"MONOCHROME1")
+            {
+                std::uint32_t highBit = getHighBit(dataSet);
+                center = static_cast<std::int32_t>((1u << (highBit + 1)) - 1) - center;
+            }
+            dicomImage.windowCenter = 0xffff - center * 16.0;
+            dicomImage.windowWidth = width * 16.0;
+        }
+    }
 
-	dicomImage->name = dataSet->getString(0x0010, 0, 0x0010, 0);
-    dicomImage->gender = dataSet->getString(0x0010, 0, 0x0040, 0);
-	dicomImage->birthday = dataSet->getString(0x0010, 0, 0x0030, 0);
+	dicomImage.name = dataSet->getString(0x0010, 0, 0x0010, 0);
+    dicomImage.gender = dataSet->getString(0x0010, 0, 0x0040, 0);
+	dicomImage.birthday = dataSet->getString(0x0010, 0, 0x0030, 0);
 
     std::stringstream ss;
-    std::vector<std::string> strings = Utils::split(dicomImage->name, '^');
+    std::vector<std::string> strings = Utils::split(dicomImage.name, '^');
 
     //[family name; given names; middle name; prefix; suffixes.]
     //prefix
@@ -100,26 +274,160 @@ std::shared_ptr<DicomImage> DicomLoader::loadImage(const wchar_t* path)
     if(strings.size() > 0){ss << " " << strings.at(0);}
     //suffixes
     if(strings.size() > 4){ss << " " << strings.at(4);}
-    dicomImage->name = ss.str().substr(1);
-
-
-	// Scan all the rows
-	std::uint32_t index(0);
-	for(std::uint32_t scanY = 0; scanY < sizeY; ++scanY)
-	{
-		// Scan all the columns
-		for(std::uint32_t scanX = 0; scanX < sizeX; ++scanX)
-		{
-			// Scan all the channels
-			for(std::uint32_t scanChannel = 0; scanChannel < channelsNumber; ++scanChannel)
-			{
-				// Convert 12bit image to 16bit image
-				std::uint16_t channelValue = 0xffff - ((myHandler->getUnsignedLong(index++) << 4) & 0xffff);
-				img->imageData[i++] = (unsigned char) (channelValue & 0xFF);
-				img->imageData[i++] = (unsigned char) ((channelValue >> 8) & 0xFF);
-			}
-		}
-	}
+    // Files without a patient's name have no leading space to remove
+    dicomImage.name = strings.empty() ? std::string() : ss.str().substr(1);
+}
 
-	return dicomImage;
+std::uint32_t DicomLoader::getHighBit(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet)
+{
+    std::uint32_t storedBits = dataSet->getUnsignedLong(0x0028, 0, 0x0101, 0);
+    std::uint32_t highBit = dataSet->getUnsignedLong(0x0028, 0, 0x0102, 0);
+    if(storedBits != 0 && highBit < storedBits - 1)
+    {
+        highBit = storedBits - 1;
+    }
+    return highBit;
+}
+
+bool DicomLoader::decodeDirect(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet, cv::Mat& pixels, std::uint32_t scale, cv::Rect& region)
+{
+    // Only unsigned monochrome images without a modality transform can skip the imebra image:
+    // every other case needs the transforms applied by getModalityImage()
+    std::wstring colorSpace = dataSet->getUnicodeString(0x0028, 0, 0x0004, 0);
+    std::uint32_t channelsNumber = dataSet->getUnsignedLong(0x0028, 0, 0x0002, 0);
+    if(colorSpace.empty() && channelsNumber <= 1)
+    {
+        colorSpace = L"MONOCHROME2";
+        channelsNumber = 1;
+    }
+    if((colorSpace != L"MONOCHROME1" && colorSpace != L"MONOCHROME2") || channelsNumber != 1)
+    {
+        return false;
+    }
+    if(dataSet->getUnsignedLong(0x0028, 0, 0x0103, 0) != 0)
+    {
+        return false;
+    }
+
+    std::uint32_t highBit = getHighBit(dataSet);
+    if(highBit >= 16)
+    {
+        return false;
+    }
+
+    puntoexe::ptr<puntoexe::imebra::transforms::modalityVOILUT> modalityVOILUT(new puntoexe::imebra::transforms::modalityVOILUT(dataSet));
+    if(!modalityVOILUT->isEmpty())
+    {
+        return false;
+    }
+
+    std::uint32_t sizeX = dataSet->getUnsignedLong(0x0028, 0, 0x0011, 0);
+    std::uint32_t sizeY = dataSet->getUnsignedLong(0x0028, 0, 0x0010, 0);
+    if(sizeX == 0 || sizeY == 0)
+    {
+        return false;
+    }
+
+    cv::Rect scaled = scaledRegion(region, sizeX, sizeY, scale);
+    if(scaled.area() == 0)
+    {
+        return false;
+    }
+    pixels.create(scaled.height, scaled.width, CV_16UC1);
+    DecodeProgress decodeProgress([this](int percent) { return progress(DECODE, percent); });
+    dataSet->decodeImage(0, puntoexe::imebra::codecs::frameDestination(
+                             pixels.data, scaled.width, scaled.height, 1, puntoexe::imebra::image::depthU16, (std::uint32_t)pixels.step, scale)
+                         .setRegion(scaled.x, scaled.y)
+                         .setProgress(&decodeProgress));
+    region = cv::Rect(scaled.x * scale, scaled.y * scale, scaled.width * scale, scaled.height * scale) & cv::Rect(0, 0, sizeX, sizeY);
+
+    // MONOCHROME1 -> MONOCHROME2, as done by getModalityImage()
+    if(!convertTo16Bit(pixels, colorSpace == L"MONOCHROME1" ? (std::uint16_t)((1u << (highBit + 1)) - 1) : 0))
+    {
+        pixels.release();
+    }
+    return true;
+}
+
+bool DicomLoader::decodeModality(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet, cv::Mat& pixels, std::uint32_t scale, cv::Rect& region)
+{
+    // The modality transform has no progress: the stage is reported when it ends
+    puntoexe::ptr<puntoexe::imebra::image> firstImage = dataSet->getModalityImage(0);
+    if(firstImage.get() == NULL)
+    {
+        return false;
+    }
+    if(!progress(DECODE, 100))
+    {
+        return true;
+    }
+
+	// Retrieve the image's size in pixels
+	std::uint32_t sizeX, sizeY;
+	firstImage->getSize(&sizeX, &sizeY);
+
+	std::uint32_t rowSize, channelPixelSize, channelsNumber;
+	puntoexe::ptr<puntoexe::imebra::handlers::dataHandlerNumericBase> myHandler = firstImage->getDataHandler(false, &rowSize, &channelPixelSize, &channelsNumber);
+
+    cv::Rect scaled = scaledRegion(region, sizeX, sizeY, scale);
+    if(scaled.area() == 0)
+    {
+        return false;
+    }
+    region = cv::Rect(scaled.x * scale, scaled.y * scale, scaled.width * scale, scaled.height * scale) & cv::Rect(0, 0, sizeX, sizeY);
+
+    cv::Mat frame(sizeY, sizeX, CV_16UC(channelsNumber));
+    myHandler->copyTo(frame.ptr<std::uint16_t>(), sizeX * sizeY * channelsNumber);
+    if(scale > 1)
+    {
+        cv::resize(frame(region), pixels, scaled.size(), 0, 0, cv::INTER_AREA);
+    }
+    else
+    {
+        pixels = frame(region).clone();
+    }
+
+    if(!convertTo16Bit(pixels, 0))
+    {
+        pixels.release();
+    }
+    return true;
+}
+
+cv::Rect DicomLoader::scaledRegion(const cv::Rect& region, std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t scale)
+{
+    int scaledX = (int)puntoexe::imebra::codecs::frameDestination::getScaledSize(sizeX, scale);
+    int scaledY = (int)puntoexe::imebra::codecs::frameDestination::getScaledSize(sizeY, scale);
+    if(region.area() == 0)
+    {
+        return cv::Rect(0, 0, scaledX, scaledY);
+    }
+
+    // Grow the region to whole reduced pixels
+    int left = std::max(region.x, 0) / (int)scale;
+    int top = std::max(region.y, 0) / (int)scale;
+    int right = (region.x + region.width + (int)scale - 1) / (int)scale;
+    int bottom = (region.y + region.height + (int)scale - 1) / (int)scale;
+    return cv::Rect(left, top, right - left, bottom - top) & cv::Rect(0, 0, scaledX, scaledY);
+}
+
+bool DicomLoader::convertTo16Bit(cv::Mat& pixels, std::uint16_t invertMask)
+{
+    int values = pixels.cols * pixels.channels();
+    for(int y = 0; y < pixels.rows; ++y)
+    {
+        // Check for the cancellation every 64 rows
+        if((y & 63) == 0 && !progress(CONVERT, (y * 100) / pixels.rows))
+        {
+            return false;
+        }
+        std::uint16_t* row = pixels.ptr<std::uint16_t>(y);
+        for(int x = 0; x < values; ++x)
+        {
+            std::uint16_t value = invertMask != 0 ? (std::uint16_t)(invertMask - row[x]) : row[x];
+            // Convert 12bit image to 16bit image
+            row[x] = 0xffff - ((value << 4) & 0xffff);
+        }
+    }
+    return true;
 }
@@ -12,35 +12,75 @@
 #include <string>
 #include <iostream>
 #include <codecvt>
+#include <functional>
 
 
 #define MAX_IMG_WIDTH 0xFFFF
 #define MAX_IMG_HEIGHT 0xFFFF
 
 typedef struct sDicomImage {
-	IplImage *image;
+	cv::Mat image;
+	cv::Size frameSize; // size of the 1st frame, in full resolution pixels
+	cv::Rect region; // part of the 1st frame held by image, in full resolution pixels
+	std::wstring path;
 	std::string name;
     std::string gender;
 	std::string birthday;
-
-	sDicomImage()
-	{
-		image = NULL;
-	}
-	~sDicomImage()
-	{
-		if(image != NULL)
-		{
-			cvReleaseImage(&image);
-		}
-	}
+	// Window (VOI) of the file in the 16bit values of image; windowWidth is 0 when the file doesn't define it
+	double windowCenter;
+	double windowWidth;
 } DicomImage;
 
 class DicomLoader {
 public:
+    enum Stage{
+        READ,
+        DECODE,
+        CONVERT
+    };
+    // Receives the stage and its percentage (0-100) while an image is loaded; return false to cancel the loading
+    typedef std::function<bool(Stage stage, int percent)> ProgressCallback;
+
 	DicomLoader();
 	virtual ~DicomLoader();
-    std::shared_ptr<DicomImage> loadImage (const wchar_t* path);
+    // The callback is called from the thread that loads the image; a cancelled loading returns NULL
+    void setProgressCallback(ProgressCallback callback);
+    // Receives the 1st frame reduced by a scale before the full image is decoded
+    typedef std::function<void(std::shared_ptr<DicomImage> preview)> PreviewCallback;
+    // loadImage() notifies a preview reduced by scale (> 1) of the JPEG images decoded with a reduced IDCT, read
+    // from the same parsing as the full image; the other images are not faster to decode at a reduced scale
+    void setPreviewCallback(PreviewCallback callback, std::uint32_t scale);
+    // scale > 1 returns the image reduced by that factor (each pixel is the average of scale x scale pixels);
+    // JPEG images are decoded with a reduced IDCT, so use it when no full resolution image is loaded yet (e.g. a preview)
+    std::shared_ptr<DicomImage> loadImage (const wchar_t* path, std::uint32_t scale = 1);
+    // Decode only the region (full resolution pixels, aligned to scale) of the 1st frame: uncompressed images
+    // read just its rows and JPEG images skip the blocks outside it. An empty region loads the whole frame
+    std::shared_ptr<DicomImage> loadImage (const wchar_t* path, const cv::Rect& region, std::uint32_t scale = 1);
+    // Read only the patient's data and the frame size (image stays empty): the parsing skips the other tags
+    // and stops before the pixel data, so only the first few KB of the file are read (e.g. to list a folder)
+    std::shared_ptr<DicomImage> loadHeader (const wchar_t* path);
+    // Parse the tags accepted by filter, stopping before the pixel data; throws when the file cannot be read
+    static puntoexe::ptr<puntoexe::imebra::dataSet> readHeader(const wchar_t* path, puntoexe::imebra::codecs::parseFilter& filter);
+    // The high bit of the stored values: Bits Stored - 1 when it is bigger than High Bit (either can be missing)
+    static std::uint32_t getHighBit(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet);
+
+private:
+    // Notify the progress; false when the loading has been cancelled
+    bool progress(Stage stage, int percent);
+    // Decode the 1st frame straight into a CV_16UC1 matrix (no intermediate image)
+    bool decodeDirect(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet, cv::Mat& pixels, std::uint32_t scale, cv::Rect& region);
+    // Decode the 1st frame through the modality transform and copy it into a CV_16UC(n) matrix
+    bool decodeModality(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet, cv::Mat& pixels, std::uint32_t scale, cv::Rect& region);
+    // Find the requested region in the frame reduced by scale (the whole frame when the region is empty)
+    static cv::Rect scaledRegion(const cv::Rect& region, std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t scale);
+    // Fill the frame size and the patient's data (name formatted for display)
+    static void readAttributes(puntoexe::ptr<puntoexe::imebra::dataSet> dataSet, DicomImage& dicomImage);
+    // Convert the 12bit values to the inverted 16bit range used by the application
+    bool convertTo16Bit(cv::Mat& pixels, std::uint16_t invertMask);
+
+    ProgressCallback progress_;
+    PreviewCallback preview_;
+    std::uint32_t previewScale_;
 };
 
 #endif
@@ -28,7 +28,13 @@ enum Events
     HELP,
     ABOUT,
     AUTOMATIC,
-    SETTINGS
+    SETTINGS,
+    CANCEL,
+    OPEN_NEXT,
+    OPEN_PREVIOUS,
+    WINDOW,
+    WINDOW_RESET,
+    EXPORT_DICOM
 };
 
 #endif /* EVENTS_H_ */
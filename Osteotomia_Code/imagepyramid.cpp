@@ -0,0 +1,39 @@
+#include "imagepyramid.h"
+
+ImagePyramid::ImagePyramid(const cv::Mat& image, int minSize) :
+    stop_(false)
+{
+    levels_.push_back(image);
+    thread_ = std::thread(&ImagePyramid::build, this, minSize);
+}
+
+ImagePyramid::~ImagePyramid()
+{
+    stop_ = true;
+    thread_.join();
+}
+
+void ImagePyramid::build(int minSize)
+{
+    cv::Mat previous = levels_.front();
+    while(!stop_ && previous.cols / 2 >= minSize && previous.rows / 2 >= minSize)
+    {
+        cv::Mat level;
+        cv::resize(previous, level, cv::Size(previous.cols / 2, previous.rows / 2), 0, 0, cv::INTER_AREA);
+        std::lock_guard<std::mutex> lock(mutex_);
+        levels_.push_back(level);
+        previous = level;
+    }
+}
+
+cv::Mat ImagePyramid::getLevel(float factor, int& levelScale)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t level = 0;
+    while(level + 1 < levels_.size() && static_cast<float>(2 << level) <= factor)
+    {
+        ++level;
+    }
+    levelScale = 1 << level;
+    return levels_.at(level);
+}
@@ -0,0 +1,32 @@
+#ifndef IMAGEPYRAMID_H
+#define IMAGEPYRAMID_H
+
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+// Mip-mapped copies of an image: level n has 1/2^n of the size of the image (each pixel is the average of
+// 2x2 pixels of the previous level). The levels are built in a background thread; until a level is ready the
+// finer ones are used, so the image can be drawn immediately.
+class ImagePyramid
+{
+public:
+    // image is shared, not copied: it must not change while the pyramid exists
+    ImagePyramid(const cv::Mat& image, int minSize);
+    ~ImagePyramid();
+    // Coarsest ready level that still has at least one pixel per screen pixel when the image is drawn reduced
+    // by factor (image pixels per screen pixel). The level's reduction (1 << level) is returned in levelScale
+    cv::Mat getLevel(float factor, int& levelScale);
+
+private:
+    void build(int minSize);
+
+    std::vector<cv::Mat> levels_;
+    std::mutex mutex_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+#endif // IMAGEPYRAMID_H
@@ -45,11 +45,20 @@ void IOProcessor::keyPressEvent( QKeyEvent *event )
             eventCallback_(Events::ZOOM_OUT, NULL);
             break;
         case Qt::Key_Escape:
-            exit(0);
+            eventCallback_(Events::CANCEL, NULL);
+            break;
+        case Qt::Key_PageDown:
+            eventCallback_(Events::OPEN_NEXT, NULL);
+            break;
+        case Qt::Key_PageUp:
+            eventCallback_(Events::OPEN_PREVIOUS, NULL);
             break;
         case Qt::Key_C:
             eventCallback_(Events::CLEAR_POINTS, NULL);
             break;
+        case Qt::Key_R:
+            eventCallback_(Events::WINDOW_RESET, NULL);
+            break;
     }
 }
 
@@ -65,6 +74,14 @@ void IOProcessor::mouseMoveEvent(QMouseEvent *event)
         eventCallback_(Events::MOVE, static_cast<void*>(&data));
         moveOffset_ = offset;
     }
+    else if(event->buttons() & Qt::RightButton)
+    {
+        QPoint offset = event->pos();
+        QPoint move = offset - moveOffset_;
+        std::pair<int,int> delta(move.x(),move.y());
+        eventCallback_(Events::WINDOW, static_cast<void*>(&delta));
+        moveOffset_ = offset;
+    }
 }
 
 void IOProcessor::mousePressEvent(QMouseEvent *event)
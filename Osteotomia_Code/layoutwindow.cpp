@@ -27,6 +27,9 @@ void LayoutWindow::createActions(QMainWindow* window, std::function<void(Events,
     saveAct_->setShortcuts(QKeySequence::SaveAs);
     saveAct_->setStatusTip(window->tr("Save the current image"));
 
+    exportAct_ = new QAction(window->tr("Export DICOM plan..."), window);
+    exportAct_->setStatusTip(window->tr("Save the points and the window as a DICOM presentation state of the image"));
+
     exitAct_ = new QAction(window->tr("Exit"), window);
     exitAct_->setShortcuts(QKeySequence::Quit);
     exitAct_->setStatusTip(window->tr("Exit the application"));
@@ -79,6 +82,19 @@ void LayoutWindow::createActions(QMainWindow* window, std::function<void(Events,
             eventCallback(Events::SAVE_AS, static_cast<void*>(const_cast<char*>(fileName.toStdString().c_str())));
         }
     });
+    window->connect(exportAct_, &QAction::triggered, window, [window,eventCallback]()
+    {
+        QString fileName = QFileDialog::getSaveFileName(window, window->tr("Export DICOM plan"), window->tr("./"), window->tr("Dicom Files (*.dcm)"));
+        if(fileName.size() > 1)
+        {
+            if(!fileName.endsWith(window->tr(".dcm"), Qt::CaseInsensitive))
+            {
+                fileName.append(window->tr(".dcm"));
+            }
+            std::wstring filePath(fileName.toStdWString());
+            eventCallback(Events::EXPORT_DICOM, static_cast<void*>(const_cast<wchar_t*>(filePath.c_str())));
+        }
+    });
     window->connect(exitAct_, &QAction::triggered, window, []()
     {
         exit(0);
@@ -132,6 +148,7 @@ void LayoutWindow::createMenus(QMainWindow* window)
 
     fileMenu_->addAction(openAct_);
     fileMenu_->addAction(saveAct_);
+    fileMenu_->addAction(exportAct_);
     fileMenu_->addSeparator();
     fileMenu_->addAction(exitAct_);
 
@@ -152,6 +169,7 @@ void LayoutWindow::createMenus(QMainWindow* window)
 void LayoutWindow::setEnabled(bool value)
 {
     saveAct_->setEnabled(value);
+    exportAct_->setEnabled(value);
     centerAct_->setEnabled(value);
     clearAct_->setEnabled(value);
     calcAct_->setEnabled(value);
@@ -23,6 +23,7 @@ private:
     QMenu *fileMenu_;
     QAction *openAct_;
     QAction *saveAct_;
+    QAction *exportAct_;
     QAction *exitAct_;
 
     QMenu *editMenu_;
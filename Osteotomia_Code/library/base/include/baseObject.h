@@ -59,6 +59,7 @@ The author can be contacted by email at info@binarno.com or by mail at
 #include <string>
 #include <memory>
 #include <atomic>
+#include <type_traits>
 
 ///////////////////////////////////////////////////////////
 /// \namespace puntoexe
@@ -132,6 +133,19 @@ public:
 protected:
 	void addRef();
 
+	// Take the object tracked by source without changing its
+	//  reference counter: source is left empty.
+	// Static, so a ptr can take the object of a ptr to a
+	//  different class.
+	//
+	///////////////////////////////////////////////////////////
+	static baseObject* detach(basePtr& source)
+	{
+		baseObject* pObject = source.object;
+		source.object = 0;
+		return pObject;
+	}
+
 	// A pointer to the tracked object
 	///////////////////////////////////////////////////////////
 	baseObject* object;
@@ -202,6 +216,38 @@ public:
 	{
 	}
 
+	/// \brief Move constructor.
+	///
+	/// The object tracked by another ptr is moved into the
+	///  current ptr: the reference counter is not changed
+	///  and the source ptr is left empty.
+	///
+	/// @param ptrSource  the source ptr object that must be
+	///                    moved into the current \ref ptr.
+	///
+	///////////////////////////////////////////////////////////
+	ptr (ptr<objectType>&& ptrSource)
+	{
+		object = detach(ptrSource);
+	}
+
+	/// \brief Move constructor from a ptr to a derived
+	///         class.
+	///
+	/// Used when a function returning a ptr to a derived
+	///  class initializes a ptr to its base class: the
+	///  reference counter is not changed.
+	///
+	/// @param ptrSource  the source ptr object that must be
+	///                    moved into the current \ref ptr.
+	///
+	///////////////////////////////////////////////////////////
+	template <class sourceType, class = typename std::enable_if<std::is_convertible<sourceType*, objectType*>::value>::type>
+		ptr (ptr<sourceType>&& ptrSource)
+	{
+		object = detach(ptrSource);
+	}
+
 	/// \brief Copy the object tracked by another
 	///         \ref ptr.
 	///
@@ -226,6 +272,29 @@ public:
 		return *this;
 	}
 
+	/// \brief Move the object tracked by another
+	///         \ref ptr.
+	///
+	/// @param ptrSource the ptr object that is
+	///         currently tracking the object to be tracked
+	///         by this ptr object.
+	///        The reference counter of the new object is
+	///         not changed and ptrSource is left empty.
+	///        The object previously tracked by this ptr is
+	///         released.
+	/// @return a reference to the ptr object.
+	///
+	///////////////////////////////////////////////////////////
+	ptr<objectType>& operator=(ptr<objectType>&& ptrSource)
+	{
+		if(&ptrSource != this)
+		{
+			release();
+			object = detach(ptrSource);
+		}
+		return *this;
+	}
+
 	/// \brief Compare the pointer to the tracked object with
 	///         the pointer specified in the parameter.
 	///
@@ -386,6 +455,9 @@ public:
 	///  derived from baseObject should be assigned to a
 	///  \ref ptr object.
 	///
+	/// The external object's critical section is created
+	///  (if it doesn't exist yet) and shared with this object.
+	///
 	/// @param externalLock a pointer to the object to use
 	///                      to lock this one
 	///
@@ -473,9 +545,20 @@ private:
             void addRef(){++m_counter;}
             void release(){if(--m_counter == 0)delete this;}
         private:
-            unsigned long m_counter;
+            std::atomic<unsigned long> m_counter;
         };
-        CObjectCriticalSection* m_pCriticalSection;
+
+	/// \brief Returns the critical section used to lock the
+	///         object, allocating it the first time.
+	///
+	/// Most objects (memory, handlers, streams) are never
+	///  locked: they are built without allocating a critical
+	///  section.
+	///
+	///////////////////////////////////////////////////////////
+	CObjectCriticalSection* getCriticalSection();
+
+	std::atomic<CObjectCriticalSection*> m_pCriticalSection;
 
 };
 
@@ -116,7 +116,7 @@ public:
 	///                        buffer that has to be written
 	///
 	///////////////////////////////////////////////////////////
-	virtual void write(std::uint32_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength) = 0;
+	virtual void write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength) = 0;
 	
 	/// \brief Read raw data from the stream.
 	///
@@ -135,7 +135,7 @@ public:
 	///          reached
 	///
 	///////////////////////////////////////////////////////////
-	virtual std::uint32_t read(std::uint32_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength) = 0;
+	virtual std::uint32_t read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength) = 0;
 };
 
 
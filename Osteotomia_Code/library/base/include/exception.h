@@ -159,10 +159,21 @@ public:
 ///  exceptionsManager::getMessage() to empty the
 ///  messages stack.
 ///
+/// Each thread stores its information in its own list,
+///  so the threads don't have to synchronize while the
+///  exceptions are being thrown.
+/// The list keeps only the last
+///  IMEBRA_EXCEPTIONS_INFO_MAX_SIZE objects, so it stays
+///  small also when nobody retrieves the messages.
+///
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 class exceptionsManager: public baseObject
 {
+#if(!defined IMEBRA_EXCEPTIONS_INFO_MAX_SIZE)
+	#define IMEBRA_EXCEPTIONS_INFO_MAX_SIZE 64
+#endif
+
 public:
 	/// \brief Add an exceptionInfo object to the active
 	///         thread's information list.
@@ -218,9 +229,7 @@ public:
 	static ptr<exceptionsManager> getExceptionsManager();
 
 protected:
-    typedef std::map<std::thread::id, tExceptionInfoList> tInfoMap;
-
-	tInfoMap m_information;
+	class threadInformation;
 
 public:
 	// Force the construction of the exceptions manager before
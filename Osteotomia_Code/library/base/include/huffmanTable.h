@@ -82,6 +82,10 @@ class streamWriter;
 ///////////////////////////////////////////////////////////
 class huffmanTable: public baseObject
 {
+#if(!defined IMEBRA_HUFFMAN_LOOKUP_BITS)
+	#define IMEBRA_HUFFMAN_LOOKUP_BITS 9
+#endif
+
 public:
 	///////////////////////////////////////////////////////////
 	/// \name Initialization
@@ -97,9 +101,17 @@ public:
 	///                        the value that must be encoded.
 	///                       Please note that this is not
 	///                        the length of the huffman values
+	/// @param amplitudeLengthMask the mask that, applied to
+	///                        a decoded value, returns the
+	///                        number of bits of the amplitude
+	///                        that follows the huffman code
+	///                        (0x1f for the jpeg DC tables,
+	///                        0x0f for the jpeg AC tables).
+	///                       Used by
+	///                        readHuffmanCode(streamReader*, std::int32_t*)
 	///
 	///////////////////////////////////////////////////////////
-	huffmanTable(std::uint32_t maxValueLength);
+	huffmanTable(std::uint32_t maxValueLength, std::uint32_t amplitudeLengthMask = 0);
 
 	/// \brief Reset the internal data of the huffmanTable
 	///         class.
@@ -171,6 +183,11 @@ public:
 	///  calcHuffmanCodesLength(): it will not work if the
 	///  code lengths are not available.
 	///
+	/// The function also builds the lookup table that
+	///  decodes the codes shorter than
+	///  IMEBRA_HUFFMAN_LOOKUP_BITS bits with a single
+	///  access.
+	///
 	///////////////////////////////////////////////////////////
 	void calcHuffmanTables();
 	
@@ -217,6 +234,32 @@ public:
 	///////////////////////////////////////////////////////////
 	std::uint32_t readHuffmanCode(streamReader* pStream);
 
+	/// \brief Read and decode an huffman code and the
+	///         amplitude that follows it, as in the jpeg
+	///         DC and AC tables.
+	///
+	/// The number of bits of the amplitude is the decoded
+	///  value masked by the amplitudeLengthMask specified
+	///  in the constructor.
+	///
+	/// When the code and the amplitude fit in
+	///  IMEBRA_HUFFMAN_LOOKUP_BITS bits then both are
+	///  decoded by the lookup table.
+	///
+	/// The function throws a huffmanExceptionRead exception
+	///  if the read code cannot be decoded.
+	///
+	/// @param pStream    a pointer to the stream reader used
+	///                    to read the code
+	/// @param pAmplitude a pointer to a variable that is
+	///                    filled with the signed amplitude,
+	///                    or with 0 if the code is not
+	///                    followed by an amplitude
+	/// @return the decoded value
+	///
+	///////////////////////////////////////////////////////////
+	std::uint32_t readHuffmanCode(streamReader* pStream, std::int32_t* pAmplitude);
+
 	/// \brief Write an huffman code to the specified stream.
 	///
 	/// The function throws a huffmanExceptionWrite exception
@@ -233,6 +276,12 @@ public:
 	//@}
 
 protected:
+	/// \brief Read the codes longer than
+	///         IMEBRA_HUFFMAN_LOOKUP_BITS bits.
+	///
+	///////////////////////////////////////////////////////////
+	std::uint32_t readLongHuffmanCode(streamReader* pStream);
+
 	class valueObject
 	{
 	public:
@@ -278,6 +327,7 @@ protected:
 	};
 
 	std::uint32_t m_numValues;
+	std::uint32_t m_amplitudeLengthMask;
 
 	// Values' frequency
 	std::vector<valueObject> m_valuesFreq;
@@ -287,12 +337,27 @@ private:
 	std::vector<std::uint32_t> m_orderedValues;
     std::array<std::uint32_t, 128> m_valuesPerLength;
     std::uint8_t m_firstValidLength;
-    std::uint32_t m_firstMinValue;
-    std::uint32_t m_firstMaxValue;
-    std::uint32_t m_firstValuesPerLength;
     std::uint32_t m_minValuePerLength[128];
     std::uint32_t m_maxValuePerLength[128];
 
+    // Number of values with a code not longer than
+    //  IMEBRA_HUFFMAN_LOOKUP_BITS
+    std::uint32_t m_lookupValuesCount;
+
+    // Lookup table, indexed by the next
+    //  IMEBRA_HUFFMAN_LOOKUP_BITS bits in the stream.
+    // m_length is 0 when the code is longer than the index
+    //  and m_amplitudeLength is 0 when the code plus its
+    //  amplitude are longer than the index
+    struct lookupEntry
+    {
+        std::uint16_t m_value;
+        std::uint8_t m_length;
+        std::uint8_t m_amplitudeLength;
+        std::int16_t m_amplitude;
+    };
+    std::array<lookupEntry, (1 << IMEBRA_HUFFMAN_LOOKUP_BITS)> m_lookupTable;
+
 	// Final huffman table
 	std::vector<std::uint32_t> m_valuesToHuffman;
 	std::vector<std::uint32_t> m_valuesToHuffmanLength;
@@ -59,6 +59,8 @@ The author can be contacted by email at info@binarno.com or by mail at
 #include <map>
 #include <memory>
 #include <array>
+#include <deque>
+#include <atomic>
 
 ///////////////////////////////////////////////////////////
 //
@@ -116,7 +118,7 @@ public:
 	///                      memory, in bytes
 	///
 	///////////////////////////////////////////////////////////
-	memory(std::uint32_t initialSize);
+	memory(size_t initialSize);
 
     /// \brief Destruct the memory object.
     ///
@@ -160,7 +162,7 @@ public:
 	/// @param newSize  the new size of the buffer, in bytes
 	///
 	///////////////////////////////////////////////////////////
-	void resize(std::uint32_t newSize);
+	void resize(size_t newSize);
 
 	/// \brief Reserve the specified quantity of bytes for
 	///         the memory object. This doesn't modify the
@@ -170,7 +172,7 @@ public:
 	///                       the memory object.
 	///
 	///////////////////////////////////////////////////////////
-	void reserve(std::uint32_t reserveSize);
+	void reserve(size_t reserveSize);
 
 	/// \brief Return the size of the managed
 	///         memory in bytes.
@@ -178,7 +180,7 @@ public:
 	/// @return the size of the managed memory, in bytes
 	///
 	///////////////////////////////////////////////////////////
-	std::uint32_t size();
+	size_t size();
 
 	/// \brief Return a pointer to the memory managed by the
 	///         object.
@@ -207,7 +209,7 @@ public:
 	///                      into the managed memory
 	///
 	///////////////////////////////////////////////////////////
-	void assign(const std::uint8_t* pSource, const std::uint32_t sourceLength);
+	void assign(const std::uint8_t* pSource, const size_t sourceLength);
 
 protected:
     std::unique_ptr<stringUint8> m_pMemoryBuffer;
@@ -236,9 +238,16 @@ protected:
 ///  pool and reused when a request for a \ref memory
 ///  object is received.
 ///
-/// The memory pool tries to reuse the \ref memory
-///  object that manages an amount of memory similar to
-///  the amount of memory requested through getMemory().
+/// The unused buffers are grouped in power of two size
+///  classes: a request is served by a buffer of the same
+///  class that is big enough to hold the requested
+///  size.
+///
+/// Each thread keeps the small buffers it releases in
+///  its own cache, which is accessed without locking;
+///  the bigger buffers (and the small ones that don't fit
+///  in the thread's cache) are stored in a pool shared
+///  by all the threads.
 ///
 /// When a memory object is not used for a while then it
 ///  is deleted permanently.
@@ -257,16 +266,54 @@ protected:
 #if(!defined IMEBRA_MEMORY_POOL_MIN_SIZE)
 	#define IMEBRA_MEMORY_POOL_MIN_SIZE 1024
 #endif
+#if(!defined IMEBRA_MEMORY_POOL_THREAD_CACHE_SIZE)
+	#define IMEBRA_MEMORY_POOL_THREAD_CACHE_SIZE 2097152
+#endif
 
-    std::array<std::uint32_t, IMEBRA_MEMORY_POOL_SLOTS> m_memorySize;
-    std::array<stringUint8*, IMEBRA_MEMORY_POOL_SLOTS>  m_memoryPointer;
-	std::uint32_t m_firstUsedCell;
-	std::uint32_t m_firstFreeCell;
+	// One size class for each power of two that fits in
+	//  32 bits
+	///////////////////////////////////////////////////////////
+	static const size_t m_sizeClasses = 32;
 
-	std::uint32_t m_actualSize;
+	// A buffer stored in the shared pool. m_age orders the
+	//  buffers of all the classes, so the oldest one can
+	//  be deleted first
+	///////////////////////////////////////////////////////////
+	struct pooledBuffer
+	{
+		stringUint8* m_pBuffer;
+		std::uint64_t m_age;
+	};
+
+	// The unused buffers of the shared pool, by size class.
+	// The oldest buffers are at the front
+	///////////////////////////////////////////////////////////
+	std::array<std::deque<pooledBuffer>, m_sizeClasses> m_sharedPool;
+	size_t m_buffersCount;
+	size_t m_actualSize;
+	size_t m_maxSize;
+	std::uint64_t m_age;
+
+	// The cache of the calling thread
+	///////////////////////////////////////////////////////////
+	class threadCache;
 
 public:
-	memoryPool(): m_actualSize(0){}
+	/// \brief Counters of the memory pool's activity,
+	///         returned by getStatistics().
+	///
+	///////////////////////////////////////////////////////////
+	struct statistics
+	{
+		std::uint64_t m_hits;        ///< requests served with an unused buffer
+		std::uint64_t m_threadHits;  ///< hits served by the calling thread's cache
+		std::uint64_t m_misses;      ///< requests that allocated a new buffer
+		std::uint64_t m_kept;        ///< released buffers stored for reuse
+		std::uint64_t m_discarded;   ///< released buffers deleted immediately
+		size_t m_sharedPoolSize;     ///< bytes currently held by the shared pool
+	};
+
+	memoryPool();
 
 	virtual ~memoryPool();
 
@@ -274,12 +321,12 @@ public:
 	///         \ref puntoexe::memory object.
 	///
 	/// The function look for an unused \ref memory object
-	///  that has a managed string with the same size of the
-	///  specified one and tries to reuse it.
+	///  in the size class of the specified size, first in
+	///  the calling thread's cache and then in the shared
+	///  pool, and tries to reuse it.
 	///
-	/// If none of the unused objects has the requested
-	///  size, then a new memory object is created and 
-	///  returned.
+	/// If none of the unused objects is big enough, then a
+	///  new memory object is created and returned.
 	///
 	/// @param requestedSize the size that the string managed
 	///                       by the returned memory object
@@ -292,11 +339,36 @@ public:
 	///////////////////////////////////////////////////////////
 	memory* getMemory(std::uint32_t requestedSize);
 
-	/// \brief Discard all the currently unused memory.
+	/// \brief Discard all the currently unused memory held
+	///         by the shared pool and by the calling
+	///         thread's cache.
 	///
 	///////////////////////////////////////////////////////////
 	void flush();
 
+	/// \brief Set the maximum amount of unused memory kept
+	///         by the shared pool.
+	///
+	/// Buffers bigger than the limit are never kept; raise
+	///  it to reuse the buffers of big images when the same
+	///  or similar images are loaded again.
+	///
+	/// The default value is IMEBRA_MEMORY_POOL_MAX_SIZE.
+	///
+	/// @param maxSize the maximum amount of unused memory,
+	///                 in bytes
+	///
+	///////////////////////////////////////////////////////////
+	void setMaxSize(size_t maxSize);
+
+	/// \brief Return the counters of the pool's activity
+	///         since the application started.
+	///
+	/// @return the pool's statistics
+	///
+	///////////////////////////////////////////////////////////
+	statistics getStatistics();
+
 	/// \brief Get a pointer to the statically allocated 
 	///         instance of memoryPool.
 	///
@@ -324,8 +396,30 @@ protected:
 	///////////////////////////////////////////////////////////
     bool reuseMemory(stringUint8* pMemoryToReuse);
 
+	// Store a buffer in the shared pool, deleting the oldest
+	//  ones if the pool grows too big.
+	// Takes ownership of the buffer
+	///////////////////////////////////////////////////////////
+	bool storeShared(stringUint8* pBuffer);
+
+	// Take from the shared pool a buffer able to hold the
+	//  requested size, or return 0
+	///////////////////////////////////////////////////////////
+	stringUint8* takeShared(std::uint32_t requestedSize);
+
+	// Delete the oldest buffer of the shared pool.
+	// Must be called with m_criticalSection locked
+	///////////////////////////////////////////////////////////
+	void deleteOldest();
+
 	criticalSection m_criticalSection;
 
+	std::atomic<std::uint64_t> m_hits;
+	std::atomic<std::uint64_t> m_threadHits;
+	std::atomic<std::uint64_t> m_misses;
+	std::atomic<std::uint64_t> m_kept;
+	std::atomic<std::uint64_t> m_discarded;
+
 };
 
 ///@}
@@ -99,13 +99,62 @@ public:
 	// Virtual stream's functions
 	//
 	///////////////////////////////////////////////////////////
-	virtual void write(std::uint32_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength);
-	virtual std::uint32_t read(std::uint32_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength);
+	virtual void write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength);
+	virtual std::uint32_t read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength);
 
 protected:
 	ptr<memory> m_memory;
 };
 
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+/// \brief This class derives from the baseStream
+///         class and implements a read only memory
+///         stream.
+///
+/// The content and the size of the attached memory object
+///  must not change while the stream exists: read() does
+///  not lock the stream, so several threads can read the
+///  same memory at the same time (e.g. through the
+///  streamReader objects returned by
+///  streamReader::getReader()).
+///
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+class readOnlyMemoryStream : public baseStream
+{
+
+public:
+	/// \brief Construct a readOnlyMemoryStream object and
+	///         attach a memory object to it.
+	///
+	/// @param memoryStream the memory object to be read by
+	///                      the readOnlyMemoryStream object.
+	///                     Its content must not be modified
+	///                      while it is attached to the
+	///                      stream
+	///
+	///////////////////////////////////////////////////////////
+	readOnlyMemoryStream(ptr<memory> memoryStream);
+
+	///////////////////////////////////////////////////////////
+	//
+	// Virtual stream's functions
+	//
+	///////////////////////////////////////////////////////////
+	virtual void write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength);
+	virtual std::uint32_t read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength);
+
+protected:
+	ptr<memory> m_memory;
+
+	// Cached when the stream is constructed
+	///////////////////////////////////////////////////////////
+	const std::uint8_t* const m_pData;
+	const std::uint64_t m_size;
+};
+
 ///@}
 
 } // namespace puntoexe
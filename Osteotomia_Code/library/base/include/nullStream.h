@@ -89,8 +89,8 @@ public:
 	// Virtual stream's functions
 	//
 	///////////////////////////////////////////////////////////
-	virtual void write(std::uint32_t, const std::uint8_t*, std::uint32_t){}
-	virtual std::uint32_t read(std::uint32_t , std::uint8_t* , std::uint32_t ){return 0;}
+	virtual void write(std::uint64_t, const std::uint8_t*, std::uint32_t){}
+	virtual std::uint32_t read(std::uint64_t , std::uint8_t* , std::uint32_t ){return 0;}
 };
 
 ///@}
@@ -0,0 +1,190 @@
+/*
+
+Imebra community build 20151130-002
+
+Imebra: a C++ Dicom library
+
+Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012, 2013, 2014, 2015
+by Paolo Brandoli/Binarno s.p.
+
+All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as published by
+ the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+-------------------
+
+If you want to use Imebra commercially then you have to buy the commercial
+ license available at http://imebra.com
+
+After you buy the commercial license then you can use Imebra according
+ to the terms described in the Imebra Commercial License Version 2.
+A copy of the Imebra Commercial License Version 2 is available in the
+ documentation pages.
+
+Imebra is available at http://imebra.com
+
+The author can be contacted by email at info@binarno.com or by mail at
+ the following address:
+ Binarno s.p., Paolo Brandoli
+ Rakuseva 14
+ 1000 Ljubljana
+ Slovenia
+
+
+
+*/
+
+/*! \file readAheadStream.h
+    \brief Declaration of the readAheadStream class.
+
+*/
+
+#if !defined(imebraReadAheadStream_6A0B2C0E_3F4D_4C51_9E2B_7D1A5F8C4E93__INCLUDED_)
+#define imebraReadAheadStream_6A0B2C0E_3F4D_4C51_9E2B_7D1A5F8C4E93__INCLUDED_
+
+#include "baseStream.h"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+///////////////////////////////////////////////////////////
+//
+// Everything is in the namespace puntoexe
+//
+///////////////////////////////////////////////////////////
+namespace puntoexe
+{
+
+/// \addtogroup group_baseclasses
+///
+/// @{
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+/// \brief This class derives from the baseStream
+///         class and reads in advance the data of
+///         another stream.
+///
+/// The data of the connected stream is read in blocks
+///  by a background thread: each time a block is read
+///  the following blocks are requested, so the thread
+///  reads them while the application is busy with the
+///  data already read.
+///
+/// Use this class on top of a puntoexe::stream when
+///  the file is read sequentially and the storage is
+///  slow (e.g. network mounted files), so the file
+///  reads overlap the parsing and the decoding of the
+///  data.
+///
+/// The stream is read only: call write() on the connected
+///  stream instead.
+///
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+class readAheadStream : public baseStream
+{
+
+#if(!defined IMEBRA_READ_AHEAD_BLOCK_SIZE)
+	#define IMEBRA_READ_AHEAD_BLOCK_SIZE 262144
+#endif
+
+#if(!defined IMEBRA_READ_AHEAD_BLOCKS)
+	#define IMEBRA_READ_AHEAD_BLOCKS 4
+#endif
+
+protected:
+	// Destructor. Stops the reading thread
+	///////////////////////////////////////////////////////////
+	virtual ~readAheadStream();
+
+public:
+	/// \brief Construct a readAheadStream object and
+	///         connect it to the stream to be read.
+	///
+	/// @param pStream      the stream from which the data
+	///                      is read
+	/// @param blockSize    the number of bytes read by the
+	///                      background thread at once
+	/// @param blocksNumber the number of blocks that the
+	///                      background thread reads after
+	///                      the block being read by the
+	///                      application
+	///
+	///////////////////////////////////////////////////////////
+	readAheadStream(ptr<baseStream> pStream, std::uint32_t blockSize = IMEBRA_READ_AHEAD_BLOCK_SIZE, std::uint32_t blocksNumber = IMEBRA_READ_AHEAD_BLOCKS);
+
+	///////////////////////////////////////////////////////////
+	//
+	// Virtual stream's functions
+	//
+	///////////////////////////////////////////////////////////
+	virtual void write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength);
+	virtual std::uint32_t read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength);
+
+protected:
+	enum tBlockStatus
+	{
+		blockEmpty,
+		blockRequested,
+		blockReading,
+		blockRead,
+		blockFailed
+	};
+
+	struct block
+	{
+		std::uint64_t m_blockNumber;
+		tBlockStatus m_status;
+		std::vector<std::uint8_t> m_data;
+		std::uint32_t m_size;
+		std::string m_error;
+	};
+
+	// Return the block with the specified number and request
+	//  the following ones. Called with m_mutex locked
+	///////////////////////////////////////////////////////////
+	block* requestBlocks(std::uint64_t blockNumber);
+
+	// The background thread
+	///////////////////////////////////////////////////////////
+	void readBlocks();
+
+	ptr<baseStream> m_pStream;
+
+	std::uint32_t m_blockSize;
+	std::uint32_t m_blocksNumber;
+
+	// The block being read by the application, the
+	//  following ones and the one that the background thread
+	//  may still be reading after a seek
+	///////////////////////////////////////////////////////////
+	std::vector<block> m_blocks;
+
+	std::mutex m_mutex;
+	std::condition_variable m_blockRequestedCondition;
+	std::condition_variable m_blockReadCondition;
+	bool m_bTerminate;
+
+	std::thread m_readThread;
+};
+
+///@}
+
+} // namespace puntoexe
+
+#endif // !defined(imebraReadAheadStream_6A0B2C0E_3F4D_4C51_9E2B_7D1A5F8C4E93__INCLUDED_)
@@ -137,8 +137,8 @@ public:
 	// Virtual stream's functions
 	//
 	///////////////////////////////////////////////////////////
-	virtual void write(std::uint32_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength);
-	virtual std::uint32_t read(std::uint32_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength);
+	virtual void write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength);
+	virtual std::uint32_t read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength);
 
 protected:
 	FILE* m_openFile;
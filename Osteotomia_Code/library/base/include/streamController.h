@@ -108,7 +108,7 @@ public:
 	///                           beyond the virtual length
 	///
 	///////////////////////////////////////////////////////////
-	streamController(ptr<baseStream> pControlledStream, std::uint32_t virtualStart = 0, std::uint32_t virtualLength = 0);
+	streamController(ptr<baseStream> pControlledStream, std::uint64_t virtualStart = 0, std::uint64_t virtualLength = 0);
 
     virtual ~streamController();
 
@@ -131,7 +131,7 @@ public:
 	///                  start position set in the constructor
 	///
 	///////////////////////////////////////////////////////////
-	std::uint32_t position();
+	std::uint64_t position();
 
 	/// \brief Return a pointer to the controlled stream.
 	///
@@ -151,7 +151,7 @@ public:
 	///                  beginning of the stream
 	///
 	///////////////////////////////////////////////////////////
-	std::uint32_t getControlledStreamPosition();
+	std::uint64_t getControlledStreamPosition();
 
 	///////////////////////////////////////////////////////////
 	/// \name Byte ordering
@@ -232,7 +232,7 @@ protected:
 	///         in the stream controller.
 	///
 	///////////////////////////////////////////////////////////
-	std::uint32_t m_virtualStart;
+	std::uint64_t m_virtualStart;
 
 	/// \brief Max number of bytes that the stream controller
 	///         can control in the controlled stream. An EOF
@@ -243,9 +243,9 @@ protected:
 	///  maximum length.
 	///
 	///////////////////////////////////////////////////////////
-	std::uint32_t m_virtualLength;
+	std::uint64_t m_virtualLength;
 
-	std::uint32_t m_dataBufferStreamPosition;
+	std::uint64_t m_dataBufferStreamPosition;
 	std::uint8_t* m_pDataBufferStart;
 	std::uint8_t* m_pDataBufferCurrent;
 	std::uint8_t* m_pDataBufferEnd;
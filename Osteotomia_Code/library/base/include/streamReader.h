@@ -123,7 +123,7 @@ public:
 	///                            are visible
 	///
 	///////////////////////////////////////////////////////////
-    streamReader(ptr<baseStream> pControlledStream, std::uint32_t virtualStart, std::uint32_t virtualLength);
+    streamReader(ptr<baseStream> pControlledStream, std::uint64_t virtualStart, std::uint64_t virtualLength);
 
     /// \brief Returns a new streamReader object that starts
     ///        at the current stream location and continues
@@ -135,7 +135,7 @@ public:
     ///                      advance the read position past
     ///                      the end position of the new
     ///                      streamReader
-    ptr<streamReader> getReader(std::uint32_t virtualLength);
+    ptr<streamReader> getReader(std::uint64_t virtualLength);
 
     /// \brief Read raw data from the stream.
 	///
@@ -190,13 +190,17 @@ public:
 	///                   absolute position
 	///
 	///////////////////////////////////////////////////////////
-	void seek(std::int32_t newPosition, bool bCurrent = false);
+	void seek(std::int64_t newPosition, bool bCurrent = false);
 
 	/// \brief Read the specified amount of bits from the
 	///         stream.
 	///
-	/// The functions uses a special bit pointer to keep track
-	///  of the bytes that haven't been completly read.
+	/// The bits are read through a 64 bits buffer that is
+	///  refilled several bytes at once, so the bytes that
+	///  follow the returned bits may have already been
+	///  read from the stream: call resetInBitsBuffer()
+	///  before calling read(), seek() or position() after
+	///  a sequence of bits.
 	///
 	/// The function throws a streamExceptionRead exception if
 	///  an error occurs.
@@ -209,48 +213,62 @@ public:
 	///////////////////////////////////////////////////////////
 	inline std::uint32_t readBits(int bitsNum)
 	{
-		static const int bufferSize(sizeof(m_inBitsBuffer) * 8);
-
-		// All the requested bits are already in the buffer.
-		// Just return them.
-		///////////////////////////////////////////////////////////
-		if(bitsNum <= m_inBitsNum)
+		if(bitsNum > m_inBitsNum)
 		{
-			std::uint32_t returnValue(m_inBitsBuffer >> (bufferSize - bitsNum));
-			m_inBitsBuffer <<= bitsNum;
-			m_inBitsNum -= bitsNum;
-			return returnValue;
+			fillInBitsBuffer(bitsNum);
 		}
 
-		// Fill a local variable with the read bits
+		// Shift in two steps, so 0 bits can be read
 		///////////////////////////////////////////////////////////
-		std::uint32_t returnValue(0);
+		std::uint32_t returnValue((std::uint32_t)((m_inBitsBuffer >> 1) >> (63 - bitsNum)));
+		m_inBitsBuffer <<= bitsNum;
+		m_inBitsNum -= bitsNum;
+		return returnValue;
+	}
 
-		// Some bits are in the bits buffer, copy them and reset
-		//  the bits buffer
-		///////////////////////////////////////////////////////////
-		if(m_inBitsNum != 0)
+	/// \brief Return the specified amount of bits without
+	///         removing them from the stream.
+	///
+	/// If the stream ends or a jpeg tag follows before the
+	///  requested bits are available then the missing bits
+	///  are set to 0; the error is reported only when the
+	///  missing bits are removed by skipBits().
+	///
+	/// @param bitsNum   the number of bits to return.
+	///                  The function can return 32 bits
+	///                  maximum
+	/// @return an integer containing the next bits, right
+	///                   aligned
+	///
+	///////////////////////////////////////////////////////////
+	inline std::uint32_t peekBits(int bitsNum)
+	{
+		if(bitsNum > m_inBitsNum)
 		{
-			bitsNum -= m_inBitsNum;
-			returnValue = ((std::uint32_t)(m_inBitsBuffer >> (bufferSize - m_inBitsNum))) << bitsNum;
+			fillInBitsBuffer(0);
 		}
+		return (std::uint32_t)((m_inBitsBuffer >> 1) >> (63 - bitsNum));
+	}
 
-		// Read the requested number of bits
-		///////////////////////////////////////////////////////////
-		for(;;)
+	/// \brief Remove the specified amount of bits from the
+	///         stream, usually after they have been
+	///         examined with peekBits().
+	///
+	/// The function throws a streamExceptionRead exception if
+	///  an error occurs.
+	///
+	/// @param bitsNum   the number of bits to skip.
+	///                  The function can skip 32 bits maximum
+	///
+	///////////////////////////////////////////////////////////
+	inline void skipBits(int bitsNum)
+	{
+		if(bitsNum > m_inBitsNum)
 		{
-			if(bitsNum <= 8)
-			{
-                                m_inBitsBuffer = readByte();
-				returnValue |= (m_inBitsBuffer >> (bufferSize - bitsNum));
-				m_inBitsBuffer <<= bitsNum;
-				m_inBitsNum = 8 - bitsNum;
-				return returnValue;
-			}
-
-			bitsNum -= 8;
-			returnValue |= ((std::uint32_t)readByte()) << bitsNum;
+			fillInBitsBuffer(bitsNum);
 		}
+		m_inBitsBuffer <<= bitsNum;
+		m_inBitsNum -= bitsNum;
 	}
 
 	/// \brief Read one bit from the stream.
@@ -262,35 +280,18 @@ public:
 	///  occurs.
 	///
 	/// @return the value of the read bit (1 or 0)
-        ///
+	///
 	///////////////////////////////////////////////////////////
 	inline std::uint32_t readBit()
 	{
-		if(m_inBitsNum != 0)
+		if(m_inBitsNum == 0)
 		{
-			--m_inBitsNum;
-			if((std::int8_t)m_inBitsBuffer < 0)
-			{
-                            m_inBitsBuffer <<= 1;
-                            return 1;
-			}
-                        m_inBitsBuffer <<= 1;
-			return 0;
+			fillInBitsBuffer(1);
 		}
-
-		PUNTOEXE_FUNCTION_START(L"streamReader::readBit");
-
-		m_inBitsBuffer = readByte();
-                m_inBitsNum = 7; // We consider that one bit will go away
-                if((std::int8_t)m_inBitsBuffer < 0)
-                {
-                        m_inBitsBuffer <<= 1;
-                        return 1;
-                }
-                m_inBitsBuffer <<= 1;
-                return 0;
-
-		PUNTOEXE_FUNCTION_END();
+		std::uint32_t returnValue((std::uint32_t)(m_inBitsBuffer >> 63));
+		m_inBitsBuffer <<= 1;
+		--m_inBitsNum;
+		return returnValue;
 	}
 
 
@@ -307,34 +308,11 @@ public:
 	/// @param pBuffer   a pointer to a std::uint32_t value that
 	///                   will be left shifted and filled
 	///                   with the read bit.
-        ///
+	///
 	///////////////////////////////////////////////////////////
 	inline void addBit(std::uint32_t* const pBuffer)
 	{
-        	(*pBuffer) <<= 1;
-                
-		if(m_inBitsNum != 0)
-		{
-			if((std::int8_t)m_inBitsBuffer < 0)
-			{
-				++(*pBuffer);
-			}
-			--m_inBitsNum;
-			m_inBitsBuffer <<= 1;
-                        return;
-		}
-
-		PUNTOEXE_FUNCTION_START(L"streamReader::addBit");
-
-		m_inBitsBuffer = readByte();
-                m_inBitsNum = 7; // We consider that one bit will go away
-                if((std::int8_t)m_inBitsBuffer < 0)
-                {
-                        ++(*pBuffer);
-                }
-                m_inBitsBuffer <<= 1;
-
-		PUNTOEXE_FUNCTION_END();
+		(*pBuffer) = ((*pBuffer) << 1) | readBit();
 	}
 
 	/// \brief Reset the bit pointer used by readBits(),
@@ -343,9 +321,18 @@ public:
 	/// A subsequent call to readBits(), readBit and
 	///  addBit() will read data from a byte-aligned boundary.
 	///
+	/// The whole bytes that have been read ahead into the
+	///  bits buffer are given back to the stream, so the
+	///  read position follows the last partially read byte.
+	///
 	///////////////////////////////////////////////////////////
 	inline void resetInBitsBuffer()
 	{
+		if(m_inBitsNum >= 8)
+		{
+			rewindInBitsBuffer();
+		}
+		m_inBitsBuffer = 0;
 		m_inBitsNum = 0;
 	}
 
@@ -425,10 +412,52 @@ private:
 	///////////////////////////////////////////////////////////
 	std::uint32_t fillDataBuffer(std::uint8_t* pDestinationBuffer, std::uint32_t readLength);
 
+	/// \brief Load whole bytes into the bits buffer until it
+	///         is full, the stream ends or a jpeg tag follows.
+	///
+	/// When the data buffer contains enough bytes then 8
+	///  bytes are examined at once, and the jpeg stuffing
+	///  is looked for in the whole word.
+	///
+	/// @param requiredBits the number of bits that must be
+	///                  available: if the stream cannot
+	///                  supply them then the function throws
+	///                  streamExceptionEOF or
+	///                  streamJpegTagInStream
+	///
+	///////////////////////////////////////////////////////////
+	void fillInBitsBuffer(int requiredBits);
+
+	/// \brief Load one byte into the bits buffer, removing
+	///         the jpeg stuffing.
+	///
+	/// @return false if the stream ended or if a jpeg tag
+	///          follows: in this case the read position is
+	///          not changed
+	///
+	///////////////////////////////////////////////////////////
+	bool loadInBitsByte();
+
+	/// \brief Move the read position back before the whole
+	///         bytes stored in the bits buffer.
+	///
+	///////////////////////////////////////////////////////////
+	void rewindInBitsBuffer();
+
 private:
-	std::uint8_t m_inBitsBuffer;
+	// The bits not yet returned, left aligned. The bits that
+	//  follow the m_inBitsNum valid ones are always 0
+	///////////////////////////////////////////////////////////
+	std::uint64_t m_inBitsBuffer;
 	int       m_inBitsNum;
 
+	// The number of stream bytes from which each byte in the
+	//  bits buffer was read (more than 1 for the stuffed
+	//  0xff), 8 bits each. The lowest byte refers to the
+	//  last byte loaded
+	///////////////////////////////////////////////////////////
+	std::uint64_t m_inBitsStreamLengths;
+
 };
 
 ///@}
@@ -99,7 +99,7 @@ public:
 	///                             see all the bytes
 	///
 	///////////////////////////////////////////////////////////
-	streamWriter(ptr<baseStream> pControlledStream, std::uint32_t virtualStart = 0, std::uint32_t virtualLength = 0);
+	streamWriter(ptr<baseStream> pControlledStream, std::uint64_t virtualStart = 0, std::uint64_t virtualLength = 0);
 
 	/// \brief Writes the internal buffer into the connected
 	///         stream. This function is automatically called
@@ -130,8 +130,10 @@ public:
 	/// \brief Write the specified amount of bits to the
 	///         stream.
 	///
-	/// The functions uses a special bit pointer to keep track
-	///  of the bytes that haven't been completly written.
+	/// The bits are collected in a 64 bits buffer and are
+	///  written to the stream 4 bytes at a time, so the
+	///  last bits may remain in the buffer until
+	///  resetOutBitsBuffer() is called.
 	///
 	/// The function throws a streamExceptionWrite exception
 	///  if an error occurs.
@@ -146,45 +148,25 @@ public:
 	{
 		PUNTOEXE_FUNCTION_START(L"streamWriter::writeBits");
 
-		std::uint32_t tempBuffer(buffer);
-
-		while(bitsNum != 0)
+		// The bits above m_outBitsNum are not cleared: they
+		//  are shifted out when the bytes are extracted
+		///////////////////////////////////////////////////////////
+		m_outBitsBuffer = (m_outBitsBuffer << bitsNum) | (buffer & ((((std::uint64_t)1) << bitsNum) - 1));
+		m_outBitsNum += bitsNum;
+		if(m_outBitsNum >= 32)
 		{
-			if(bitsNum <= (8 - m_outBitsNum))
-			{
-				m_outBitsBuffer |= (std::uint8_t)(tempBuffer << (8 - m_outBitsNum - bitsNum));
-				m_outBitsNum += bitsNum;
-                                if(m_outBitsNum==8)
-                                {
-                                        m_outBitsNum = 0;
-                                        writeByte(m_outBitsBuffer);
-                                        m_outBitsBuffer = 0;
-                                }
-                                return;
-			}
-			if(m_outBitsNum == 0 && bitsNum >= 8)
-                        {
-                                bitsNum -= 8;
-                                writeByte(tempBuffer >> bitsNum);
-                        }
-                        else
-                        {
-                            m_outBitsBuffer |= (std::uint8_t)(tempBuffer >> (bitsNum + m_outBitsNum - 8));
-                            bitsNum -= (8-m_outBitsNum);
-                            writeByte(m_outBitsBuffer);
-                            m_outBitsBuffer = 0;
-                            m_outBitsNum = 0;
-                        }
-
-                        tempBuffer &= (((std::uint32_t)1) << bitsNum) - 1;
-
-                }
+			m_outBitsNum -= 32;
+			writeWord((std::uint32_t)(m_outBitsBuffer >> m_outBitsNum));
+		}
 
 		PUNTOEXE_FUNCTION_END();
 	}
 
 	/// \brief Reset the bit pointer used by writeBits().
 	///
+	/// The bits still in the buffer are written to the
+	///  stream, and the last byte is completed with zeros.
+	///
 	/// A subsequent call to writeBits() will write data to
 	///  a byte-aligned boundary.
 	///
@@ -193,10 +175,16 @@ public:
 	{
 		PUNTOEXE_FUNCTION_START(L"streamWriter::resetOutBitsBuffer");
 
+		while(m_outBitsNum >= 8)
+		{
+			m_outBitsNum -= 8;
+			writeByte((std::uint8_t)(m_outBitsBuffer >> m_outBitsNum));
+		}
+
 		if(m_outBitsNum == 0)
 			return;
 
-		writeByte(m_outBitsBuffer);
+		writeByte((std::uint8_t)(m_outBitsBuffer << (8 - m_outBitsNum)));
 		flushDataBuffer();
 		m_outBitsBuffer = 0;
 		m_outBitsNum = 0;
@@ -239,6 +227,36 @@ public:
 		}
 	}
 
+	/// \brief Write 4 bytes to the stream, most significant
+	///         byte first, parsing them like writeByte().
+	///
+	/// When the data buffer has enough free space and none
+	///  of the bytes has the value 0xFF then the bytes are
+	///  stored without examining them one by one.
+	///
+	/// @param buffer    bytes to be written
+	///
+	///////////////////////////////////////////////////////////
+	inline void writeWord(const std::uint32_t buffer)
+	{
+		// Detect the bytes set to 0xFF in all the word at once
+		///////////////////////////////////////////////////////////
+		if(m_pDataBufferMaxEnd - m_pDataBufferCurrent >= 4 &&
+			(!m_bJpegTags || ((~buffer - (std::uint32_t)0x01010101) & buffer & (std::uint32_t)0x80808080) == 0))
+		{
+			m_pDataBufferCurrent[0] = (std::uint8_t)(buffer >> 24);
+			m_pDataBufferCurrent[1] = (std::uint8_t)(buffer >> 16);
+			m_pDataBufferCurrent[2] = (std::uint8_t)(buffer >> 8);
+			m_pDataBufferCurrent[3] = (std::uint8_t)buffer;
+			m_pDataBufferCurrent += 4;
+			return;
+		}
+		writeByte((std::uint8_t)(buffer >> 24));
+		writeByte((std::uint8_t)(buffer >> 16));
+		writeByte((std::uint8_t)(buffer >> 8));
+		writeByte((std::uint8_t)buffer);
+	}
+
 protected:
 	/// \brief Flushes the internal buffer, disconnects the
 	///         stream and destroys the streamWriter.
@@ -247,7 +265,7 @@ protected:
 	virtual ~streamWriter();
 
 private:
-	std::uint8_t m_outBitsBuffer;
+	std::uint64_t m_outBitsBuffer;
 	int       m_outBitsNum;
 
 };
@@ -175,9 +175,8 @@ void basePtr::addRef()
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-baseObject::baseObject(): m_lockCounter(0), m_bValid(true), m_pCriticalSection(new CObjectCriticalSection)
+baseObject::baseObject(): m_lockCounter(0), m_bValid(true), m_pCriticalSection(0)
 {
-    m_pCriticalSection->addRef();
 }
 
 
@@ -191,17 +190,14 @@ baseObject::baseObject(): m_lockCounter(0), m_bValid(true), m_pCriticalSection(n
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 baseObject::baseObject(const ptr<baseObject>& externalLock): 
-	m_lockCounter(0), m_bValid(true)
+	m_lockCounter(0), m_bValid(true), m_pCriticalSection(0)
 {
-    if(externalLock == 0)
+    if(externalLock != 0)
     {
-        m_pCriticalSection = new CObjectCriticalSection;
+        CObjectCriticalSection* pCriticalSection = externalLock->getCriticalSection();
+        pCriticalSection->addRef();
+        m_pCriticalSection = pCriticalSection;
     }
-    else
-    {
-        m_pCriticalSection = externalLock->m_pCriticalSection;
-    }
-    m_pCriticalSection->addRef();
 }
 
 
@@ -231,7 +227,11 @@ bool baseObject::isReferencedOnce()
 ///////////////////////////////////////////////////////////
 baseObject::~baseObject()
 {
-    m_pCriticalSection->release();
+    CObjectCriticalSection* pCriticalSection = m_pCriticalSection.load(std::memory_order_acquire);
+    if(pCriticalSection != 0)
+    {
+        pCriticalSection->release();
+    }
     m_bValid = false;
 }
 
@@ -321,7 +321,7 @@ void baseObject::lock()
 	{
 		return;
 	}
-	m_pCriticalSection->m_criticalSection.lock();
+	getCriticalSection()->m_criticalSection.lock();
 }
 
 
@@ -340,7 +340,40 @@ void baseObject::unlock()
 	{
 		return;
 	}
-	m_pCriticalSection->m_criticalSection.unlock();
+	// unlock() follows lock(): the critical section exists
+	m_pCriticalSection.load(std::memory_order_acquire)->m_criticalSection.unlock();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Return the critical section, allocating it on the first
+//  call
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+baseObject::CObjectCriticalSection* baseObject::getCriticalSection()
+{
+	CObjectCriticalSection* pCriticalSection = m_pCriticalSection.load(std::memory_order_acquire);
+	if(pCriticalSection != 0)
+	{
+		return pCriticalSection;
+	}
+
+	// Two threads may lock the object for the first time
+	//  together: only one critical section is kept
+	///////////////////////////////////////////////////////////
+	CObjectCriticalSection* pNewCriticalSection = new CObjectCriticalSection;
+	pNewCriticalSection->addRef();
+	if(m_pCriticalSection.compare_exchange_strong(pCriticalSection, pNewCriticalSection, std::memory_order_acq_rel, std::memory_order_acquire))
+	{
+		return pNewCriticalSection;
+	}
+	pNewCriticalSection->release();
+	return pCriticalSection;
 }
 
 
@@ -445,7 +478,7 @@ lockMultipleObjects::lockMultipleObjects(tObjectsList* pObjectsList)
 		{
 			continue;
 		}
-		csList.push_back(&( (*scanObjects)->m_pCriticalSection->m_criticalSection) );
+		csList.push_back(&( (*scanObjects)->getCriticalSection()->m_criticalSection) );
 	}
 	m_pLockedCS.reset(puntoexe::lockMultipleCriticalSections(&csList));
 }
@@ -52,6 +52,7 @@ The author can be contacted by email at info@binarno.com or by mail at
 
 #include "../include/exception.h"
 #include "../include/charsetConversion.h"
+#include <vector>
 
 namespace puntoexe
 {
@@ -62,6 +63,88 @@ namespace puntoexe
 ///////////////////////////////////////////////////////////
 static exceptionsManager::forceExceptionsConstruction forceConstruction;
 
+
+namespace
+{
+
+///////////////////////////////////////////////////////////
+// Set when the calling thread's information has been
+//  destroyed: the exceptions thrown later (e.g. by the
+//  destructors of other thread objects) are not logged
+///////////////////////////////////////////////////////////
+thread_local bool threadInformationClosed = false;
+
+} // anonymous namespace
+
+
+///////////////////////////////////////////////////////////
+// The last exceptionInfo objects logged by a single
+//  thread, stored in a ring buffer.
+// Only the owning thread accesses it, so it doesn't need
+//  to be locked
+///////////////////////////////////////////////////////////
+class exceptionsManager::threadInformation
+{
+public:
+	threadInformation(): m_first(0)
+	{
+	}
+
+	~threadInformation()
+	{
+		threadInformationClosed = true;
+	}
+
+	// Return the calling thread's information, or 0 if the
+	//  thread is terminating
+	///////////////////////////////////////////////////////////
+	static threadInformation* getThreadInformation()
+	{
+		if(threadInformationClosed)
+		{
+			return 0;
+		}
+		static thread_local threadInformation information;
+		return &information;
+	}
+
+	// Add an info object, replacing the oldest one when the
+	//  buffer is full
+	///////////////////////////////////////////////////////////
+	void add(const exceptionInfo& info)
+	{
+		if(m_information.size() < IMEBRA_EXCEPTIONS_INFO_MAX_SIZE)
+		{
+			m_information.push_back(info);
+			return;
+		}
+		m_information[m_first] = info;
+		m_first = (m_first + 1) % m_information.size();
+	}
+
+	// Copy the info objects, from the oldest one, and clear
+	//  the buffer
+	///////////////////////////////////////////////////////////
+	void get(tExceptionInfoList* pList)
+	{
+		for(size_t scanInformation = 0; scanInformation != m_information.size(); ++scanInformation)
+		{
+			pList->push_back(m_information[(m_first + scanInformation) % m_information.size()]);
+		}
+		clear();
+	}
+
+	void clear()
+	{
+		m_information.clear();
+		m_first = 0;
+	}
+
+private:
+	std::vector<exceptionInfo> m_information;
+	size_t m_first;
+};
+
 	
 ///////////////////////////////////////////////////////////
 // Return the message info for the specified thread
@@ -89,21 +172,11 @@ std::wstring exceptionsManager::getMessage()
 ///////////////////////////////////////////////////////////
 void exceptionsManager::getExceptionInfo(tExceptionInfoList* pList)
 {
-	ptr<exceptionsManager> pManager(getExceptionsManager());
-	lockObject lock(pManager.get());
-
-    tInfoMap::iterator findInformation = pManager->m_information.find(std::this_thread::get_id());
-	if(findInformation == pManager->m_information.end())
+	threadInformation* pInformation(threadInformation::getThreadInformation());
+	if(pInformation != 0)
 	{
-		return;
+		pInformation->get(pList);
 	}
-	for(tExceptionInfoList::iterator scanInformation = findInformation->second.begin(); 
-		scanInformation != findInformation->second.end(); 
-		++scanInformation)
-	{
-		pList->push_back(*scanInformation);
-	}
-	pManager->m_information.erase(findInformation);
 }
 
 
@@ -112,9 +185,11 @@ void exceptionsManager::getExceptionInfo(tExceptionInfoList* pList)
 ///////////////////////////////////////////////////////////
 void exceptionsManager::addExceptionInfo(const exceptionInfo& info)
 {
-	ptr<exceptionsManager> pManager(getExceptionsManager());
-	lockObject lock(pManager.get());
-    pManager->m_information[std::this_thread::get_id()].push_back(info);
+	threadInformation* pInformation(threadInformation::getThreadInformation());
+	if(pInformation != 0)
+	{
+		pInformation->add(info);
+	}
 }
 
 
@@ -123,14 +198,11 @@ void exceptionsManager::addExceptionInfo(const exceptionInfo& info)
 ///////////////////////////////////////////////////////////
 void exceptionsManager::clearExceptionInfo()
 {
-	ptr<exceptionsManager> pManager(getExceptionsManager());
-	lockObject lock(pManager.get());
-    tInfoMap::iterator findInformation = pManager->m_information.find(std::this_thread::get_id());
-	if(findInformation == pManager->m_information.end())
+	threadInformation* pInformation(threadInformation::getThreadInformation());
+	if(pInformation != 0)
 	{
-		return;
+		pInformation->clear();
 	}
-	pManager->m_information.erase(findInformation);
 }
 
 ///////////////////////////////////////////////////////////
@@ -84,7 +84,8 @@ namespace puntoexe
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-huffmanTable::huffmanTable(std::uint32_t maxValueLength)
+huffmanTable::huffmanTable(std::uint32_t maxValueLength, std::uint32_t amplitudeLengthMask /* = 0 */):
+	m_amplitudeLengthMask(amplitudeLengthMask)
 {
 	m_numValues=(1L<<(maxValueLength))+1L;
 
@@ -119,9 +120,8 @@ void huffmanTable::reset()
 
     m_valuesPerLength.fill(0);
     m_firstValidLength = 0;
-    m_firstMinValue = 0xffffffff;
-    m_firstMaxValue = 0xffffffff;
-    m_firstValuesPerLength = 0;
+    m_lookupValuesCount = 0;
+    m_lookupTable.fill(lookupEntry());
 
 	PUNTOEXE_FUNCTION_END();
 }
@@ -336,10 +336,9 @@ void huffmanTable::calcHuffmanTables()
 
 	::memset(m_minValuePerLength, 0xffffffff, sizeof(m_minValuePerLength));
 	::memset(m_maxValuePerLength, 0xffffffff, sizeof(m_maxValuePerLength));
-    m_firstValuesPerLength = 0;
-    m_firstMinValue = 0xffffffff;
-    m_firstMaxValue = 0xffffffff;
 	m_firstValidLength = 0;
+	m_lookupValuesCount = 0;
+	m_lookupTable.fill(lookupEntry());
 	for(std::uint32_t codeLength=1L; codeLength != sizeof(m_valuesPerLength)/sizeof(std::uint32_t); ++codeLength)
 	{
 		if(m_valuesPerLength[codeLength] != 0 && m_firstValidLength == 0)
@@ -355,17 +354,46 @@ void huffmanTable::calcHuffmanTables()
 			m_maxValuePerLength[codeLength]=huffmanCode;
 			m_valuesToHuffman[m_orderedValues[valueIndex]]=huffmanCode;
 			m_valuesToHuffmanLength[m_orderedValues[valueIndex]]=codeLength;
+
+			// Fill all the lookup entries that begin with the
+			//  short codes
+			///////////////////////////////////////////////////////////
+			std::uint32_t value(m_orderedValues[valueIndex]);
+			if(codeLength <= IMEBRA_HUFFMAN_LOOKUP_BITS && huffmanCode < ((std::uint32_t)1 << codeLength) && value <= 0xffff)
+			{
+				std::uint32_t freeBits(IMEBRA_HUFFMAN_LOOKUP_BITS - codeLength);
+				std::uint32_t amplitudeLength(value & m_amplitudeLengthMask);
+				for(std::uint32_t scanEntries(0); scanEntries != ((std::uint32_t)1 << freeBits); ++scanEntries)
+				{
+					lookupEntry& entry(m_lookupTable[(huffmanCode << freeBits) | scanEntries]);
+					entry.m_value = (std::uint16_t)value;
+					entry.m_length = (std::uint8_t)codeLength;
+					if(amplitudeLength > freeBits)
+					{
+						continue;
+					}
+					std::int32_t amplitude((std::int32_t)(scanEntries >> (freeBits - amplitudeLength)));
+					if(amplitudeLength != 0 && amplitude < ((std::int32_t)1 << (amplitudeLength - 1)))
+					{
+						amplitude -= ((std::int32_t)1 << amplitudeLength) - 1;
+					}
+					entry.m_amplitudeLength = (std::uint8_t)(codeLength + amplitudeLength);
+					entry.m_amplitude = (std::int16_t)amplitude;
+				}
+			}
+
 			++valueIndex;
 			++huffmanCode;
 		}
 
 		huffmanCode<<=1;
 
-	}
+		if(codeLength <= IMEBRA_HUFFMAN_LOOKUP_BITS)
+		{
+			m_lookupValuesCount = valueIndex;
+		}
 
-    m_firstMinValue = m_minValuePerLength[m_firstValidLength];
-    m_firstMaxValue = m_maxValuePerLength[m_firstValidLength];
-    m_firstValuesPerLength = m_valuesPerLength[m_firstValidLength];
+	}
 
 	PUNTOEXE_FUNCTION_END();
 }
@@ -383,22 +411,96 @@ std::uint32_t huffmanTable::readHuffmanCode(streamReader* pStream)
 {
     PUNTOEXE_FUNCTION_START(L"huffmanTable::readHuffmanCode");
 
-    // Read initial number of bits
-	std::uint32_t readBuffer(pStream->readBits(m_firstValidLength));
+	// Short codes are decoded by the lookup table
+	///////////////////////////////////////////////////////////
+	const lookupEntry& entry(m_lookupTable[pStream->peekBits(IMEBRA_HUFFMAN_LOOKUP_BITS)]);
+	if(entry.m_length != 0)
+	{
+		pStream->skipBits(entry.m_length);
+		return entry.m_value;
+	}
+
+	return readLongHuffmanCode(pStream);
+
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Read an Huffman code and the following amplitude
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint32_t huffmanTable::readHuffmanCode(streamReader* pStream, std::int32_t* pAmplitude)
+{
+    PUNTOEXE_FUNCTION_START(L"huffmanTable::readHuffmanCode");
 
-	// Validate the current Huffman code. If it's OK, then
-	//  return the ordered value
+	// Short codes followed by short amplitudes are decoded
+	//  by the lookup table
 	///////////////////////////////////////////////////////////
-    if(readBuffer <= m_firstMaxValue)
+	const lookupEntry& entry(m_lookupTable[pStream->peekBits(IMEBRA_HUFFMAN_LOOKUP_BITS)]);
+	if(entry.m_amplitudeLength != 0)
 	{
-        return m_orderedValues[readBuffer - m_firstMinValue];
+		pStream->skipBits(entry.m_amplitudeLength);
+		*pAmplitude = entry.m_amplitude;
+		return entry.m_value;
 	}
 
-    std::uint32_t orderedValue(m_firstValuesPerLength);
+	std::uint32_t value;
+	if(entry.m_length != 0)
+	{
+		pStream->skipBits(entry.m_length);
+		value = entry.m_value;
+	}
+	else
+	{
+		value = readLongHuffmanCode(pStream);
+	}
+
+	std::uint32_t amplitudeLength(value & m_amplitudeLengthMask);
+	if(amplitudeLength == 0)
+	{
+		*pAmplitude = 0;
+		return value;
+	}
+	std::int32_t amplitude((std::int32_t)pStream->readBits(amplitudeLength));
+	if(amplitude < ((std::int32_t)1 << (amplitudeLength - 1)))
+	{
+		amplitude -= ((std::int32_t)1 << amplitudeLength) - 1;
+	}
+	*pAmplitude = amplitude;
+	return value;
+
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Read an Huffman code longer than the lookup table index
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint32_t huffmanTable::readLongHuffmanCode(streamReader* pStream)
+{
+    PUNTOEXE_FUNCTION_START(L"huffmanTable::readLongHuffmanCode");
+
+	// The lookup table already excluded the shorter codes
+	///////////////////////////////////////////////////////////
+	std::uint32_t readBuffer(pStream->readBits(IMEBRA_HUFFMAN_LOOKUP_BITS));
+
+    std::uint32_t orderedValue(m_lookupValuesCount);
 
 	// Scan all the codes sizes
 	///////////////////////////////////////////////////////////
-    for(std::uint8_t scanSize(m_firstValidLength + 1), missingBits(0); scanSize != sizeof(m_valuesPerLength)/sizeof(m_valuesPerLength[0]); ++scanSize)
+    for(std::uint8_t scanSize(IMEBRA_HUFFMAN_LOOKUP_BITS + 1), missingBits(0); scanSize != sizeof(m_valuesPerLength)/sizeof(m_valuesPerLength[0]); ++scanSize)
 	{
 		++missingBits;
 
@@ -51,6 +51,7 @@ The author can be contacted by email at info@binarno.com or by mail at
 */
 
 #include "../include/memory.h"
+#include <vector>
 
 namespace puntoexe
 {
@@ -88,8 +89,8 @@ memory::memory(stringUint8* pBuffer):
 {
 }
 
-memory::memory(std::uint32_t initialSize):
-    m_pMemoryBuffer(new stringUint8((size_t)initialSize, 0))
+memory::memory(size_t initialSize):
+    m_pMemoryBuffer(new stringUint8(initialSize, 0))
 {
 }
 
@@ -170,15 +171,15 @@ void memory::clear()
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void memory::resize(std::uint32_t newSize)
+void memory::resize(size_t newSize)
 {
 	if(m_pMemoryBuffer.get() == 0)
 	{
-		m_pMemoryBuffer.reset(new stringUint8((size_t)newSize, (std::uint8_t)0));
+		m_pMemoryBuffer.reset(new stringUint8(newSize, (std::uint8_t)0));
 	}
 	else
 	{
-	    m_pMemoryBuffer->resize((size_t)newSize, (std::uint8_t)0);
+	    m_pMemoryBuffer->resize(newSize, (std::uint8_t)0);
 	}
 
 }
@@ -193,7 +194,7 @@ void memory::resize(std::uint32_t newSize)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void memory::reserve(std::uint32_t reserveSize)
+void memory::reserve(size_t reserveSize)
 {
 	if(m_pMemoryBuffer.get() == 0)
 	{
@@ -212,13 +213,13 @@ void memory::reserve(std::uint32_t reserveSize)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t memory::size()
+size_t memory::size()
 {
 	if(m_pMemoryBuffer.get() == 0)
 	{
 		return 0;
 	}
-	return (std::uint32_t)(m_pMemoryBuffer->size());
+	return m_pMemoryBuffer->size();
 }
 
 
@@ -265,7 +266,7 @@ bool memory::empty()
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void memory::assign(const std::uint8_t* pSource, const std::uint32_t sourceLength)
+void memory::assign(const std::uint8_t* pSource, const size_t sourceLength)
 {
 	if(m_pMemoryBuffer.get() == 0)
 	{
@@ -289,25 +290,173 @@ void memory::assign(const std::uint8_t* pSource, const std::uint32_t sourceLengt
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 
+namespace
+{
+
+///////////////////////////////////////////////////////////
+// Return the size class of a size: the class N holds the
+//  buffers with a capacity between 2^N and 2^(N+1)-1
+///////////////////////////////////////////////////////////
+size_t getSizeClass(size_t size)
+{
+	size_t sizeClass = 0;
+	while(size > 1 && sizeClass < 31)
+	{
+		size >>= 1;
+		++sizeClass;
+	}
+	return sizeClass;
+}
+
+///////////////////////////////////////////////////////////
+// Set when the calling thread's cache has been destroyed:
+//  the buffers released later (e.g. by the destructors of
+//  static objects) go to the shared pool
+///////////////////////////////////////////////////////////
+thread_local bool threadCacheClosed = false;
+
+} // anonymous namespace
+
+
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 //
 //
-// Destructor
+// The unused buffers kept by a single thread.
+// Only the owning thread accesses it, so it doesn't need
+//  to be locked
 //
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-memoryPool::~memoryPool()
+class memoryPool::threadCache
 {
-	while(m_actualSize != 0)
+public:
+	threadCache(): m_actualSize(0)
+	{
+	}
+
+	// Move the buffers to the shared pool, so they can be
+	//  used by the other threads
+	///////////////////////////////////////////////////////////
+	~threadCache()
+	{
+		threadCacheClosed = true;
+		memoryPool* pPool = memoryPool::getMemoryPool();
+		for(size_t sizeClass = 0; sizeClass != m_sizeClasses; ++sizeClass)
+		{
+			for(size_t scanBuffers = 0; scanBuffers != m_buffers[sizeClass].size(); ++scanBuffers)
+			{
+				pPool->storeShared(m_buffers[sizeClass][scanBuffers]);
+			}
+		}
+	}
+
+	// Return the calling thread's cache, or 0 if the thread
+	//  is terminating
+	///////////////////////////////////////////////////////////
+	static threadCache* getThreadCache()
+	{
+		if(threadCacheClosed)
+		{
+			return 0;
+		}
+		static thread_local threadCache cache;
+		return &cache;
+	}
+
+	// Keep a small buffer. Return false if the buffer is too
+	//  big for the cache or if the cache is full
+	///////////////////////////////////////////////////////////
+	bool keep(stringUint8* pBuffer)
+	{
+		const size_t capacity = pBuffer->capacity();
+		if(capacity > IMEBRA_MEMORY_POOL_THREAD_CACHE_SIZE / 4 || m_actualSize + capacity > IMEBRA_MEMORY_POOL_THREAD_CACHE_SIZE)
+		{
+			return false;
+		}
+		m_buffers[getSizeClass(capacity)].push_back(pBuffer);
+		m_actualSize += capacity;
+		return true;
+	}
+
+	// Take the most recently released buffer able to hold
+	//  the requested size, or return 0
+	///////////////////////////////////////////////////////////
+	stringUint8* take(std::uint32_t requestedSize)
+	{
+		std::vector<stringUint8*>& buffers = m_buffers[getSizeClass(requestedSize)];
+		for(size_t scanBuffers = buffers.size(); scanBuffers != 0; --scanBuffers)
+		{
+			stringUint8* pBuffer = buffers[scanBuffers - 1];
+			if(pBuffer->capacity() >= requestedSize)
+			{
+				buffers.erase(buffers.begin() + (scanBuffers - 1));
+				m_actualSize -= pBuffer->capacity();
+				return pBuffer;
+			}
+		}
+		return 0;
+	}
+
+	// Delete all the buffers
+	///////////////////////////////////////////////////////////
+	void flush()
 	{
-		m_actualSize -= m_memorySize[m_firstUsedCell];
-		delete m_memoryPointer[m_firstUsedCell++];
-		if(m_firstUsedCell == IMEBRA_MEMORY_POOL_SLOTS)
+		for(size_t sizeClass = 0; sizeClass != m_sizeClasses; ++sizeClass)
 		{
-			m_firstUsedCell = 0;
+			for(size_t scanBuffers = 0; scanBuffers != m_buffers[sizeClass].size(); ++scanBuffers)
+			{
+				delete m_buffers[sizeClass][scanBuffers];
+			}
+			m_buffers[sizeClass].clear();
 		}
+		m_actualSize = 0;
+	}
+
+private:
+	std::array<std::vector<stringUint8*>, m_sizeClasses> m_buffers;
+	size_t m_actualSize;
+};
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Constructor
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+memoryPool::memoryPool():
+	m_buffersCount(0),
+	m_actualSize(0),
+	m_maxSize(IMEBRA_MEMORY_POOL_MAX_SIZE),
+	m_age(0),
+	m_hits(0),
+	m_threadHits(0),
+	m_misses(0),
+	m_kept(0),
+	m_discarded(0)
+{
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Destructor
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+memoryPool::~memoryPool()
+{
+	while(m_buffersCount != 0)
+	{
+		deleteOldest();
 	}
 }
 
@@ -332,53 +481,131 @@ bool memoryPool::reuseMemory(stringUint8* pString)
 	// Check for the memory size. Don't reuse it if the memory
 	//  doesn't match the requested parameters
 	///////////////////////////////////////////////////////////
-    std::uint32_t memorySize = pBuffer->size();
-	if(memorySize == 0 || memorySize < IMEBRA_MEMORY_POOL_MIN_SIZE || memorySize > IMEBRA_MEMORY_POOL_MAX_SIZE)
+	if(pBuffer->capacity() < IMEBRA_MEMORY_POOL_MIN_SIZE)
 	{
+		++m_discarded;
 		return false;
 	}
 
-	// Ok to reuse
+	// Small buffers stay in the thread that released them
 	///////////////////////////////////////////////////////////
+	threadCache* pCache = threadCache::getThreadCache();
+	if(pCache != 0 && pCache->keep(pBuffer.get()))
+	{
+		pBuffer.release();
+		++m_kept;
+		return true;
+	}
+
+	return storeShared(pBuffer.release());
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Store a buffer in the shared pool
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+bool memoryPool::storeShared(stringUint8* pString)
+{
+	std::unique_ptr<stringUint8> pBuffer(pString);
+	const size_t capacity = pBuffer->capacity();
+
 	lockCriticalSection lockThis(&m_criticalSection);
 
-	// Store the memory object in the pool
-	///////////////////////////////////////////////////////////
-	m_memorySize[m_firstFreeCell] = memorySize;
-    m_memoryPointer[m_firstFreeCell] = pBuffer.release();
-	m_actualSize += memorySize;
-    if(++m_firstFreeCell >= m_memorySize.size())
+	if(capacity > m_maxSize)
 	{
-		m_firstFreeCell = 0;
+		++m_discarded;
+		return false;
 	}
 
-	// Remove old unused memory objects
+	// Store the memory object in the pool
 	///////////////////////////////////////////////////////////
-	if(m_firstFreeCell == m_firstUsedCell)
-	{
-		m_actualSize -= m_memorySize[m_firstUsedCell];
-		delete m_memoryPointer[m_firstUsedCell];
-        if(++m_firstUsedCell >= m_memorySize.size())
-		{
-			m_firstUsedCell = 0;
-		}
-	}
+	pooledBuffer newBuffer;
+	newBuffer.m_pBuffer = pBuffer.get();
+	newBuffer.m_age = m_age++;
+	m_sharedPool[getSizeClass(capacity)].push_back(newBuffer);
+	pBuffer.release();
+	m_actualSize += capacity;
+	++m_buffersCount;
+	++m_kept;
 
 	// Remove old unused memory objects if the total unused
 	//  memory is bigger than the specified parameters
 	///////////////////////////////////////////////////////////
-	while(m_actualSize != 0 && m_actualSize > IMEBRA_MEMORY_POOL_MAX_SIZE)
+	while(m_actualSize > m_maxSize || m_buffersCount > IMEBRA_MEMORY_POOL_SLOTS)
+	{
+		deleteOldest();
+	}
+
+	return true;
+
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Delete the oldest buffer in the shared pool
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void memoryPool::deleteOldest()
+{
+	size_t oldestClass = m_sizeClasses;
+	for(size_t sizeClass = 0; sizeClass != m_sizeClasses; ++sizeClass)
 	{
-		m_actualSize -= m_memorySize[m_firstUsedCell];
-		delete m_memoryPointer[m_firstUsedCell];
-		if(++m_firstUsedCell >= IMEBRA_MEMORY_POOL_SLOTS)
+		if(!m_sharedPool[sizeClass].empty() &&
+			(oldestClass == m_sizeClasses || m_sharedPool[sizeClass].front().m_age < m_sharedPool[oldestClass].front().m_age))
 		{
-			m_firstUsedCell = 0;
+			oldestClass = sizeClass;
 		}
 	}
+	if(oldestClass == m_sizeClasses)
+	{
+		return;
+	}
 
-	return true;
+	stringUint8* pBuffer = m_sharedPool[oldestClass].front().m_pBuffer;
+	m_sharedPool[oldestClass].pop_front();
+	m_actualSize -= pBuffer->capacity();
+	--m_buffersCount;
+	delete pBuffer;
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Take a buffer from the shared pool
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+stringUint8* memoryPool::takeShared(std::uint32_t requestedSize)
+{
+	lockCriticalSection lockThis(&m_criticalSection);
 
+	std::deque<pooledBuffer>& buffers = m_sharedPool[getSizeClass(requestedSize)];
+	for(size_t scanBuffers = buffers.size(); scanBuffers != 0; --scanBuffers)
+	{
+		stringUint8* pBuffer = buffers[scanBuffers - 1].m_pBuffer;
+		if(pBuffer->capacity() >= requestedSize)
+		{
+			buffers.erase(buffers.begin() + (scanBuffers - 1));
+			m_actualSize -= pBuffer->capacity();
+			--m_buffersCount;
+			return pBuffer;
+		}
+	}
+	return 0;
 }
 
 
@@ -393,20 +620,67 @@ bool memoryPool::reuseMemory(stringUint8* pString)
 ///////////////////////////////////////////////////////////
 void memoryPool::flush()
 {
+	threadCache* pCache = threadCache::getThreadCache();
+	if(pCache != 0)
+	{
+		pCache->flush();
+	}
+
 	lockCriticalSection lockThis(&m_criticalSection);
 
-	while(m_firstUsedCell != m_firstFreeCell)
+	while(m_buffersCount != 0)
 	{
-		delete m_memoryPointer[m_firstUsedCell];
-		m_actualSize -= m_memorySize[m_firstUsedCell];
-        if(++m_firstUsedCell >= m_memorySize.size())
-		{
-			m_firstUsedCell = 0;
-		}
+		deleteOldest();
+	}
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Set the maximum size of the shared pool
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void memoryPool::setMaxSize(size_t maxSize)
+{
+	lockCriticalSection lockThis(&m_criticalSection);
+
+	m_maxSize = maxSize;
+	while(m_actualSize > m_maxSize)
+	{
+		deleteOldest();
 	}
 }
 
 
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Return the pool's counters
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+memoryPool::statistics memoryPool::getStatistics()
+{
+	statistics poolStatistics;
+	poolStatistics.m_hits = m_hits;
+	poolStatistics.m_threadHits = m_threadHits;
+	poolStatistics.m_misses = m_misses;
+	poolStatistics.m_kept = m_kept;
+	poolStatistics.m_discarded = m_discarded;
+
+	lockCriticalSection lockThis(&m_criticalSection);
+	poolStatistics.m_sharedPoolSize = m_actualSize;
+
+	return poolStatistics;
+}
+
+
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 //
@@ -436,50 +710,37 @@ memoryPool* memoryPool::getMemoryPool()
 ///////////////////////////////////////////////////////////
 memory* memoryPool::getMemory(std::uint32_t requestedSize)
 {
-	lockCriticalSection lockThis(&m_criticalSection);
-
-	// Look for an object to reuse
+	// Look for an object to reuse, first in the calling
+	//  thread's cache and then in the shared pool
 	///////////////////////////////////////////////////////////
-	for(std::uint32_t findCell = m_firstUsedCell; findCell != m_firstFreeCell;)
+	if(requestedSize >= IMEBRA_MEMORY_POOL_MIN_SIZE)
 	{
-		if(m_memorySize[findCell] != requestedSize)
+		stringUint8* pBuffer(0);
+		threadCache* pCache = threadCache::getThreadCache();
+		if(pCache != 0 && (pBuffer = pCache->take(requestedSize)) != 0)
 		{
-            if(++findCell >= m_memorySize.size())
-			{
-				findCell = 0;
-			}
-			continue;
+			++m_threadHits;
 		}
-
-		// Memory found
-		///////////////////////////////////////////////////////////
-        memory* pMemory = new memory(m_memoryPointer[findCell]);
-		m_actualSize -= m_memorySize[findCell];
-		if(findCell == m_firstUsedCell)
+		else
 		{
-			if(++m_firstUsedCell >= IMEBRA_MEMORY_POOL_SLOTS)
-			{
-				m_firstUsedCell = 0;
-			}
-			return pMemory;
+			pBuffer = takeShared(requestedSize);
 		}
 
-		std::uint32_t lastUsedCell = m_firstFreeCell == 0 ? (IMEBRA_MEMORY_POOL_SLOTS - 1) : (m_firstFreeCell - 1);
-		if(findCell == lastUsedCell)
+		// Memory found
+		///////////////////////////////////////////////////////////
+		if(pBuffer != 0)
 		{
-			m_firstFreeCell = lastUsedCell;
+			++m_hits;
+			std::unique_ptr<stringUint8> pReuse(pBuffer);
+			pReuse->resize(requestedSize);
+			memory* pMemory = new memory(pReuse.get());
+			pReuse.release();
 			return pMemory;
 		}
-
-		m_memorySize[findCell] = m_memorySize[m_firstUsedCell];
-		m_memoryPointer[findCell] = m_memoryPointer[m_firstUsedCell];
-		if(++m_firstUsedCell >= IMEBRA_MEMORY_POOL_SLOTS)
-		{
-			m_firstUsedCell = 0;
-		}
-		return pMemory;
 	}
 
+	++m_misses;
+
     try
     {
         return new memory(requestedSize);
@@ -94,7 +94,7 @@ memoryStream::memoryStream(ptr<memory> memoryStream): m_memory(memoryStream)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void memoryStream::write(std::uint32_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength)
+void memoryStream::write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength)
 {
 	PUNTOEXE_FUNCTION_START(L"memoryStream::write");
 
@@ -111,13 +111,13 @@ void memoryStream::write(std::uint32_t startPosition, const std::uint8_t* pBuffe
 	///////////////////////////////////////////////////////////
 	if(startPosition + bufferLength > m_memory->size())
 	{
-		std::uint32_t newSize = startPosition + bufferLength;
-		std::uint32_t reserveSize = ((newSize + 1023) >> 10) << 10; // preallocate blocks of 1024 bytes
+		size_t newSize = (size_t)(startPosition + bufferLength);
+		size_t reserveSize = ((newSize + 1023) >> 10) << 10; // preallocate blocks of 1024 bytes
 		m_memory->reserve(reserveSize);
-		m_memory->resize(startPosition + bufferLength);
+		m_memory->resize(newSize);
 	}
 
-	::memcpy(m_memory->data() + startPosition, pBuffer, bufferLength);
+	::memcpy(m_memory->data() + (size_t)startPosition, pBuffer, bufferLength);
 
 	PUNTOEXE_FUNCTION_END();
 }
@@ -132,7 +132,7 @@ void memoryStream::write(std::uint32_t startPosition, const std::uint8_t* pBuffe
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t memoryStream::read(std::uint32_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
+std::uint32_t memoryStream::read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
 {
 	PUNTOEXE_FUNCTION_START(L"memoryStream::read");
 
@@ -145,7 +145,7 @@ std::uint32_t memoryStream::read(std::uint32_t startPosition, std::uint8_t* pBuf
 
 	// Don't read if the requested position isn't valid
 	///////////////////////////////////////////////////////////
-	std::uint32_t memorySize = m_memory->size();
+	std::uint64_t memorySize = m_memory->size();
 	if(startPosition >= memorySize)
 	{
 		return 0;
@@ -156,7 +156,7 @@ std::uint32_t memoryStream::read(std::uint32_t startPosition, std::uint8_t* pBuf
 	std::uint32_t copySize = bufferLength;
 	if(startPosition + bufferLength > memorySize)
 	{
-		copySize = memorySize - startPosition;
+		copySize = (std::uint32_t)(memorySize - startPosition);
 	}
 
 	if(copySize == 0)
@@ -164,7 +164,7 @@ std::uint32_t memoryStream::read(std::uint32_t startPosition, std::uint8_t* pBuf
 		return 0;
 	}
 
-	::memcpy(pBuffer, m_memory->data() + startPosition, copySize);
+	::memcpy(pBuffer, m_memory->data() + (size_t)startPosition, copySize);
 
 	return copySize;
 
@@ -172,4 +172,83 @@ std::uint32_t memoryStream::read(std::uint32_t startPosition, std::uint8_t* pBuf
 }
 
 
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+//
+// readOnlyMemoryStream
+//
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Constructor
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+readOnlyMemoryStream::readOnlyMemoryStream(ptr<memory> memoryStream):
+	m_memory(memoryStream),
+	m_pData(memoryStream->data()),
+	m_size(memoryStream->size())
+{
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Write raw data into the stream
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void readOnlyMemoryStream::write(std::uint64_t /* startPosition */, const std::uint8_t* /* pBuffer */, std::uint32_t /* bufferLength */)
+{
+	PUNTOEXE_FUNCTION_START(L"readOnlyMemoryStream::write");
+
+	PUNTOEXE_THROW(streamExceptionWrite, "readOnlyMemoryStream::write the stream is read only");
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Read raw data from the stream.
+// The memory doesn't change, so there is nothing to lock
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint32_t readOnlyMemoryStream::read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
+{
+	if(startPosition >= m_size)
+	{
+		return 0;
+	}
+
+	std::uint32_t copySize = bufferLength;
+	if(startPosition + bufferLength > m_size)
+	{
+		copySize = (std::uint32_t)(m_size - startPosition);
+	}
+
+	::memcpy(pBuffer, m_pData + (size_t)startPosition, copySize);
+
+	return copySize;
+}
+
+
 } // namespace puntoexe
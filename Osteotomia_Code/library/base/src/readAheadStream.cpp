@@ -0,0 +1,330 @@
+/*
+
+Imebra community build 20151130-002
+
+Imebra: a C++ Dicom library
+
+Copyright (c) 2003, 2004, 2005, 2006, 2007, 2008, 2009, 2010, 2011, 2012, 2013, 2014, 2015
+by Paolo Brandoli/Binarno s.p.
+
+All rights reserved.
+
+This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License version 2 as published by
+ the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+-------------------
+
+If you want to use Imebra commercially then you have to buy the commercial
+ license available at http://imebra.com
+
+After you buy the commercial license then you can use Imebra according
+ to the terms described in the Imebra Commercial License Version 2.
+A copy of the Imebra Commercial License Version 2 is available in the
+ documentation pages.
+
+Imebra is available at http://imebra.com
+
+The author can be contacted by email at info@binarno.com or by mail at
+ the following address:
+ Binarno s.p., Paolo Brandoli
+ Rakuseva 14
+ 1000 Ljubljana
+ Slovenia
+
+
+
+*/
+
+/*! \file readAheadStream.cpp
+    \brief Implementation of the readAheadStream class.
+
+*/
+
+#include "../include/exception.h"
+#include "../include/readAheadStream.h"
+#include <string.h>
+
+namespace puntoexe
+{
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+//
+// readAheadStream
+//
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Constructor
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+readAheadStream::readAheadStream(ptr<baseStream> pStream, std::uint32_t blockSize /* = IMEBRA_READ_AHEAD_BLOCK_SIZE */, std::uint32_t blocksNumber /* = IMEBRA_READ_AHEAD_BLOCKS */):
+	m_pStream(pStream),
+	m_blockSize(blockSize == 0 ? 1 : blockSize),
+	m_blocksNumber(blocksNumber),
+	m_blocks(blocksNumber + 2),
+	m_bTerminate(false)
+{
+	for(std::vector<block>::iterator scanBlocks(m_blocks.begin()); scanBlocks != m_blocks.end(); ++scanBlocks)
+	{
+		scanBlocks->m_blockNumber = 0;
+		scanBlocks->m_status = blockEmpty;
+		scanBlocks->m_data.resize(m_blockSize);
+		scanBlocks->m_size = 0;
+	}
+
+	m_readThread = std::thread(&readAheadStream::readBlocks, this);
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Destructor
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+readAheadStream::~readAheadStream()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bTerminate = true;
+	}
+	m_blockRequestedCondition.notify_one();
+	m_readThread.join();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Write raw data into the stream
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void readAheadStream::write(std::uint64_t /* startPosition */, const std::uint8_t* /* pBuffer */, std::uint32_t /* bufferLength */)
+{
+	PUNTOEXE_FUNCTION_START(L"readAheadStream::write");
+
+	PUNTOEXE_THROW(streamExceptionWrite, "readAheadStream::write the stream is read only");
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Read raw data from the stream
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint32_t readAheadStream::read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
+{
+	PUNTOEXE_FUNCTION_START(L"readAheadStream::read");
+
+	// The blocks are recycled only by this function
+	///////////////////////////////////////////////////////////
+	lockObject lockThis(this);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	std::uint32_t readBytes(0);
+	while(readBytes != bufferLength)
+	{
+		std::uint64_t position(startPosition + readBytes);
+		block* pBlock(requestBlocks(position / m_blockSize));
+		m_blockRequestedCondition.notify_one();
+		m_blockReadCondition.wait(lock, [pBlock]{ return pBlock->m_status == blockRead || pBlock->m_status == blockFailed; });
+
+		if(pBlock->m_status == blockFailed)
+		{
+			// Let the next read try again
+			///////////////////////////////////////////////////////////
+			pBlock->m_status = blockEmpty;
+			PUNTOEXE_THROW(streamExceptionRead, pBlock->m_error);
+		}
+
+		std::uint32_t blockOffset((std::uint32_t)(position % m_blockSize));
+		if(blockOffset >= pBlock->m_size)
+		{
+			break;
+		}
+		std::uint32_t copySize(pBlock->m_size - blockOffset);
+		if(copySize > bufferLength - readBytes)
+		{
+			copySize = bufferLength - readBytes;
+		}
+		::memcpy(pBuffer + readBytes, &(pBlock->m_data[blockOffset]), copySize);
+		readBytes += copySize;
+
+		// A short block is the last one
+		///////////////////////////////////////////////////////////
+		if(pBlock->m_size != m_blockSize)
+		{
+			break;
+		}
+	}
+
+	return readBytes;
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Request a block and the following ones
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+readAheadStream::block* readAheadStream::requestBlocks(std::uint64_t blockNumber)
+{
+	// Forget the requests for the blocks that are not needed
+	//  anymore (after a seek)
+	///////////////////////////////////////////////////////////
+	std::uint64_t lastBlockNumber(blockNumber + m_blocksNumber);
+	for(std::vector<block>::iterator scanBlocks(m_blocks.begin()); scanBlocks != m_blocks.end(); ++scanBlocks)
+	{
+		if(scanBlocks->m_status == blockRequested && (scanBlocks->m_blockNumber < blockNumber || scanBlocks->m_blockNumber > lastBlockNumber))
+		{
+			scanBlocks->m_status = blockEmpty;
+		}
+	}
+
+	// Request the blocks that are not available yet. There is
+	//  always a free block, because only one block can be
+	//  still in the reading state outside of the requested
+	//  range
+	///////////////////////////////////////////////////////////
+	block* pRequestedBlock(0);
+	for(std::uint64_t scanNumbers(blockNumber); scanNumbers <= lastBlockNumber; ++scanNumbers)
+	{
+		block* pBlock(0);
+		block* pFreeBlock(0);
+		for(std::vector<block>::iterator scanBlocks(m_blocks.begin()); scanBlocks != m_blocks.end(); ++scanBlocks)
+		{
+			if(scanBlocks->m_status != blockEmpty && scanBlocks->m_blockNumber == scanNumbers)
+			{
+				pBlock = &(*scanBlocks);
+				break;
+			}
+			if(pFreeBlock == 0 && scanBlocks->m_status != blockReading && (scanBlocks->m_status == blockEmpty || scanBlocks->m_blockNumber < blockNumber || scanBlocks->m_blockNumber > lastBlockNumber))
+			{
+				pFreeBlock = &(*scanBlocks);
+			}
+		}
+		if(pBlock == 0)
+		{
+			pBlock = pFreeBlock;
+			pBlock->m_blockNumber = scanNumbers;
+			pBlock->m_status = blockRequested;
+		}
+		if(pRequestedBlock == 0)
+		{
+			pRequestedBlock = pBlock;
+		}
+	}
+
+	return pRequestedBlock;
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Read the requested blocks, the nearest first
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void readAheadStream::readBlocks()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for(;;)
+	{
+		block* pBlock(0);
+		m_blockRequestedCondition.wait(lock, [this, &pBlock]
+		{
+			pBlock = 0;
+			for(std::vector<block>::iterator scanBlocks(m_blocks.begin()); scanBlocks != m_blocks.end(); ++scanBlocks)
+			{
+				if(scanBlocks->m_status == blockRequested && (pBlock == 0 || scanBlocks->m_blockNumber < pBlock->m_blockNumber))
+				{
+					pBlock = &(*scanBlocks);
+				}
+			}
+			return m_bTerminate || pBlock != 0;
+		});
+
+		if(m_bTerminate)
+		{
+			return;
+		}
+
+		pBlock->m_status = blockReading;
+		std::uint64_t position(pBlock->m_blockNumber * m_blockSize);
+		lock.unlock();
+
+		tBlockStatus status(blockRead);
+		std::uint32_t size(0);
+		std::string error;
+		try
+		{
+			size = m_pStream->read(position, &(pBlock->m_data[0]), m_blockSize);
+		}
+		catch(const std::exception& e)
+		{
+			status = blockFailed;
+			error = e.what();
+			exceptionsManager::clearExceptionInfo();
+		}
+		catch(...)
+		{
+			status = blockFailed;
+			error = "readAheadStream::read failure";
+			exceptionsManager::clearExceptionInfo();
+		}
+
+		lock.lock();
+		pBlock->m_size = size;
+		pBlock->m_error = error;
+		pBlock->m_status = status;
+		m_blockReadCondition.notify_all();
+	}
+}
+
+} // namespace puntoexe
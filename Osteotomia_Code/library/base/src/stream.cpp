@@ -59,6 +59,23 @@ The author can be contacted by email at info@binarno.com or by mail at
 namespace puntoexe
 {
 
+namespace
+{
+
+///////////////////////////////////////////////////////////
+// Move the file's position, also beyond the first 2GB
+///////////////////////////////////////////////////////////
+int seekFile(FILE* pFile, std::uint64_t position)
+{
+#if defined(PUNTOEXE_WINDOWS)
+	return ::_fseeki64(pFile, (__int64)position, SEEK_SET);
+#else
+	return ::fseeko(pFile, (off_t)position, SEEK_SET);
+#endif
+}
+
+} // anonymous namespace
+
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
@@ -223,14 +240,13 @@ void stream::close()
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void stream::write(std::uint32_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength)
+void stream::write(std::uint64_t startPosition, const std::uint8_t* pBuffer, std::uint32_t bufferLength)
 {
 	PUNTOEXE_FUNCTION_START(L"stream::write");
 
 	lockObject lockThis(this);
 
-	::fseek(m_openFile, startPosition, SEEK_SET);
-	if(ferror(m_openFile) != 0)
+	if(seekFile(m_openFile, startPosition) != 0 || ferror(m_openFile) != 0)
 	{
 		PUNTOEXE_THROW(streamExceptionWrite, "stream::seek failure");
 	}
@@ -253,14 +269,13 @@ void stream::write(std::uint32_t startPosition, const std::uint8_t* pBuffer, std
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t stream::read(std::uint32_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
+std::uint32_t stream::read(std::uint64_t startPosition, std::uint8_t* pBuffer, std::uint32_t bufferLength)
 {
 	PUNTOEXE_FUNCTION_START(L"stream::read");
 
 	lockObject lockThis(this);
 
-	::fseek(m_openFile, startPosition, SEEK_SET);
-	if(ferror(m_openFile) != 0)
+	if(seekFile(m_openFile, startPosition) != 0 || ferror(m_openFile) != 0)
 	{
 		return 0;
 	}
@@ -66,7 +66,7 @@ static const streamController::tByteOrdering m_platformByteOrder((*pBytePointer)
 // Constructor
 //
 ///////////////////////////////////////////////////////////
-streamController::streamController(ptr<baseStream> pControlledStream, std::uint32_t virtualStart /* =0 */, std::uint32_t virtualLength /* =0 */):
+streamController::streamController(ptr<baseStream> pControlledStream, std::uint64_t virtualStart /* =0 */, std::uint64_t virtualLength /* =0 */):
 	m_bJpegTags(false),
         m_pControlledStream(pControlledStream),
 		m_dataBuffer(new std::uint8_t[IMEBRA_STREAM_CONTROLLER_MEMORY_SIZE]),
@@ -95,7 +95,7 @@ streamController::~streamController()
 // Retrieve the current position
 //
 ///////////////////////////////////////////////////////////
-std::uint32_t streamController::position()
+std::uint64_t streamController::position()
 {
 	return m_dataBufferStreamPosition + (std::uint32_t)(m_pDataBufferCurrent - m_pDataBufferStart);
 }
@@ -118,7 +118,7 @@ ptr<baseStream> streamController::getControlledStream()
 //  start's position
 //
 ///////////////////////////////////////////////////////////
-std::uint32_t streamController::getControlledStreamPosition()
+std::uint64_t streamController::getControlledStreamPosition()
 {
 	return m_dataBufferStreamPosition + (std::uint32_t)(m_pDataBufferCurrent - m_pDataBufferStart) + m_virtualStart;
 }
@@ -64,14 +64,16 @@ namespace puntoexe
 streamReader::streamReader(ptr<baseStream> pControlledStream):
     streamController(pControlledStream, 0, 0),
     m_inBitsBuffer(0),
-    m_inBitsNum(0)
+    m_inBitsNum(0),
+    m_inBitsStreamLengths(0)
 {
 }
 
-streamReader::streamReader(ptr<baseStream> pControlledStream, std::uint32_t virtualStart, std::uint32_t virtualLength):
+streamReader::streamReader(ptr<baseStream> pControlledStream, std::uint64_t virtualStart, std::uint64_t virtualLength):
 	streamController(pControlledStream, virtualStart, virtualLength),
 	m_inBitsBuffer(0),
-	m_inBitsNum(0)
+	m_inBitsNum(0),
+	m_inBitsStreamLengths(0)
 {
     if(virtualLength == 0)
     {
@@ -80,18 +82,18 @@ streamReader::streamReader(ptr<baseStream> pControlledStream, std::uint32_t virt
 }
 
 
-ptr<streamReader> streamReader::getReader(std::uint32_t virtualLength)
+ptr<streamReader> streamReader::getReader(std::uint64_t virtualLength)
 {
     if(virtualLength == 0)
     {
         throw(streamExceptionEOF("Virtual stream with zero length"));
     }
-    std::uint32_t currentPosition = position();
+    std::uint64_t currentPosition = position();
     if(currentPosition + virtualLength > m_virtualLength && m_virtualLength != 0)
     {
         virtualLength = m_virtualLength - currentPosition;
     }
-    seek(virtualLength, true);
+    seek((std::int64_t)virtualLength, true);
     return new streamReader(m_pControlledStream, currentPosition + m_virtualStart, virtualLength);
 }
 
@@ -102,7 +104,7 @@ ptr<streamReader> streamReader::getReader(std::uint32_t virtualLength)
 ///////////////////////////////////////////////////////////
 bool streamReader::endReached()
 {
-    return (m_pDataBufferCurrent == m_pDataBufferEnd && fillDataBuffer() == 0);
+    return (m_inBitsNum < 8 && m_pDataBufferCurrent == m_pDataBufferEnd && fillDataBuffer() == 0);
 }
 
 
@@ -147,7 +149,7 @@ std::uint32_t streamReader::fillDataBuffer(std::uint8_t* pDestinationBuffer, std
 		}
         if(m_dataBufferStreamPosition + readLength > m_virtualLength)
 		{
-            readLength = m_virtualLength - m_dataBufferStreamPosition;
+            readLength = (std::uint32_t)(m_virtualLength - m_dataBufferStreamPosition);
 		}
 	}
     return m_pControlledStream->read(m_dataBufferStreamPosition + m_virtualStart, pDestinationBuffer, readLength);
@@ -212,15 +214,15 @@ void streamReader::read(std::uint8_t* pBuffer, std::uint32_t bufferLength)
 // Seek the read position
 //
 ///////////////////////////////////////////////////////////
-void streamReader::seek(std::int32_t newPosition, bool bCurrent /* =false */)
+void streamReader::seek(std::int64_t newPosition, bool bCurrent /* =false */)
 {
 	// Calculate the absolute position
 	///////////////////////////////////////////////////////////
-	std::uint32_t finalPosition = bCurrent ? (position() + newPosition) : newPosition;
+	std::uint64_t finalPosition = bCurrent ? (position() + newPosition) : (std::uint64_t)newPosition;
 
 	// The requested position is already in the data buffer?
 	///////////////////////////////////////////////////////////
-	std::uint32_t bufferEndPosition = m_dataBufferStreamPosition + (std::uint32_t)(m_pDataBufferEnd - m_pDataBufferStart);
+	std::uint64_t bufferEndPosition = m_dataBufferStreamPosition + (std::uint32_t)(m_pDataBufferEnd - m_pDataBufferStart);
 	if(finalPosition >= m_dataBufferStreamPosition && finalPosition < bufferEndPosition)
 	{
 		m_pDataBufferCurrent = m_pDataBufferStart + finalPosition - m_dataBufferStreamPosition;
@@ -235,5 +237,137 @@ void streamReader::seek(std::int32_t newPosition, bool bCurrent /* =false */)
 }
 
 
+///////////////////////////////////////////////////////////
+//
+// Refill the bits buffer
+//
+///////////////////////////////////////////////////////////
+void streamReader::fillInBitsBuffer(int requiredBits)
+{
+	PUNTOEXE_FUNCTION_START(L"streamReader::fillInBitsBuffer");
+
+	static const std::uint64_t lowBits(0x0101010101010101ULL);
+	static const std::uint64_t highBits(0x8080808080808080ULL);
+
+	for(std::uint32_t freeBytes((std::uint32_t)(64 - m_inBitsNum) >> 3); freeBytes != 0; freeBytes = (std::uint32_t)(64 - m_inBitsNum) >> 3)
+	{
+		// Fast path: load 8 bytes from the data buffer and use
+		//  the ones that fit in the bits buffer
+		///////////////////////////////////////////////////////////
+		if(m_pDataBufferEnd - m_pDataBufferCurrent >= 8)
+		{
+			const std::uint8_t* pBytes(m_pDataBufferCurrent);
+			std::uint64_t word(
+				((std::uint64_t)pBytes[0] << 56) | ((std::uint64_t)pBytes[1] << 48) |
+				((std::uint64_t)pBytes[2] << 40) | ((std::uint64_t)pBytes[3] << 32) |
+				((std::uint64_t)pBytes[4] << 24) | ((std::uint64_t)pBytes[5] << 16) |
+				((std::uint64_t)pBytes[6] << 8) | (std::uint64_t)pBytes[7]);
+
+			// The unused bytes are masked out of the word
+			///////////////////////////////////////////////////////////
+			std::uint64_t unusedMask(freeBytes == 8 ? 0 : (~(std::uint64_t)0 >> (freeBytes * 8)));
+
+			// Look for 0xff bytes (stuffing or tags) in the whole
+			//  word: they are zero bytes in the complemented word
+			///////////////////////////////////////////////////////////
+			std::uint64_t complemented(~word | unusedMask);
+			if(!m_bJpegTags || ((complemented - lowBits) & ~complemented & highBits) == 0)
+			{
+				m_inBitsBuffer |= (word & ~unusedMask) >> m_inBitsNum;
+				m_inBitsNum += (int)freeBytes * 8;
+				m_inBitsStreamLengths = (freeBytes == 8 ? 0 : (m_inBitsStreamLengths << (freeBytes * 8))) | (lowBits >> (64 - freeBytes * 8));
+				m_pDataBufferCurrent += freeBytes;
+				continue;
+			}
+		}
+
+		// Slow path: load one byte, removing the stuffing.
+		// Stop before a tag or at the end of the stream
+		///////////////////////////////////////////////////////////
+		if(!loadInBitsByte())
+		{
+			break;
+		}
+	}
+
+	if(m_inBitsNum >= requiredBits)
+	{
+		return;
+	}
+
+	// The stream cannot supply the required bits
+	///////////////////////////////////////////////////////////
+	if(m_pDataBufferCurrent == m_pDataBufferEnd && fillDataBuffer() == 0)
+	{
+		throw(streamExceptionEOF("Attempt to read past the end of the file"));
+	}
+	throw(streamJpegTagInStream("Corrupted jpeg stream"));
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+//
+// Load one byte into the bits buffer
+//
+///////////////////////////////////////////////////////////
+bool streamReader::loadInBitsByte()
+{
+	if(m_pDataBufferCurrent == m_pDataBufferEnd && fillDataBuffer() == 0)
+	{
+		return false;
+	}
+
+	std::uint8_t value(*(m_pDataBufferCurrent++));
+	std::uint32_t streamLength(1);
+
+	// A run of 0xff followed by 0 is a stuffed 0xff, while
+	//  a run followed by another value is a tag
+	///////////////////////////////////////////////////////////
+	if(value == 0xff && m_bJpegTags)
+	{
+		std::uint64_t tagPosition(position() - 1);
+		do
+		{
+			if(m_pDataBufferCurrent == m_pDataBufferEnd && fillDataBuffer() == 0)
+			{
+				seek((std::int64_t)tagPosition);
+				return false;
+			}
+			++streamLength;
+		}while(*(m_pDataBufferCurrent++) == 0xff);
+
+		if(m_pDataBufferCurrent[-1] != 0)
+		{
+			seek((std::int64_t)tagPosition);
+			return false;
+		}
+	}
+
+	m_inBitsBuffer |= (std::uint64_t)value << (56 - m_inBitsNum);
+	m_inBitsNum += 8;
+	m_inBitsStreamLengths = (m_inBitsStreamLengths << 8) | (streamLength > 0xff ? 0xff : streamLength);
+	return true;
+}
+
+
+///////////////////////////////////////////////////////////
+//
+// Give back the bytes read ahead into the bits buffer
+//
+///////////////////////////////////////////////////////////
+void streamReader::rewindInBitsBuffer()
+{
+	std::uint32_t streamLength(0);
+	for(int wholeBytes(m_inBitsNum >> 3); wholeBytes != 0; --wholeBytes)
+	{
+		streamLength += (std::uint32_t)(m_inBitsStreamLengths >> ((wholeBytes - 1) * 8)) & 0xff;
+	}
+	seek(-(std::int64_t)streamLength, true);
+}
+
+
+
 
 } // namespace puntoexe
@@ -168,7 +168,7 @@ public:
 	buffer(const ptr<baseObject>& externalLock,
 		const std::string& defaultType,
 		const ptr<baseStream>& originalStream,
-		std::uint32_t bufferPosition,
+		std::uint64_t bufferPosition,
 		std::uint32_t bufferLength,
 		std::uint32_t wordLength,
 		streamController::tByteOrdering endianType);
@@ -407,7 +407,7 @@ protected:
 	//  from the stream.
 	///////////////////////////////////////////////////////////
 	ptr<baseStream> m_originalStream;    // < Original stream
-	std::uint32_t m_originalBufferPosition; // < Original buffer's position
+	std::uint64_t m_originalBufferPosition; // < Original buffer's position
 	std::uint32_t m_originalBufferLength;   // < Original buffer's length
 	std::uint32_t m_originalWordLength;     // < Original word's length (for low/high endian adjustment)
 	streamController::tByteOrdering m_originalEndianType; // < Original endian type
@@ -30,6 +30,17 @@ protected:
 	ptr<handlers::dataHandlerRaw> m_pDataHandler;
 };
 
+class readOnlyBufferStream: public readOnlyMemoryStream
+{
+public:
+	readOnlyBufferStream(ptr<handlers::dataHandlerRaw> pDataHandler):
+	  readOnlyMemoryStream(pDataHandler->getMemory()),
+	  m_pDataHandler(pDataHandler){}
+protected:
+
+	ptr<handlers::dataHandlerRaw> m_pDataHandler;
+};
+
 /// @}
 
 } // namespace imebra
@@ -54,9 +54,11 @@ The author can be contacted by email at info@binarno.com or by mail at
 #define imebraCodec_299706D7_4761_44a1_9F2D_8C38A7BD7AD5__INCLUDED_
 
 #include <stdexcept>
+#include <set>
 
 #include "../../base/include/baseObject.h"
 #include "../../base/include/memory.h"
+#include "image.h"
 
 ///////////////////////////////////////////////////////////
 //
@@ -93,6 +95,286 @@ namespace codecs
 ///
 /// @{
 
+///////////////////////////////////////////////////////////
+/// \brief Receives the progress of the decoding of a
+///         frame and can cancel it.
+///
+/// Set it in the frameDestination with
+///  frameDestination::setProgress(): the codecs call
+///  update() while they decode the frame (e.g. once per
+///  row or once per row of jpeg MCUs), from the thread
+///  that is decoding the image.
+///
+///////////////////////////////////////////////////////////
+class decodeProgress
+{
+public:
+	virtual ~decodeProgress(){}
+
+	/// \brief Called by update() to notify the progress.
+	///
+	/// @param done  the number of units (e.g. rows) already
+	///               decoded
+	/// @param total the total number of units
+	/// @return true to continue the decoding, false to
+	///          cancel it
+	///
+	///////////////////////////////////////////////////////////
+	virtual bool onProgress(std::uint32_t done, std::uint32_t total) = 0;
+
+	/// \brief Called by the codecs to notify the progress.
+	///
+	/// Throws codecExceptionCancelled when onProgress()
+	///  returns false.
+	///
+	/// @param done  the number of units already decoded
+	/// @param total the total number of units
+	///
+	///////////////////////////////////////////////////////////
+	void update(std::uint32_t done, std::uint32_t total);
+};
+
+
+///////////////////////////////////////////////////////////
+/// \brief Describes a buffer allocated by the caller
+///         that receives the decompressed pixels of a
+///         frame.
+///
+/// The pixels are stored interleaved (one value per
+///  channel, one channel after the other), with the
+///  bit depth specified by m_depth. Each row starts
+///  m_rowStride bytes after the previous one, so the
+///  buffer can be a sub-region of a larger bitmap or an
+///  image with padded rows.
+///
+/// When m_scale is bigger than 1 the destination
+///  receives a reduced resolution version of the frame:
+///  each destination pixel is the average of a block of
+///  m_scale x m_scale pixels of the frame, and the
+///  destination's size must be the frame's size divided
+///  by m_scale (rounded up, see getScaledSize()).
+/// The codecs may use this information to skip part of
+///  the decoding (e.g. the jpeg codec uses a reduced
+///  IDCT).
+///
+/// setRegion() selects a rectangular region of the frame:
+///  only the pixels in the region are copied into the
+///  destination, and the codecs skip as much as possible
+///  the decoding of the pixels outside the region (e.g.
+///  the jpeg codec doesn't transform the blocks outside
+///  the region and uses the restart markers to jump over
+///  them, the uncompressed images are read row by row
+///  starting from the region's offset).
+///
+/// See codec::decodeImage() and dataSet::decodeImage().
+///
+///////////////////////////////////////////////////////////
+class frameDestination
+{
+public:
+	/// \brief Describe the destination buffer.
+	///
+	/// @param pBuffer        pointer to the first byte of
+	///                        the first row
+	/// @param sizeX          the buffer's width, in pixels
+	/// @param sizeY          the buffer's height, in pixels
+	/// @param channelsNumber the number of channels per
+	///                        pixel
+	/// @param depth          the type of each channel's
+	///                        value
+	/// @param rowStride      the distance, in bytes,
+	///                        between two consecutive rows.
+	///                       Set to 0 for tightly packed
+	///                        rows
+	/// @param scale          the frame's size is divided by
+	///                        this value. Set to 1 to get
+	///                        the full resolution frame
+	///
+	///////////////////////////////////////////////////////////
+	frameDestination(std::uint8_t* pBuffer, std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t channelsNumber, image::bitDepth depth, std::uint32_t rowStride = 0, std::uint32_t scale = 1):
+		m_pBuffer(pBuffer),
+		m_sizeX(sizeX),
+		m_sizeY(sizeY),
+		m_channelsNumber(channelsNumber),
+		m_depth(depth),
+		m_rowStride(rowStride != 0 ? rowStride : sizeX * channelsNumber * getDepthSize(depth)),
+		m_scale(scale != 0 ? scale : 1),
+		m_left(0),
+		m_top(0),
+		m_bRegion(false),
+		m_pProgress(0){}
+
+	/// \brief Copy only a region of the frame into the
+	///         destination.
+	///
+	/// The region starts at the specified position and
+	///  has the destination's size; both are expressed in
+	///  pixels of the frame reduced by m_scale.
+	/// The region must be completely inside the frame.
+	///
+	/// @param left the horizontal position of the region's
+	///              first pixel
+	/// @param top  the vertical position of the region's
+	///              first pixel
+	/// @return a reference to the frameDestination
+	///
+	///////////////////////////////////////////////////////////
+	frameDestination& setRegion(std::uint32_t left, std::uint32_t top)
+	{
+		m_left = left;
+		m_top = top;
+		m_bRegion = true;
+		return *this;
+	}
+
+	/// \brief Notify the decoding's progress to the
+	///         specified object, which can also cancel the
+	///         decoding.
+	///
+	/// @param pProgress the object that receives the
+	///                   progress. It must exist until the
+	///                   decoding ends
+	/// @return a reference to the frameDestination
+	///
+	///////////////////////////////////////////////////////////
+	frameDestination& setProgress(decodeProgress* pProgress)
+	{
+		m_pProgress = pProgress;
+		return *this;
+	}
+
+	/// \brief Notify the progress to the object set with
+	///         setProgress(), if any.
+	///
+	/// @param done  the number of units already decoded
+	/// @param total the total number of units
+	///
+	///////////////////////////////////////////////////////////
+	void updateProgress(std::uint32_t done, std::uint32_t total) const
+	{
+		if(m_pProgress != 0)
+		{
+			m_pProgress->update(done, total);
+		}
+	}
+
+	/// \brief Returns the size in bytes of a channel's value
+	///         of the specified depth.
+	///
+	/// @param depth the bit depth
+	/// @return the number of bytes used by a value
+	///
+	///////////////////////////////////////////////////////////
+	static std::uint32_t getDepthSize(image::bitDepth depth)
+	{
+		return (depth == image::depthU8 || depth == image::depthS8) ? 1 : ((depth == image::depthU16 || depth == image::depthS16) ? 2 : 4);
+	}
+
+	/// \brief Returns a pointer to the first byte of the
+	///         specified row.
+	///
+	/// @param row the row's index
+	/// @return a pointer to the row's first byte
+	///
+	///////////////////////////////////////////////////////////
+	std::uint8_t* getRow(std::uint32_t row) const
+	{
+		return m_pBuffer + (size_t)row * m_rowStride;
+	}
+
+	/// \brief Returns the size of a frame's side once it has
+	///         been reduced by the specified scale.
+	///
+	/// @param size  the size of the frame's side, in pixels
+	/// @param scale the reduction factor
+	/// @return the reduced size, rounded up
+	///
+	///////////////////////////////////////////////////////////
+	static std::uint32_t getScaledSize(std::uint32_t size, std::uint32_t scale)
+	{
+		return (size + scale - 1) / scale;
+	}
+
+	std::uint8_t* m_pBuffer;
+	std::uint32_t m_sizeX;
+	std::uint32_t m_sizeY;
+	std::uint32_t m_channelsNumber;
+	image::bitDepth m_depth;
+	std::uint32_t m_rowStride;
+	std::uint32_t m_scale;
+	std::uint32_t m_left;
+	std::uint32_t m_top;
+	bool m_bRegion;
+	decodeProgress* m_pProgress;
+};
+
+
+///////////////////////////////////////////////////////////
+/// \brief Selects the tags that are loaded by
+///         codec::read().
+///
+/// The tags that are not requested are skipped by using
+///  their length: their content is not read from the
+///  stream and no data or buffer objects are allocated
+///  for them.
+///
+/// When no tag has been added with addTag() then all the
+///  tags are loaded.
+/// The tags in the group 0x0002 (file meta information)
+///  are always loaded, because they are needed to parse
+///  the rest of the stream.
+/// The filter is applied to the tags of the root
+///  dataSet: when a sequence is loaded then all its
+///  items are loaded.
+///
+/// When m_bStopAtPixelData is true then the parsing stops
+///  when the tag 0x7FE0,0x0010 (pixel data) is reached;
+///  the pixel data's position in the stream is stored in
+///  the dataSet (see dataSet::getPixelDataOffset()), so
+///  the images can be loaded later.
+///
+/// Some codecs (e.g. the jpeg codec) ignore the filter.
+///
+///////////////////////////////////////////////////////////
+class parseFilter
+{
+public:
+	/// \brief Build a filter that loads all the tags.
+	///
+	///////////////////////////////////////////////////////////
+	parseFilter(): m_bStopAtPixelData(false){}
+
+	/// \brief Add a tag to the list of the tags to load.
+	///
+	/// @param groupId the tag's group
+	/// @param tagId   the tag's id
+	/// @return a reference to the parseFilter
+	///
+	///////////////////////////////////////////////////////////
+	parseFilter& addTag(std::uint16_t groupId, std::uint16_t tagId)
+	{
+		m_tags.insert(((std::uint32_t)groupId << 16) | (std::uint32_t)tagId);
+		return *this;
+	}
+
+	/// \brief Returns true if the specified tag has to be
+	///         loaded.
+	///
+	/// @param groupId the tag's group
+	/// @param tagId   the tag's id
+	/// @return true if the tag has to be loaded
+	///
+	///////////////////////////////////////////////////////////
+	bool isTagRequested(std::uint16_t groupId, std::uint16_t tagId) const
+	{
+		return m_tags.empty() || groupId == 0x0002 || m_tags.find(((std::uint32_t)groupId << 16) | (std::uint32_t)tagId) != m_tags.end();
+	}
+
+	std::set<std::uint32_t> m_tags;
+	bool m_bStopAtPixelData;
+};
+
+
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 /// \brief This is the base class for all the imebra 
@@ -171,10 +453,12 @@ public:
 	///                 ignore this parameter.
 	///                Set to -1 to load all the buffers 
 	///                 immediatly
+	/// @param pFilter  selects the tags to load. Set to 0
+	///                 to load all the tags
 	/// @return        a pointer to the loaded dataSet
 	///
 	///////////////////////////////////////////////////////////
-	ptr<dataSet> read(ptr<streamReader> pSourceStream, std::uint32_t maxSizeBufferLoad = 0xffffffff);
+	ptr<dataSet> read(ptr<streamReader> pSourceStream, std::uint32_t maxSizeBufferLoad = 0xffffffff, const parseFilter* pFilter = 0);
 
 	/// \brief Write a dicom structure into a stream.
 	///
@@ -230,6 +514,44 @@ public:
 	///
 	///////////////////////////////////////////////////////////
 	virtual ptr<image> getImage(ptr<dataSet> pSourceDataSet, ptr<streamReader> pSourceStream, std::string dataType) = 0;
+
+	/// \brief Decompress an image from a dicom structure
+	///         directly into a buffer allocated by the
+	///         caller.
+	///
+	/// The result is the same as the one returned by
+	///  getImage(), but the pixels are written into the
+	///  buffer described by destination, converted to
+	///  its bit depth, without allocating an intermediate
+	///  image object.
+	///
+	/// The default implementation calls getImage() and
+	///  then copies the result into the destination;
+	///  the codecs override it when they can write the
+	///  decoded pixels straight into the destination.
+	///
+	/// The size and the number of channels of the
+	///  destination must match the image's ones (or, when
+	///  a region has been set, the region must be inside
+	///  the image), otherwise
+	///  codecExceptionWrongDestination is thrown.
+	///
+	/// As for getImage(), the application should call
+	///  dataSet::decodeImage() instead of calling this
+	///  function directly.
+	///
+	/// @param pSourceDataSet a pointer to the Dicom structure 
+	///              where the requested image is embedded into
+	/// @param pSourceStream a pointer to a stream containing
+	///              the data to be parsed
+	/// @param dataType the data type of the buffer from which
+	///               the stream pSourceStream has been 
+	///               obtained
+	/// @param destination the buffer that receives the
+	///               decompressed pixels
+	///
+	///////////////////////////////////////////////////////////
+	virtual void decodeImage(ptr<dataSet> pSourceDataSet, ptr<streamReader> pSourceStream, std::string dataType, const frameDestination& destination);
 	
 	/// \brief This enumeration is used by setImage() in order
 	///         to setup the compression parameters.
@@ -374,8 +696,56 @@ public:
 
 
 protected:
-	virtual void readStream(ptr<streamReader> pInputStream, ptr<dataSet> pDestDataSet, std::uint32_t maxSizeBufferLoad = 0xffffffff) =0;
+	virtual void readStream(ptr<streamReader> pInputStream, ptr<dataSet> pDestDataSet, std::uint32_t maxSizeBufferLoad = 0xffffffff, const parseFilter* pFilter = 0) =0;
 	virtual void writeStream(ptr<streamWriter> pDestStream, ptr<dataSet> pSourceDataSet) =0;
+
+	// Check that the destination can receive an image with
+	//  the specified size and channels, reduced by the
+	//  destination's scale, or the destination's region
+	//  of it
+	///////////////////////////////////////////////////////////
+	static void checkDestination(const frameDestination& destination, std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t channelsNumber);
+
+	// Copy an image into the destination, converting the
+	//  values to the destination's bit depth and reducing
+	//  the resolution by the destination's scale
+	///////////////////////////////////////////////////////////
+	static void copyImageToDestination(ptr<image> pImage, const frameDestination& destination);
+
+	// Copy a block of a decoded channel into the
+	//  destination. The parameters have the same meaning
+	//  of the ones used by
+	//  dataHandlerNumericBase::copyFromInt32Interleaved();
+	//  the block's position is relative to the frame and
+	//  the block is clipped to the destination's region
+	///////////////////////////////////////////////////////////
+	static void copyInt32ToDestination(
+		const std::int32_t* pSource,
+		std::uint32_t sourceReplicateX,
+		std::uint32_t sourceReplicateY,
+		std::uint32_t destStartCol,
+		std::uint32_t destStartRow,
+		std::uint32_t destEndCol,
+		std::uint32_t destEndRow,
+		std::uint32_t destChannel,
+		const frameDestination& destination);
+
+	// Copy a decoded channel into the destination, averaging
+	//  the blocks of pixels that form a destination's pixel.
+	// The channel has sourceSizeX * sourceSizeY values and
+	//  each value covers sourceReplicateX * sourceReplicateY
+	//  pixels of the full resolution frame, which has size
+	//  fullSizeX * fullSizeY
+	///////////////////////////////////////////////////////////
+	static void scaleInt32ToDestination(
+		const std::int32_t* pSource,
+		std::uint32_t sourceSizeX,
+		std::uint32_t sourceReplicateX,
+		std::uint32_t sourceReplicateY,
+		std::uint32_t fullSizeX,
+		std::uint32_t fullSizeY,
+		std::uint32_t destChannel,
+		const frameDestination& destination);
 };
 
 
@@ -506,6 +876,44 @@ public:
 };
 
 
+///////////////////////////////////////////////////////////
+/// \brief This exception is thrown when the buffer passed
+///         to codec::decodeImage() cannot receive the
+///         decompressed image (e.g. its size doesn't match
+///         the image's size).
+///
+///////////////////////////////////////////////////////////
+class codecExceptionWrongDestination: public codecException
+{
+public:
+	/// \brief Build a codecExceptionWrongDestination
+	///         exception.
+	///
+	/// @param message the message to store into the exception
+	///
+	///////////////////////////////////////////////////////////
+	codecExceptionWrongDestination(const std::string& message): codecException(message){}
+};
+
+
+///////////////////////////////////////////////////////////
+/// \brief This exception is thrown when the decoding is
+///         cancelled by the decodeProgress object set in
+///         the frameDestination.
+///
+///////////////////////////////////////////////////////////
+class codecExceptionCancelled: public codecException
+{
+public:
+	/// \brief Build a codecExceptionCancelled exception.
+	///
+	/// @param message the message to store into the exception
+	///
+	///////////////////////////////////////////////////////////
+	codecExceptionCancelled(const std::string& message): codecException(message){}
+};
+
+
 /// @}
 
 } // namespace codecs
@@ -175,11 +175,15 @@ public:
 	///                 ignore this parameter.
 	///                Set to 0xffffffff to load all the 
 	///                 buffers immediatly
+	/// @param pFilter  selects the tags to load (e.g. only
+	///                 a few tags or all the tags before the
+	///                 pixel data). Set to 0 to load all the
+	///                 tags
 	/// @return a pointer to the dataSet containing the parsed
 	///          data
 	///
 	///////////////////////////////////////////////////////////
-	ptr<dataSet> load(ptr<streamReader> pStream, std::uint32_t maxSizeBufferLoad = 0xffffffff);
+	ptr<dataSet> load(ptr<streamReader> pStream, std::uint32_t maxSizeBufferLoad = 0xffffffff, const parseFilter* pFilter = 0);
 
     /// \brief Set the maximum size of the images created by
     ///         the codec::getImage() function.
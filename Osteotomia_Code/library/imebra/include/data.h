@@ -305,7 +305,7 @@ public:
 	///                   into the tag
 	///
 	///////////////////////////////////////////////////////////
-	void setDataSet(std::uint32_t dataSetId, ptr<dataSet> pDataSet);
+	void setDataSet(std::uint32_t dataSetId, const ptr<dataSet>& pDataSet);
 
 	/// \brief Append an embedded dataSet to the sequence.
 	///
@@ -320,7 +320,7 @@ public:
 	///                   into the tag
 	///
 	///////////////////////////////////////////////////////////
-	void appendDataSet(ptr<dataSet> pDataSet);
+	void appendDataSet(const ptr<dataSet>& pDataSet);
 	
 	//@}
 
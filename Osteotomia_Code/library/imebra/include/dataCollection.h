@@ -358,6 +358,25 @@ protected:
 
 		PUNTOEXE_FUNCTION_END();
 	}
+
+	// As getData(), but returns a borrowed pointer and
+	//  doesn't touch the reference counter.
+	// The caller must keep the collection locked for as long
+	//  as it uses the returned pointer: the data is owned by
+	//  the collection and could be replaced once the lock is
+	//  released.
+	///////////////////////////////////////////////////////////
+	collectionType* peekData(std::uint16_t dataId, std::uint16_t order)
+	{
+		std::uint32_t dataUid = (((std::uint32_t)dataId)<<16) | (std::uint32_t)order;
+
+		typename std::map<std::uint32_t, ptr<collectionType> >::iterator findCollection = m_collection.find(dataUid);
+		if(findCollection == m_collection.end())
+		{
+			return 0;
+		}
+		return findCollection->second.get();
+	}
 	
 	// Set the data (tag or group)
 	///////////////////////////////////////////////////////////
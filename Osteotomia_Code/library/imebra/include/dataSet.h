@@ -122,7 +122,7 @@ class dataSet : public dataCollection<dataGroup>
 public:
 	// Costructor
 	///////////////////////////////////////////////////////////
-	dataSet(): dataCollection<dataGroup>(ptr<baseObject>(new baseObject)), m_itemOffset(0) {}
+	dataSet(): dataCollection<dataGroup>(ptr<baseObject>(new baseObject)), m_itemOffset(0), m_pixelDataOffset(0) {}
 
 	///////////////////////////////////////////////////////////
 	/// \name Get/set groups/tags
@@ -236,7 +236,7 @@ public:
 	///                 the data set.
 	///
 	///////////////////////////////////////////////////////////
-	void setGroup(std::uint16_t groupId, std::uint16_t order, ptr<dataGroup> pGroup);
+	void setGroup(std::uint16_t groupId, std::uint16_t order, const ptr<dataGroup>& pGroup);
 
 	//@}
 
@@ -296,6 +296,30 @@ public:
     ///
     ///////////////////////////////////////////////////////////
     ptr<image> getModalityImage(std::uint32_t frameNumber);
+
+	/// \brief Decompress an image directly into a buffer
+	///         allocated by the caller.
+	///
+	/// The pixels are the same returned by getImage(), but
+	///  they are written into the buffer described by
+	///  destination (converted to its bit depth and stored
+	///  with its row stride) instead of being stored in a
+	///  new image object.
+	///
+	/// No transform is applied: the application must apply
+	///  the modality and presentation transforms by itself.
+	///
+	/// The destination's size and channels number must
+	///  match the image's ones, otherwise a
+	///  codecs::codecExceptionWrongDestination is thrown.
+	///
+	/// @param frameNumber The frame number to decompress.
+	///                    The first frame's id is 0
+	/// @param destination the buffer that receives the
+	///                    pixels
+	///
+	///////////////////////////////////////////////////////////
+	void decodeImage(std::uint32_t frameNumber, const codecs::frameDestination& destination);
 	
 	/// \brief Insert an image into the data set.
 	///
@@ -968,7 +992,7 @@ public:
 	///                  been written into the stream
 	///
 	///////////////////////////////////////////////////////////
-	void setItemOffset(std::uint32_t offset);
+	void setItemOffset(std::uint64_t offset);
 
 	/// \brief Retrieve the offset at which the dataSet is
 	///         located in the dicom stream.
@@ -977,7 +1001,43 @@ public:
 	///          in the dicom stream
 	///
 	///////////////////////////////////////////////////////////
-	std::uint32_t getItemOffset();
+	std::uint64_t getItemOffset();
+
+	//@}
+
+
+	///////////////////////////////////////////////////////////
+	/// \name Set/get the pixel data offset.
+	///
+	///////////////////////////////////////////////////////////
+	//@{
+
+	/// \brief Called by codecs::dicomCodec when the parsing
+	///         stops at the pixel data (see
+	///         codecs::parseFilter).
+	///        Tells the dataSet the position of the pixel
+	///         data's tag in the stream
+	///
+	/// @param offset   the position of the pixel data's tag
+	///                  in the stream
+	///
+	///////////////////////////////////////////////////////////
+	void setPixelDataOffset(std::uint64_t offset);
+
+	/// \brief Retrieve the position of the pixel data's tag
+	///         in the dicom stream, when the parsing
+	///         stopped before loading it.
+	///
+	/// A dataSet loaded with codecs::parseFilter::m_bStopAtPixelData
+	///  doesn't contain the images: the application can
+	///  use this offset to load them later.
+	///
+	/// @return the position of the pixel data's tag in the
+	///          dicom stream, or 0 if the pixel data has
+	///          been loaded (or is not present)
+	///
+	///////////////////////////////////////////////////////////
+	std::uint64_t getPixelDataOffset();
 
 	//@}
 
@@ -987,12 +1047,22 @@ protected:
 	///////////////////////////////////////////////////////////
 	ptr<image> convertImageForDataSet(ptr<image> sourceImage);
 
-	std::vector<std::uint32_t> m_imagesPositions;
+	// Decode a frame into a new image or, when pDestination
+	//  is not null, into the specified destination
+	///////////////////////////////////////////////////////////
+	ptr<image> decodeFrame(std::uint32_t frameNumber, const codecs::frameDestination* pDestination);
+
+	std::vector<std::uint64_t> m_imagesPositions;
 
 	// Position of the sequence item in the stream. Used to
 	//  parse DICOMDIR items
 	///////////////////////////////////////////////////////////
-	std::uint32_t m_itemOffset;
+	std::uint64_t m_itemOffset;
+
+	// Position of the pixel data's tag in the stream, when
+	//  the parsing stopped before the pixel data
+	///////////////////////////////////////////////////////////
+	std::uint64_t m_pixelDataOffset;
 };
 
 
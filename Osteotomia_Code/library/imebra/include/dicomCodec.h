@@ -103,6 +103,10 @@ public:
 	///////////////////////////////////////////////////////////
 	virtual ptr<image> getImage(ptr<dataSet> pData, ptr<streamReader> pSourceStream, std::string dataType);
 
+	// Decode an image into a buffer allocated by the caller
+	///////////////////////////////////////////////////////////
+	virtual void decodeImage(ptr<dataSet> pData, ptr<streamReader> pSourceStream, std::string dataType, const frameDestination& destination);
+
 	// Write an image into a dicom structure
 	///////////////////////////////////////////////////////////
 	virtual void setImage(
@@ -165,17 +169,20 @@ public:
 	///                    - >=1 = dataset embedded into 
 	///                      another dataset. This value is
 	///                      used to prevent a stack overflow
+	/// @param pFilter    selects the root dataset's tags to
+	///                    load. Set to 0 to load all the tags
 	///
 	///////////////////////////////////////////////////////////
 	void parseStream(
-		ptr<streamReader> pStream,
-		ptr<dataSet> pDataSet,
+		const ptr<streamReader>& pStream,
+		const ptr<dataSet>& pDataSet,
 		bool bExplicitDataType,
 		streamController::tByteOrdering endianType,
 		std::uint32_t maxSizeBufferLoad = 0xffffffff,
 		std::uint32_t subItemLength = 0xffffffff,
 		std::uint32_t* pReadSubItemLength = 0,
-		std::uint32_t depth = 0);
+		std::uint32_t depth = 0,
+		const parseFilter* pFilter = 0);
 
 	/// \brief Write the dataSet to the specified stream
 	///         in Dicom format, without the file header and
@@ -189,7 +196,7 @@ public:
 	/// @param endianType the endian type to be generated
 	///
 	///////////////////////////////////////////////////////////
-	void buildStream(ptr<streamWriter> pStream, ptr<dataSet> pDataSet, bool bExplicitDataType, streamController::tByteOrdering endianType);
+	void buildStream(const ptr<streamWriter>& pStream, const ptr<dataSet>& pDataSet, bool bExplicitDataType, streamController::tByteOrdering endianType);
 
 	// Returns true if the codec can handle the transfer
 	//  syntax
@@ -217,32 +224,84 @@ protected:
 
 	// Load a dicom stream
 	///////////////////////////////////////////////////////////
-	virtual void readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, std::uint32_t maxSizeBufferLoad = 0xffffffff);
+	virtual void readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, std::uint32_t maxSizeBufferLoad = 0xffffffff, const parseFilter* pFilter = 0);
+
+protected:
+	// Attributes of the image embedded in a dicom structure
+	///////////////////////////////////////////////////////////
+	struct imageAttributes
+	{
+		bool m_bRleCompressed;
+		std::wstring m_colorSpace;
+		std::uint32_t m_channelsNumber;
+		std::uint32_t m_imageSizeX;
+		std::uint32_t m_imageSizeY;
+		bool m_bInterleaved;
+		bool m_b2Complement;
+		std::uint8_t m_allocatedBits;
+		std::uint8_t m_storedBits;
+		std::uint8_t m_highBit;
+		std::uint8_t m_wordSizeBytes;
+		bool m_bSubSampledX;
+		bool m_bSubSampledY;
+		image::bitDepth m_depth;
+		std::uint32_t m_mask;
+	};
+
+	// Read the attributes of the image embedded in a dicom
+	//  structure
+	///////////////////////////////////////////////////////////
+	void readImageAttributes(const ptr<dataSet>& pData, std::string dataType, imageAttributes* pAttributes);
+
+	// Decode the image into the channels m_channels
+	///////////////////////////////////////////////////////////
+	void decodeChannels(const imageAttributes& attributes, streamReader* pSourceStream);
+
+	// Read an uncompressed single channel image directly
+	//  into the destination's rows
+	///////////////////////////////////////////////////////////
+	template<class valueType>
+	void readUncompressedToDestination(const imageAttributes& attributes, streamReader* pSourceStream, const frameDestination& destination);
 
 protected:
 	// Read a single tag
 	///////////////////////////////////////////////////////////
-	std::uint32_t readTag(ptr<streamReader> pStream, ptr<dataSet> pDataSet, std::uint32_t tagLengthDWord, std::uint16_t tagId, std::uint16_t order, std::uint16_t tagSubId, std::string, streamController::tByteOrdering endianType, short wordSize, std::uint32_t bufferId, std::uint32_t maxSizeBufferLoad = 0xffffffff);
+	std::uint32_t readTag(const ptr<streamReader>& pStream, const ptr<dataSet>& pDataSet, std::uint32_t tagLengthDWord, std::uint16_t tagId, std::uint16_t order, std::uint16_t tagSubId, std::string, streamController::tByteOrdering endianType, short wordSize, std::uint32_t bufferId, std::uint32_t maxSizeBufferLoad = 0xffffffff);
+
+	// Skip the content of an undefined length tag, up to
+	//  and including its delimiter, without loading it.
+	// The items of a sequence are skipped tag by tag, the
+	//  fragments of an encapsulated buffer by their length.
+	// Returns the number of skipped bytes
+	///////////////////////////////////////////////////////////
+	std::uint32_t skipUndefinedLength(const ptr<streamReader>& pStream, bool bExplicitDataType, streamController::tByteOrdering endianType, bool bSequence, std::uint32_t depth);
+
+	// Skip the tags of a sequence item, up to its length or
+	//  its delimiter, like parseStream() does: the item
+	//  length written by some encoders is wrong.
+	// Returns the number of skipped bytes
+	///////////////////////////////////////////////////////////
+	std::uint32_t skipItem(const ptr<streamReader>& pStream, bool bExplicitDataType, streamController::tByteOrdering endianType, std::uint32_t itemLength, std::uint32_t depth);
 
 	// Calculate the tag's length
 	///////////////////////////////////////////////////////////
-	std::uint32_t getTagLength(ptr<data> pData, bool bExplicitDataType, std::uint32_t* pHeaderLength, bool *pbSequence);
+	std::uint32_t getTagLength(const ptr<data>& pData, bool bExplicitDataType, std::uint32_t* pHeaderLength, bool *pbSequence);
 
 	// Calculate the group's length
 	///////////////////////////////////////////////////////////
-	std::uint32_t getGroupLength(ptr<dataGroup>, bool bExplicitDataType);
+	std::uint32_t getGroupLength(const ptr<dataGroup>&, bool bExplicitDataType);
 
 	// Calculate the dataset's length
 	///////////////////////////////////////////////////////////
-	std::uint32_t getDataSetLength(ptr<dataSet>, bool bExplicitDataType);
+	std::uint32_t getDataSetLength(const ptr<dataSet>&, bool bExplicitDataType);
 
 	// Write a single group
 	///////////////////////////////////////////////////////////
-	void writeGroup(ptr<streamWriter> pDestStream, ptr<dataGroup> pGroup, std::uint16_t groupId, bool bExplicitDataType, streamController::tByteOrdering endianType);
+	void writeGroup(const ptr<streamWriter>& pDestStream, const ptr<dataGroup>& pGroup, std::uint16_t groupId, bool bExplicitDataType, streamController::tByteOrdering endianType);
 
 	// Write a single tag
 	///////////////////////////////////////////////////////////
-	void writeTag(ptr<streamWriter> pDestStream, ptr<data> pData, std::uint16_t tagId, bool bExplicitDataType, streamController::tByteOrdering endianType);
+	void writeTag(const ptr<streamWriter>& pDestStream, const ptr<data>& pData, std::uint16_t tagId, bool bExplicitDataType, streamController::tByteOrdering endianType);
 
 	// Read an uncompressed interleaved image
 	///////////////////////////////////////////////////////////
@@ -115,6 +115,7 @@ Please note that the file doesn't include the file viewHelper.h.
 #include "../../base/include/memoryStream.h"
 #include "../../base/include/stream.h"
 #include "../../base/include/nullStream.h"
+#include "../../base/include/readAheadStream.h"
 #include "../../base/include/streamReader.h"
 #include "../../base/include/streamWriter.h"
 #include "../../base/include/charsetConversion.h"
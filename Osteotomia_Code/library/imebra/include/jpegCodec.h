@@ -123,6 +123,10 @@ public:
 	///////////////////////////////////////////////////////////
 	virtual ptr<image> getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pStream, std::string dataType);
 
+	// Decode the image into a buffer allocated by the caller
+	///////////////////////////////////////////////////////////
+	virtual void decodeImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pStream, std::string dataType, const frameDestination& destination);
+
 	// Insert a jpeg compressed image into a dataset
 	///////////////////////////////////////////////////////////
 	virtual void setImage(
@@ -167,7 +171,7 @@ protected:
 
 	// Read a jpeg stream and build a Dicom dataset
 	///////////////////////////////////////////////////////////
-	virtual void readStream(ptr<streamReader> pSourceStream, ptr<dataSet> pDataSet, std::uint32_t maxSizeBufferLoad = 0xffffffff);
+	virtual void readStream(ptr<streamReader> pSourceStream, ptr<dataSet> pDataSet, std::uint32_t maxSizeBufferLoad = 0xffffffff, const parseFilter* pFilter = 0);
 
 	// Write a Dicom dataset as a Jpeg stream
 	///////////////////////////////////////////////////////////
@@ -271,6 +275,7 @@ public:
 public:
 	void FDCT(std::int32_t* pIOMatrix, float* pDescaleFactors);
 	void IDCT(std::int32_t* pIOMatrix, long long* pScaleFactors);
+	void scaledIDCT(std::int32_t* pIOMatrix, const std::uint32_t* pQuantizationTable, std::uint32_t outputSize);
 
 protected:
 	/// \internal
@@ -332,7 +337,38 @@ protected:
 	///////////////////////////////////////////////////////////
 	void resetInternal(bool bCompression, quality compQuality);
 
+	// Decode the jpeg stream into the jpeg channels.
+	// When idctScale is 2, 4 or 8 then the lossy blocks are
+	//  decoded with a reduced IDCT.
+	// The lossy blocks outside the region (specified in
+	//  image's pixels, right and bottom excluded) are not
+	//  transformed and the restart intervals outside the
+	//  region are skipped.
+	// pProgress, when not null, receives the progress once
+	//  per row of MCUs and can cancel the decoding.
+	// pDestination, when not null, is checked against the
+	//  frame header before the first scan is decoded
+	///////////////////////////////////////////////////////////
+	void decodeChannels(streamReader* pSourceStream, std::uint32_t idctScale,
+		std::uint32_t regionLeft = 0, std::uint32_t regionTop = 0,
+		std::uint32_t regionRight = 0xffffffff, std::uint32_t regionBottom = 0xffffffff,
+		decodeProgress* pProgress = 0, const frameDestination* pDestination = 0);
+
+	// Skip the entropy coded data until the next tag, which
+	//  is left in the stream
+	///////////////////////////////////////////////////////////
+	void skipEntropyCodedSegment(streamReader* pSourceStream);
+
+	// Retrieve the sign and the color space from the dataset
+	///////////////////////////////////////////////////////////
+	void getImageAttributes(ptr<dataSet> sourceDataSet, bool* pb2complement, std::wstring* pColorSpace);
+
+	// Apply the offset and the sign to the decoded channels
+	///////////////////////////////////////////////////////////
+	void adjustJpegChannels(bool b2complement);
+
 	void copyJpegChannelsToImage(ptr<image> destImage, bool b2complement, std::wstring colorSpace);
+	void copyJpegChannelsToDestination(const frameDestination& destination, bool b2complement, std::uint32_t idctScale);
 	void copyImageToJpegChannels(ptr<image> sourceImage, bool b2complement, std::uint8_t allocatedBits, bool bSubSampledX, bool bSubSampledY);
 
 	void writeScan(streamWriter* pDestinationStream, bool bCalcHuffman);
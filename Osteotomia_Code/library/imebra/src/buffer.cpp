@@ -140,7 +140,7 @@ buffer::buffer(const ptr<baseObject>& externalLock, const std::string& defaultTy
 buffer::buffer(const ptr<baseObject>& externalLock,
 		const std::string& defaultType,
 		const ptr<baseStream>& originalStream,
-		std::uint32_t bufferPosition,
+		std::uint64_t bufferPosition,
 		std::uint32_t bufferLength,
 		std::uint32_t wordLength,
 		streamController::tByteOrdering endianType):
@@ -426,7 +426,7 @@ ptr<handlers::dataHandler> buffer::getDataHandler(bool bWrite, bool bRaw, std::u
 	{
 		handler->m_buffer = this;
 
-		std::uint32_t currentMemorySize(localMemory->size());
+		std::uint32_t currentMemorySize((std::uint32_t)localMemory->size());
                 std::uint32_t newMemorySize(currentMemorySize);
 		if(newMemorySize == 0)
 		{
@@ -507,7 +507,7 @@ ptr<streamReader> buffer::getStreamReader()
 	ptr<handlers::dataHandlerRaw> tempHandlerRaw = getDataHandlerRaw(false);
     if(tempHandlerRaw != 0 && tempHandlerRaw->getSize() != 0)
 	{
-		ptr<baseStream> localStream(new bufferStream(tempHandlerRaw));
+		ptr<baseStream> localStream(new readOnlyBufferStream(tempHandlerRaw));
 		reader = ptr<streamReader>(new streamReader(localStream));
 	}
 
@@ -604,7 +604,7 @@ std::uint32_t buffer::getBufferSizeBytes()
 
 	// Return the memory's size
 	///////////////////////////////////////////////////////////
-	return m_memory->size();
+	return (std::uint32_t)m_memory->size();
 
 	PUNTOEXE_FUNCTION_END();
 }
@@ -641,7 +641,7 @@ void buffer::copyBack(handlers::dataHandler* pDisconnectHandler)
 
 	// The buffer's size must be an even number
 	///////////////////////////////////////////////////////////
-	std::uint32_t memorySize = m_temporaryMemory->size();
+	std::uint32_t memorySize = (std::uint32_t)m_temporaryMemory->size();
 	if((memorySize & 0x1) != 0)
 	{
 		m_temporaryMemory->resize(++memorySize);
@@ -56,6 +56,8 @@ The author can be contacted by email at info@binarno.com or by mail at
 #include "../include/codec.h"
 #include "../include/dataSet.h"
 #include "../include/codecFactory.h"
+#include "../include/image.h"
+#include "../include/dataHandlerNumeric.h"
 #include <string.h>
 
 
@@ -77,7 +79,7 @@ namespace codecs
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-ptr<dataSet> codec::read(ptr<streamReader> pSourceStream, std::uint32_t maxSizeBufferLoad /* = 0xffffffff */)
+ptr<dataSet> codec::read(ptr<streamReader> pSourceStream, std::uint32_t maxSizeBufferLoad /* = 0xffffffff */, const parseFilter* pFilter /* = 0 */)
 {
 	PUNTOEXE_FUNCTION_START(L"codec::read");
 
@@ -87,7 +89,7 @@ ptr<dataSet> codec::read(ptr<streamReader> pSourceStream, std::uint32_t maxSizeB
 
 	// Store the stream's position
 	///////////////////////////////////////////////////////////
-	std::uint32_t position=pSourceStream->position();
+	std::uint64_t position=pSourceStream->position();
 
 	// Create a new dataset
 	///////////////////////////////////////////////////////////
@@ -97,11 +99,11 @@ ptr<dataSet> codec::read(ptr<streamReader> pSourceStream, std::uint32_t maxSizeB
 	///////////////////////////////////////////////////////////
 	try
 	{
-		readStream(pSourceStream, pDestDataSet, maxSizeBufferLoad);
+		readStream(pSourceStream, pDestDataSet, maxSizeBufferLoad, pFilter);
 	}
 	catch(codecExceptionWrongFormat&)
 	{
-		pSourceStream->seek((std::int32_t)position);
+		pSourceStream->seek((std::int64_t)position);
 		PUNTOEXE_RETHROW("Detected a wrong format. Rewinding file");
 	}
 
@@ -140,6 +142,499 @@ void codec::write(ptr<streamWriter> pDestStream, ptr<dataSet> pSourceDataSet)
 }
 
 
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Notify the decoding's progress
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void decodeProgress::update(std::uint32_t done, std::uint32_t total)
+{
+	PUNTOEXE_FUNCTION_START(L"decodeProgress::update");
+
+	if(!onProgress(done, total))
+	{
+		PUNTOEXE_THROW(codecExceptionCancelled, "The decoding has been cancelled");
+	}
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Helpers used to copy the decoded values into a
+//  frameDestination
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+namespace
+{
+
+// Copy the destination's region of a tightly packed
+//  interleaved image into the rows of the destination,
+//  converting the values
+///////////////////////////////////////////////////////////
+template<class sourceType, class destType>
+void copyRowsToDestination(const sourceType* pSource, std::uint32_t sourceSizeX, const frameDestination& destination)
+{
+	const std::uint32_t rowValues(destination.m_sizeX * destination.m_channelsNumber);
+	const std::uint32_t sourceRowValues(sourceSizeX * destination.m_channelsNumber);
+	pSource += ((size_t)destination.m_top * sourceSizeX + destination.m_left) * destination.m_channelsNumber;
+	for(std::uint32_t scanRow(0); scanRow != destination.m_sizeY; ++scanRow, pSource += sourceRowValues)
+	{
+		destType* pDest = (destType*)destination.getRow(scanRow);
+		for(const sourceType* pScanSource(pSource), *pEndRow(pSource + rowValues); pScanSource != pEndRow; ++pScanSource)
+		{
+			*(pDest++) = (destType)*pScanSource;
+		}
+	}
+}
+
+template<class sourceType>
+void copyRowsToDestination(const sourceType* pSource, std::uint32_t sourceSizeX, const frameDestination& destination)
+{
+	switch(destination.m_depth)
+	{
+	case image::depthU8:
+		copyRowsToDestination<sourceType, std::uint8_t>(pSource, sourceSizeX, destination);
+		break;
+	case image::depthS8:
+		copyRowsToDestination<sourceType, std::int8_t>(pSource, sourceSizeX, destination);
+		break;
+	case image::depthU16:
+		copyRowsToDestination<sourceType, std::uint16_t>(pSource, sourceSizeX, destination);
+		break;
+	case image::depthS16:
+		copyRowsToDestination<sourceType, std::int16_t>(pSource, sourceSizeX, destination);
+		break;
+	case image::depthU32:
+		copyRowsToDestination<sourceType, std::uint32_t>(pSource, sourceSizeX, destination);
+		break;
+	case image::depthS32:
+		copyRowsToDestination<sourceType, std::int32_t>(pSource, sourceSizeX, destination);
+		break;
+	default:
+		throw codecExceptionWrongDestination("Unknown destination depth");
+	}
+}
+
+// Copy a channel into the destination, averaging the
+//  blocks of pixels that form each destination's pixel.
+// Only the destination's region is calculated.
+// Each source value covers sourceReplicateX *
+//  sourceReplicateY pixels of the full resolution frame
+//  and the source values of the channel are
+//  sourceStep values apart
+///////////////////////////////////////////////////////////
+template<class sourceType, class destType>
+void scaleToDestination(
+	const sourceType* pSource,
+	std::uint32_t sourceRowLength,
+	std::uint32_t sourceStep,
+	std::uint32_t sourceReplicateX,
+	std::uint32_t sourceReplicateY,
+	std::uint32_t fullSizeX,
+	std::uint32_t fullSizeY,
+	std::uint32_t destChannel,
+	const frameDestination& destination)
+{
+	const std::uint32_t scale(destination.m_scale);
+	const std::uint32_t numChannels(destination.m_channelsNumber);
+	for(std::uint32_t scanRow(0); scanRow != destination.m_sizeY; ++scanRow)
+	{
+		std::uint32_t startY((destination.m_top + scanRow) * scale);
+		std::uint32_t endY(startY + scale > fullSizeY ? fullSizeY : startY + scale);
+		destType* pDest = (destType*)destination.getRow(scanRow) + destChannel;
+		for(std::uint32_t scanCol(0); scanCol != destination.m_sizeX; ++scanCol, pDest += numChannels)
+		{
+			std::uint32_t startX((destination.m_left + scanCol) * scale);
+			std::uint32_t endX(startX + scale > fullSizeX ? fullSizeX : startX + scale);
+
+			long long total(0);
+			for(std::uint32_t scanY(startY); scanY < endY; ++scanY)
+			{
+				const sourceType* pSourceRow(pSource + (size_t)(scanY / sourceReplicateY) * sourceRowLength);
+				for(std::uint32_t scanX(startX); scanX < endX; ++scanX)
+				{
+					total += (long long)pSourceRow[(scanX / sourceReplicateX) * sourceStep];
+				}
+			}
+
+			// Round to the nearest value
+			///////////////////////////////////////////////////////////
+			long long count((long long)(endY - startY) * (long long)(endX - startX));
+			if(count == 0)
+			{
+				continue;
+			}
+			*pDest = (destType)(total >= 0 ? (total + count / 2) / count : -((count / 2 - total) / count));
+		}
+	}
+}
+
+template<class sourceType>
+void scaleToDestination(
+	const sourceType* pSource,
+	std::uint32_t sourceRowLength,
+	std::uint32_t sourceStep,
+	std::uint32_t sourceReplicateX,
+	std::uint32_t sourceReplicateY,
+	std::uint32_t fullSizeX,
+	std::uint32_t fullSizeY,
+	std::uint32_t destChannel,
+	const frameDestination& destination)
+{
+	switch(destination.m_depth)
+	{
+	case image::depthU8:
+		scaleToDestination<sourceType, std::uint8_t>(pSource, sourceRowLength, sourceStep, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+		break;
+	case image::depthS8:
+		scaleToDestination<sourceType, std::int8_t>(pSource, sourceRowLength, sourceStep, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+		break;
+	case image::depthU16:
+		scaleToDestination<sourceType, std::uint16_t>(pSource, sourceRowLength, sourceStep, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+		break;
+	case image::depthS16:
+		scaleToDestination<sourceType, std::int16_t>(pSource, sourceRowLength, sourceStep, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+		break;
+	case image::depthU32:
+		scaleToDestination<sourceType, std::uint32_t>(pSource, sourceRowLength, sourceStep, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+		break;
+	case image::depthS32:
+		scaleToDestination<sourceType, std::int32_t>(pSource, sourceRowLength, sourceStep, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+		break;
+	default:
+		throw codecExceptionWrongDestination("Unknown destination depth");
+	}
+}
+
+// Copy an interleaved image into the destination,
+//  reducing its resolution
+///////////////////////////////////////////////////////////
+template<class sourceType>
+void scaleImageToDestination(const sourceType* pSource, std::uint32_t sizeX, std::uint32_t sizeY, const frameDestination& destination)
+{
+	const std::uint32_t channelsNumber(destination.m_channelsNumber);
+	for(std::uint32_t scanChannel(0); scanChannel != channelsNumber; ++scanChannel)
+	{
+		scaleToDestination(pSource + scanChannel, sizeX * channelsNumber, channelsNumber, 1, 1, sizeX, sizeY, scanChannel, destination);
+	}
+}
+
+// Copy a block of a channel into the destination,
+//  replicating the subsampled values.
+// The block's position is relative to the frame: only
+//  the part inside the destination's region is copied
+///////////////////////////////////////////////////////////
+template<class destType>
+void copyInt32BlockToDestination(
+	const std::int32_t* pSource,
+	std::uint32_t sourceReplicateX,
+	std::uint32_t sourceReplicateY,
+	std::uint32_t destStartCol,
+	std::uint32_t destStartRow,
+	std::uint32_t destEndCol,
+	std::uint32_t destEndRow,
+	std::uint32_t destChannel,
+	const frameDestination& destination)
+{
+	// The source's row length is calculated before clipping
+	//  the block to the destination's size
+	///////////////////////////////////////////////////////////
+	const std::uint32_t sourceRowLength((destEndCol - destStartCol) / sourceReplicateX);
+
+	// Clip the block to the destination's region
+	///////////////////////////////////////////////////////////
+	const std::uint32_t regionEndCol(destination.m_left + destination.m_sizeX);
+	const std::uint32_t regionEndRow(destination.m_top + destination.m_sizeY);
+	if(destEndRow > regionEndRow)
+	{
+		destEndRow = regionEndRow;
+	}
+	if(destEndCol > regionEndCol)
+	{
+		destEndCol = regionEndCol;
+	}
+	const std::uint32_t firstRow(destStartRow > destination.m_top ? destStartRow : destination.m_top);
+	const std::uint32_t firstCol(destStartCol > destination.m_left ? destStartCol : destination.m_left);
+	if(firstRow >= destEndRow || firstCol >= destEndCol)
+	{
+		return;
+	}
+
+	// Skip the source values that are outside the region
+	///////////////////////////////////////////////////////////
+	pSource += (size_t)((firstRow - destStartRow) / sourceReplicateY) * sourceRowLength + (firstCol - destStartCol) / sourceReplicateX;
+	const std::uint32_t firstReplicateXCount(sourceReplicateX - (firstCol - destStartCol) % sourceReplicateX);
+
+	const std::uint32_t numChannels(destination.m_channelsNumber);
+	std::uint32_t replicateYCount(sourceReplicateY - (firstRow - destStartRow) % sourceReplicateY);
+	for(std::uint32_t scanRow(firstRow); scanRow < destEndRow; ++scanRow)
+	{
+		destType* pDest = (destType*)destination.getRow(scanRow - destination.m_top) + (firstCol - destination.m_left) * numChannels + destChannel;
+		const std::int32_t* pSourceScan(pSource);
+		std::uint32_t replicateXCount(firstReplicateXCount);
+		for(std::uint32_t scanCol(firstCol); scanCol < destEndCol; ++scanCol)
+		{
+			*pDest = (destType)*pSourceScan;
+			pDest += numChannels;
+			if(--replicateXCount == 0)
+			{
+				replicateXCount = sourceReplicateX;
+				++pSourceScan;
+			}
+		}
+		if(--replicateYCount == 0)
+		{
+			replicateYCount = sourceReplicateY;
+			pSource += sourceRowLength;
+		}
+	}
+}
+
+} // namespace
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Decode an image into a buffer allocated by the caller
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void codec::decodeImage(ptr<dataSet> pSourceDataSet, ptr<streamReader> pSourceStream, std::string dataType, const frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"codec::decodeImage");
+
+	// The whole image is decoded in one step
+	///////////////////////////////////////////////////////////
+	destination.updateProgress(0, 1);
+	copyImageToDestination(getImage(pSourceDataSet, pSourceStream, dataType), destination);
+	destination.updateProgress(1, 1);
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Check the destination's size
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void codec::checkDestination(const frameDestination& destination, std::uint32_t sizeX, std::uint32_t sizeY, std::uint32_t channelsNumber)
+{
+	PUNTOEXE_FUNCTION_START(L"codec::checkDestination");
+
+	if(destination.m_pBuffer == 0)
+	{
+		PUNTOEXE_THROW(codecExceptionWrongDestination, "The destination buffer is not allocated");
+	}
+
+	const std::uint32_t scaledSizeX(frameDestination::getScaledSize(sizeX, destination.m_scale));
+	const std::uint32_t scaledSizeY(frameDestination::getScaledSize(sizeY, destination.m_scale));
+	if(destination.m_channelsNumber != channelsNumber)
+	{
+		PUNTOEXE_THROW(codecExceptionWrongDestination, "The destination's channels number doesn't match the image");
+	}
+
+	// A region must be inside the image, otherwise the
+	//  destination must have the same size of the image
+	///////////////////////////////////////////////////////////
+	if(destination.m_bRegion)
+	{
+		if(destination.m_left >= scaledSizeX || destination.m_sizeX > scaledSizeX - destination.m_left ||
+			destination.m_top >= scaledSizeY || destination.m_sizeY > scaledSizeY - destination.m_top)
+		{
+			PUNTOEXE_THROW(codecExceptionWrongDestination, "The destination's region is outside the image");
+		}
+	}
+	else if(destination.m_sizeX != scaledSizeX || destination.m_sizeY != scaledSizeY)
+	{
+		PUNTOEXE_THROW(codecExceptionWrongDestination, "The destination's size doesn't match the image");
+	}
+
+	if(destination.m_rowStride < destination.m_sizeX * channelsNumber * frameDestination::getDepthSize(destination.m_depth))
+	{
+		PUNTOEXE_THROW(codecExceptionWrongDestination, "The destination's row stride is too small");
+	}
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Copy an image into the destination
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void codec::copyImageToDestination(ptr<image> pImage, const frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"codec::copyImageToDestination");
+
+	std::uint32_t sizeX, sizeY;
+	pImage->getSize(&sizeX, &sizeY);
+
+	std::uint32_t rowSize, channelPixelSize, channelsNumber;
+	ptr<handlers::dataHandlerNumericBase> handler = pImage->getDataHandler(false, &rowSize, &channelPixelSize, &channelsNumber);
+
+	checkDestination(destination, sizeX, sizeY, channelsNumber);
+
+	const std::uint8_t* pSource = handler->getMemoryBuffer();
+
+	// Reduce the resolution
+	///////////////////////////////////////////////////////////
+	if(destination.m_scale != 1)
+	{
+		switch(pImage->getDepth())
+		{
+		case image::depthU8:
+			scaleImageToDestination((const std::uint8_t*)pSource, sizeX, sizeY, destination);
+			break;
+		case image::depthS8:
+			scaleImageToDestination((const std::int8_t*)pSource, sizeX, sizeY, destination);
+			break;
+		case image::depthU16:
+			scaleImageToDestination((const std::uint16_t*)pSource, sizeX, sizeY, destination);
+			break;
+		case image::depthS16:
+			scaleImageToDestination((const std::int16_t*)pSource, sizeX, sizeY, destination);
+			break;
+		case image::depthU32:
+			scaleImageToDestination((const std::uint32_t*)pSource, sizeX, sizeY, destination);
+			break;
+		case image::depthS32:
+			scaleImageToDestination((const std::int32_t*)pSource, sizeX, sizeY, destination);
+			break;
+		default:
+			PUNTOEXE_THROW(codecExceptionWrongDestination, "Unknown image depth");
+		}
+		return;
+	}
+
+	switch(pImage->getDepth())
+	{
+	case image::depthU8:
+		copyRowsToDestination((const std::uint8_t*)pSource, sizeX, destination);
+		break;
+	case image::depthS8:
+		copyRowsToDestination((const std::int8_t*)pSource, sizeX, destination);
+		break;
+	case image::depthU16:
+		copyRowsToDestination((const std::uint16_t*)pSource, sizeX, destination);
+		break;
+	case image::depthS16:
+		copyRowsToDestination((const std::int16_t*)pSource, sizeX, destination);
+		break;
+	case image::depthU32:
+		copyRowsToDestination((const std::uint32_t*)pSource, sizeX, destination);
+		break;
+	case image::depthS32:
+		copyRowsToDestination((const std::int32_t*)pSource, sizeX, destination);
+		break;
+	default:
+		PUNTOEXE_THROW(codecExceptionWrongDestination, "Unknown image depth");
+	}
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Copy a block of a decoded channel into the destination
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void codec::copyInt32ToDestination(
+	const std::int32_t* pSource,
+	std::uint32_t sourceReplicateX,
+	std::uint32_t sourceReplicateY,
+	std::uint32_t destStartCol,
+	std::uint32_t destStartRow,
+	std::uint32_t destEndCol,
+	std::uint32_t destEndRow,
+	std::uint32_t destChannel,
+	const frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"codec::copyInt32ToDestination");
+
+	switch(destination.m_depth)
+	{
+	case image::depthU8:
+		copyInt32BlockToDestination<std::uint8_t>(pSource, sourceReplicateX, sourceReplicateY, destStartCol, destStartRow, destEndCol, destEndRow, destChannel, destination);
+		break;
+	case image::depthS8:
+		copyInt32BlockToDestination<std::int8_t>(pSource, sourceReplicateX, sourceReplicateY, destStartCol, destStartRow, destEndCol, destEndRow, destChannel, destination);
+		break;
+	case image::depthU16:
+		copyInt32BlockToDestination<std::uint16_t>(pSource, sourceReplicateX, sourceReplicateY, destStartCol, destStartRow, destEndCol, destEndRow, destChannel, destination);
+		break;
+	case image::depthS16:
+		copyInt32BlockToDestination<std::int16_t>(pSource, sourceReplicateX, sourceReplicateY, destStartCol, destStartRow, destEndCol, destEndRow, destChannel, destination);
+		break;
+	case image::depthU32:
+		copyInt32BlockToDestination<std::uint32_t>(pSource, sourceReplicateX, sourceReplicateY, destStartCol, destStartRow, destEndCol, destEndRow, destChannel, destination);
+		break;
+	case image::depthS32:
+		copyInt32BlockToDestination<std::int32_t>(pSource, sourceReplicateX, sourceReplicateY, destStartCol, destStartRow, destEndCol, destEndRow, destChannel, destination);
+		break;
+	default:
+		PUNTOEXE_THROW(codecExceptionWrongDestination, "Unknown destination depth");
+	}
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Copy a decoded channel into the destination, reducing
+//  its resolution
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void codec::scaleInt32ToDestination(
+	const std::int32_t* pSource,
+	std::uint32_t sourceSizeX,
+	std::uint32_t sourceReplicateX,
+	std::uint32_t sourceReplicateY,
+	std::uint32_t fullSizeX,
+	std::uint32_t fullSizeY,
+	std::uint32_t destChannel,
+	const frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"codec::scaleInt32ToDestination");
+
+	scaleToDestination(pSource, sourceSizeX, 1, sourceReplicateX, sourceReplicateY, fullSizeX, fullSizeY, destChannel, destination);
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 //
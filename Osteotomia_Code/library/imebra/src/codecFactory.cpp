@@ -181,7 +181,7 @@ ptr<codecFactory> codecFactory::getCodecFactory()
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-ptr<dataSet> codecFactory::load(ptr<streamReader> pStream, std::uint32_t maxSizeBufferLoad /* = 0xffffffff */)
+ptr<dataSet> codecFactory::load(ptr<streamReader> pStream, std::uint32_t maxSizeBufferLoad /* = 0xffffffff */, const parseFilter* pFilter /* = 0 */)
 {
 	PUNTOEXE_FUNCTION_START(L"codecFactory::load");
 
@@ -204,7 +204,7 @@ ptr<dataSet> codecFactory::load(ptr<streamReader> pStream, std::uint32_t maxSize
 	{
 		try
 		{
-			return (*scanCodecs)->read(pStream, maxSizeBufferLoad);
+			return (*scanCodecs)->read(pStream, maxSizeBufferLoad, pFilter);
 		}
 		catch(codecExceptionWrongFormat& /* e */)
 		{
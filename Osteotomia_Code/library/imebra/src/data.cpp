@@ -481,7 +481,7 @@ ptr<dataSet> data::getDataSet(std::uint32_t dataSetId)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void data::setDataSet(std::uint32_t dataSetId, ptr<dataSet> pDataSet)
+void data::setDataSet(std::uint32_t dataSetId, const ptr<dataSet>& pDataSet)
 {
 	PUNTOEXE_FUNCTION_START(L"data::setDataSet");
 
@@ -508,7 +508,7 @@ void data::setDataSet(std::uint32_t dataSetId, ptr<dataSet> pDataSet)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void data::appendDataSet(ptr<dataSet> pDataSet)
+void data::appendDataSet(const ptr<dataSet>& pDataSet)
 {
 	PUNTOEXE_FUNCTION_START(L"data::appendDataSet");
 
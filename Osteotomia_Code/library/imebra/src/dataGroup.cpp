@@ -121,7 +121,11 @@ ptr<handlers::dataHandler> dataGroup::getDataHandler(std::uint16_t tagId, std::u
 
 	lockObject lockAccess(this);
 
-	ptr<data> tag=getTag(tagId, bWrite);
+	data* tag = peekData(tagId, 0);
+	if(tag == 0 && bWrite)
+	{
+		tag = getTag(tagId, true).get();
+	}
 
 	if(tag == 0)
 	{
@@ -209,7 +213,11 @@ ptr<handlers::dataHandlerRaw> dataGroup::getDataHandlerRaw(std::uint16_t tagId,
 
 	lockObject lockAccess(this);
 
-	ptr<data> tag=getTag(tagId, bWrite);
+	data* tag = peekData(tagId, 0);
+	if(tag == 0 && bWrite)
+	{
+		tag = getTag(tagId, true).get();
+	}
 
 	if(tag == 0)
 	{
@@ -236,8 +244,10 @@ std::string dataGroup::getDataType(std::uint16_t tagId)
 {
 	PUNTOEXE_FUNCTION_START(L"dataGroup::getDataType");
 
+	lockObject lockAccess(this);
+
 	std::string bufferType;
-	ptr<data> tag = getTag(tagId, false);
+	data* tag = peekData(tagId, 0);
 	if(tag != 0)
 	{
 		bufferType = tag->getDataType();
@@ -98,7 +98,7 @@ void dataHandlerString::parseBuffer(const ptr<memory>& memoryBuffer)
 	// Convert the string to unicode
 	///////////////////////////////////////////////////////////
 	std::wstring tempBufferUnicode;
-	std::uint32_t tempBufferSize(memoryBuffer->size());
+	std::uint32_t tempBufferSize((std::uint32_t)memoryBuffer->size());
 	if(tempBufferSize != 0)
 	{
 		tempBufferUnicode = convertToUnicode(std::string((char*)(memoryBuffer->data()), tempBufferSize));
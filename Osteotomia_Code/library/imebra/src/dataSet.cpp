@@ -159,7 +159,7 @@ ptr<dataGroup> dataSet::getGroup(std::uint16_t groupId, std::uint16_t order, boo
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dataSet::setGroup(std::uint16_t groupId, std::uint16_t order, ptr<dataGroup> pGroup)
+void dataSet::setGroup(std::uint16_t groupId, std::uint16_t order, const ptr<dataGroup>& pGroup)
 {
 	PUNTOEXE_FUNCTION_START(L"dataSet::setGroup");
 
@@ -182,6 +182,46 @@ ptr<image> dataSet::getImage(std::uint32_t frameNumber)
 {
 	PUNTOEXE_FUNCTION_START(L"dataSet::getImage");
 
+	return decodeFrame(frameNumber, 0);
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Decompress the image into a buffer allocated by the
+//  caller
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void dataSet::decodeImage(std::uint32_t frameNumber, const codecs::frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"dataSet::decodeImage");
+
+	decodeFrame(frameNumber, &destination);
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Decode a frame into an image or into a destination
+//  buffer
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+ptr<image> dataSet::decodeFrame(std::uint32_t frameNumber, const codecs::frameDestination* pDestination)
+{
+	PUNTOEXE_FUNCTION_START(L"dataSet::decodeFrame");
+
 	// Lock this object
 	///////////////////////////////////////////////////////////
 	lockObject lockAccess(this);
@@ -263,7 +303,7 @@ ptr<image> dataSet::getImage(std::uint32_t frameNumber)
 					::memcpy((void*)pDest, (void*)pSource, bufferHandler->getSize());
 					pDest += bufferHandler->getSize();
 				}
-				ptr<baseStream> compositeStream(new memoryStream(temporaryMemory));
+				ptr<baseStream> compositeStream(new readOnlyMemoryStream(temporaryMemory));
 				imageStream = ptr<streamReader>(new streamReader(compositeStream));
 			}
 			bDontNeedImagesPositions = true;
@@ -310,7 +350,7 @@ ptr<image> dataSet::getImage(std::uint32_t frameNumber)
 		///////////////////////////////////////////////////////////
 		for(std::uint32_t readImages = 0; readImages < frameNumber; readImages++)
 		{
-			std::uint32_t offsetPosition = m_imagesPositions[readImages];
+			std::uint64_t offsetPosition = m_imagesPositions[readImages];
 			if(offsetPosition == 0)
 			{
 				ptr<image> tempImage = pCodec->getImage(this, imageStream, imageStreamDataType);
@@ -319,7 +359,7 @@ ptr<image> dataSet::getImage(std::uint32_t frameNumber)
 			}
 			if((m_imagesPositions[readImages + 1] == 0) || (readImages == (frameNumber - 1)))
 			{
-				imageStream->seek(offsetPosition);
+				imageStream->seek((std::int64_t)offsetPosition);
 			}
 		}
 	}
@@ -332,9 +372,19 @@ ptr<image> dataSet::getImage(std::uint32_t frameNumber)
 	}
 
 	ptr<image> pImage;
-	pImage = pCodec->getImage(this, imageStream, imageStreamDataType);
+	if(pDestination != 0)
+	{
+		pCodec->decodeImage(this, imageStream, imageStreamDataType, *pDestination);
+	}
+	else
+	{
+		pImage = pCodec->getImage(this, imageStream, imageStreamDataType);
+	}
 
-	if(!bDontNeedImagesPositions && m_imagesPositions.size() > frameNumber)
+	// A region is decoded without reading the whole frame:
+	//  the stream's position is not the next frame's one
+	///////////////////////////////////////////////////////////
+	if(!bDontNeedImagesPositions && m_imagesPositions.size() > frameNumber && (pDestination == 0 || !pDestination->m_bRegion))
 	{
 		m_imagesPositions[frameNumber] = imageStream->position();
 	}
@@ -349,7 +399,7 @@ ptr<image> dataSet::getImage(std::uint32_t frameNumber)
 		pImage->setSizeMm(pixelDistanceX*(double)sizeX, pixelDistanceY*(double)sizeY);
 	}
 
-	if(pImage->getColorSpace() == L"PALETTE COLOR")
+	if(pImage != 0 && pImage->getColorSpace() == L"PALETTE COLOR")
 	{
 		ptr<lut> red(new lut), green(new lut), blue(new lut);
 		red->setLut(getDataHandler(0x0028, 0x0, 0x1101, 0, false), getDataHandler(0x0028, 0x0, 0x1201, 0, false), L"");
@@ -1325,7 +1375,14 @@ ptr<handlers::dataHandler> dataSet::getDataHandler(std::uint16_t groupId, std::u
 
 	lockObject lockAccess(this);
 
-	ptr<dataGroup>	group=getGroup(groupId, order, bWrite);
+	// The groups share the dataSet's lock, so a borrowed
+	//  pointer stays valid until the function returns
+	///////////////////////////////////////////////////////////
+	dataGroup* group = peekData(groupId, order);
+	if(group == 0 && bWrite)
+	{
+		group = getGroup(groupId, order, true).get();
+	}
 
 	ptr<handlers::dataHandler> pDataHandler;
 
@@ -1421,7 +1478,11 @@ ptr<handlers::dataHandlerRaw> dataSet::getDataHandlerRaw(std::uint16_t groupId,
 
 	lockObject lockAccess(this);
 
-	ptr<dataGroup>	group=getGroup(groupId, order, bWrite);
+	dataGroup* group = peekData(groupId, order);
+	if(group == 0 && bWrite)
+	{
+		group = getGroup(groupId, order, true).get();
+	}
 
 	if(group == 0)
 	{
@@ -1472,12 +1533,14 @@ std::string dataSet::getDataType(std::uint16_t groupId, std::uint16_t order, std
 {
 	PUNTOEXE_FUNCTION_START(L"dataSet::getDataType");
 
+	lockObject lockAccess(this);
+
 	std::string bufferType;
 
-	ptr<data> tag = getTag(groupId, order, tagId, false);
-	if(tag != 0)
+	dataGroup* group = peekData(groupId, order);
+	if(group != 0)
 	{
-		bufferType = tag->getDataType();
+		bufferType = group->getDataType(tagId);
 	}
 	return bufferType;
 
@@ -1531,7 +1594,7 @@ void dataSet::updateTagsCharset()
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dataSet::setItemOffset(std::uint32_t offset)
+void dataSet::setItemOffset(std::uint64_t offset)
 {
 	m_itemOffset = offset;
 }
@@ -1546,12 +1609,42 @@ void dataSet::setItemOffset(std::uint32_t offset)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t dataSet::getItemOffset()
+std::uint64_t dataSet::getItemOffset()
 {
 	return m_itemOffset;
 }
 
 
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Set the pixel data's position in the stream
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void dataSet::setPixelDataOffset(std::uint64_t offset)
+{
+	m_pixelDataOffset = offset;
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Get the pixel data's position in the stream
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint64_t dataSet::getPixelDataOffset()
+{
+	return m_pixelDataOffset;
+}
+
+
 } // namespace imebra
 
 } // namespace puntoexe
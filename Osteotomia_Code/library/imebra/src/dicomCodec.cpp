@@ -159,7 +159,7 @@ void dicomCodec::writeStream(ptr<streamWriter> pStream, ptr<dataSet> pDataSet)
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dicomCodec::buildStream(ptr<streamWriter> pStream, ptr<dataSet> pDataSet, bool bExplicitDataType, streamController::tByteOrdering endianType)
+void dicomCodec::buildStream(const ptr<streamWriter>& pStream, const ptr<dataSet>& pDataSet, bool bExplicitDataType, streamController::tByteOrdering endianType)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::buildStream");
 
@@ -186,7 +186,7 @@ void dicomCodec::buildStream(ptr<streamWriter> pStream, ptr<dataSet> pDataSet, b
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dicomCodec::writeGroup(ptr<streamWriter> pDestStream, ptr<dataGroup> pGroup, std::uint16_t groupId, bool bExplicitDataType, streamController::tByteOrdering endianType)
+void dicomCodec::writeGroup(const ptr<streamWriter>& pDestStream, const ptr<dataGroup>& pGroup, std::uint16_t groupId, bool bExplicitDataType, streamController::tByteOrdering endianType)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::writeGroup");
 
@@ -255,7 +255,7 @@ void dicomCodec::writeGroup(ptr<streamWriter> pDestStream, ptr<dataGroup> pGroup
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dicomCodec::writeTag(ptr<streamWriter> pDestStream, ptr<data> pData, std::uint16_t tagId, bool bExplicitDataType, streamController::tByteOrdering endianType)
+void dicomCodec::writeTag(const ptr<streamWriter>& pDestStream, const ptr<data>& pData, std::uint16_t tagId, bool bExplicitDataType, streamController::tByteOrdering endianType)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::writeTag");
 
@@ -414,7 +414,7 @@ void dicomCodec::writeTag(ptr<streamWriter> pDestStream, ptr<data> pData, std::u
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t dicomCodec::getTagLength(ptr<data> pData, bool bExplicitDataType, std::uint32_t* pHeaderLength, bool *pbSequence)
+std::uint32_t dicomCodec::getTagLength(const ptr<data>& pData, bool bExplicitDataType, std::uint32_t* pHeaderLength, bool *pbSequence)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::getTagLength");
 
@@ -428,7 +428,6 @@ std::uint32_t dicomCodec::getTagLength(ptr<data> pData, bool bExplicitDataType,
 		if(pDataSet != 0)
 		{
 			totalLength += getDataSetLength(pDataSet, bExplicitDataType);
-			totalLength += 8; // item tag and item length
 			*pbSequence = true;
 			continue;
 		}
@@ -470,7 +469,7 @@ std::uint32_t dicomCodec::getTagLength(ptr<data> pData, bool bExplicitDataType,
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t dicomCodec::getGroupLength(ptr<dataGroup> pDataGroup, bool bExplicitDataType)
+std::uint32_t dicomCodec::getGroupLength(const ptr<dataGroup>& pDataGroup, bool bExplicitDataType)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::getGroupLength");
 
@@ -506,7 +505,7 @@ std::uint32_t dicomCodec::getGroupLength(ptr<dataGroup> pDataGroup, bool bExplic
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-std::uint32_t dicomCodec::getDataSetLength(ptr<dataSet> pDataSet, bool bExplicitDataType)
+std::uint32_t dicomCodec::getDataSetLength(const ptr<dataSet>& pDataSet, bool bExplicitDataType)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::getDataSetLength");
 
@@ -516,13 +515,11 @@ std::uint32_t dicomCodec::getDataSetLength(ptr<dataSet> pDataSet, bool bExplicit
 
 	while(pIterator->isValid())
 	{
-		totalLength += getGroupLength(pIterator->getData(), bExplicitDataType);
+		// The group 2 is always written with explicit data types
+		///////////////////////////////////////////////////////////
+		totalLength += getGroupLength(pIterator->getData(), bExplicitDataType || pIterator->getId() == 2);
 		totalLength += 4; // Add space for the tag 0
-		if(bExplicitDataType) // Add space for the data type
-		{
-			totalLength += 2;
-		}
-		totalLength += 2; // Add space for the tag's length
+		totalLength += 4; // Add space for the data type and the tag's length (explicit) or the tag's length (implicit)
 		totalLength += 4; // Add space for the group's length
 
 		pIterator->incIterator();
@@ -543,13 +540,13 @@ std::uint32_t dicomCodec::getDataSetLength(ptr<dataSet> pDataSet, bool bExplicit
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dicomCodec::readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, std::uint32_t maxSizeBufferLoad /* = 0xffffffff */)
+void dicomCodec::readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, std::uint32_t maxSizeBufferLoad /* = 0xffffffff */, const parseFilter* pFilter /* = 0 */)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::readStream");
 
 	// Save the starting position
 	///////////////////////////////////////////////////////////
-	std::uint32_t position=pStream->position();
+	std::uint64_t position=pStream->position();
 
 	// This flag signals a failure
 	///////////////////////////////////////////////////////////
@@ -600,7 +597,7 @@ void dicomCodec::readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, st
 
 		// Go back to the beginning of the file
 		///////////////////////////////////////////////////////////
-		pStream->seek((std::int32_t)position);
+		pStream->seek((std::int64_t)position);
 
 		// Set "explicit data type" to true if a valid data type
                 //  is found
@@ -613,7 +610,7 @@ void dicomCodec::readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, st
 
 	// Signature OK. Now scan all the tags.
 	///////////////////////////////////////////////////////////
-	parseStream(pStream, pDataSet, bExplicitDataType, endianType, maxSizeBufferLoad);
+	parseStream(pStream, pDataSet, bExplicitDataType, endianType, maxSizeBufferLoad, 0xffffffff, 0, 0, pFilter);
 
 	PUNTOEXE_FUNCTION_END();
 }
@@ -627,14 +624,15 @@ void dicomCodec::readStream(ptr<streamReader> pStream, ptr<dataSet> pDataSet, st
 //
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
-void dicomCodec::parseStream(ptr<streamReader> pStream,
-							 ptr<dataSet> pDataSet,
+void dicomCodec::parseStream(const ptr<streamReader>& pStream,
+							 const ptr<dataSet>& pDataSet,
 							 bool bExplicitDataType,
 							 streamController::tByteOrdering endianType,
 							 std::uint32_t maxSizeBufferLoad /* = 0xffffffff */,
 							 std::uint32_t subItemLength /* = 0xffffffff */,
 							 std::uint32_t* pReadSubItemLength /* = 0 */,
-							 std::uint32_t depth)
+							 std::uint32_t depth /* = 0 */,
+							 const parseFilter* pFilter /* = 0 */)
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::parseStream");
 
@@ -676,6 +674,11 @@ void dicomCodec::parseStream(ptr<streamReader> pStream,
 	///////////////////////////////////////////////////////////
 	while(!bStopped && !pStream->endReached() && (*pReadSubItemLength < subItemLength))
 	{
+		// Remember the tag's position (used when the parsing
+		//  stops at the pixel data)
+		///////////////////////////////////////////////////////////
+		std::uint64_t tagOffset(pStream->getControlledStreamPosition());
+
 		// Get the tag's ID
 		///////////////////////////////////////////////////////////
 		pStream->read((std::uint8_t*)&tagId, sizeof(tagId));
@@ -874,6 +877,39 @@ void dicomCodec::parseStream(ptr<streamReader> pStream,
 		lastGroupId=tagId;
 		lastTagId=tagSubId;
 
+		///////////////////////////////////////////////////////////
+		//
+		// Apply the filter to the root dataset's tags
+		//
+		///////////////////////////////////////////////////////////
+		if(pFilter != 0 && depth == 0)
+		{
+			// Stop at the pixel data and remember its position
+			///////////////////////////////////////////////////////////
+			if(pFilter->m_bStopAtPixelData && tagId == 0x7fe0 && tagSubId == 0x0010)
+			{
+				pDataSet->setPixelDataOffset(tagOffset);
+				break;
+			}
+
+			// Skip the tags that have not been requested
+			///////////////////////////////////////////////////////////
+			if(!pFilter->isTagRequested(tagId, tagSubId))
+			{
+				if(tagLengthDWord == 0xffffffff)
+				{
+					bool bSequence(::memcmp(tagType, "OB", 2) != 0 && ::memcmp(tagType, "OW", 2) != 0);
+					(*pReadSubItemLength) += skipUndefinedLength(pStream, bExplicitDataType, endianType, bSequence, depth + 1);
+				}
+				else
+				{
+					pStream->seek((std::int64_t)tagLengthDWord, true);
+					(*pReadSubItemLength) += tagLengthDWord;
+				}
+				continue;
+			}
+		}
+
 		if(tagLengthDWord != 0xffffffff && ::memcmp(tagType, "SQ", 2) != 0)
 		{
 			(*pReadSubItemLength) += readTag(pStream, pDataSet, tagLengthDWord, tagId, order, tagSubId, tagType, endianType, wordSize, 0, maxSizeBufferLoad);
@@ -897,7 +933,7 @@ void dicomCodec::parseStream(ptr<streamReader> pStream,
 			// Remember the item's position (used by DICOMDIR
 			//  structures)
 			///////////////////////////////////////////////////////////
-			std::uint32_t itemOffset(pStream->getControlledStreamPosition());
+			std::uint64_t itemOffset(pStream->getControlledStreamPosition());
 
 			// Read the sequence item's group
 			///////////////////////////////////////////////////////////
@@ -966,6 +1002,179 @@ void dicomCodec::parseStream(ptr<streamReader> pStream,
 }
 
 
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Skip an undefined length tag
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint32_t dicomCodec::skipUndefinedLength(const ptr<streamReader>& pStream, bool bExplicitDataType, streamController::tByteOrdering endianType, bool bSequence, std::uint32_t depth)
+{
+	PUNTOEXE_FUNCTION_START(L"dicomCodec::skipUndefinedLength");
+
+	if(depth > IMEBRA_DATASET_MAX_DEPTH)
+	{
+		PUNTOEXE_THROW(dicomCodecExceptionDepthLimitReached, "Depth for embedded dataset reached");
+	}
+
+	std::uint32_t skippedLength(0);
+	std::uint16_t itemGroupId;
+	std::uint16_t itemTagId;
+	std::uint32_t itemLength;
+
+	while(!pStream->endReached())
+	{
+		// Items and delimiters never have an explicit data
+		//  type
+		///////////////////////////////////////////////////////////
+		pStream->read((std::uint8_t*)&itemGroupId, sizeof(itemGroupId));
+		pStream->adjustEndian((std::uint8_t*)&itemGroupId, sizeof(itemGroupId), endianType);
+		pStream->read((std::uint8_t*)&itemTagId, sizeof(itemTagId));
+		pStream->adjustEndian((std::uint8_t*)&itemTagId, sizeof(itemTagId), endianType);
+		pStream->read((std::uint8_t*)&itemLength, sizeof(itemLength));
+		pStream->adjustEndian((std::uint8_t*)&itemLength, sizeof(itemLength), endianType);
+		skippedLength += sizeof(itemGroupId) + sizeof(itemTagId) + sizeof(itemLength);
+
+		// The end of the sequence
+		///////////////////////////////////////////////////////////
+		if(itemGroupId == 0xfffe && itemTagId == 0xe0dd)
+		{
+			break;
+		}
+
+		// Skip the item's tags
+		///////////////////////////////////////////////////////////
+		if(bSequence)
+		{
+			skippedLength += skipItem(pStream, bExplicitDataType, endianType, itemLength, depth);
+			continue;
+		}
+
+		// Skip the fragment
+		///////////////////////////////////////////////////////////
+		if(itemLength == 0xffffffff)
+		{
+			skippedLength += skipUndefinedLength(pStream, bExplicitDataType, endianType, false, depth + 1);
+			continue;
+		}
+		pStream->seek((std::int64_t)itemLength, true);
+		skippedLength += itemLength;
+	}
+
+	return skippedLength;
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Skip the tags of a sequence item
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+std::uint32_t dicomCodec::skipItem(const ptr<streamReader>& pStream, bool bExplicitDataType, streamController::tByteOrdering endianType, std::uint32_t itemLength, std::uint32_t depth)
+{
+	PUNTOEXE_FUNCTION_START(L"dicomCodec::skipItem");
+
+	std::uint32_t skippedLength(0);
+	std::uint16_t tagId;
+	std::uint16_t tagSubId;
+	std::uint16_t tagLengthWord;
+	std::uint32_t tagLengthDWord;
+	char       tagType[3];
+	tagType[2] = 0;
+
+	// As in parseStream(), the item's length is checked only
+	//  before each tag
+	///////////////////////////////////////////////////////////
+	while((itemLength == 0xffffffff || skippedLength < itemLength) && !pStream->endReached())
+	{
+		// Get the tag's ID
+		///////////////////////////////////////////////////////////
+		pStream->read((std::uint8_t*)&tagId, sizeof(tagId));
+		pStream->adjustEndian((std::uint8_t*)&tagId, sizeof(tagId), endianType);
+		pStream->read((std::uint8_t*)&tagSubId, sizeof(tagSubId));
+		pStream->adjustEndian((std::uint8_t*)&tagSubId, sizeof(tagSubId), endianType);
+		skippedLength += sizeof(tagId) + sizeof(tagSubId);
+
+		// Items and delimiters never have an explicit data
+		//  type
+		///////////////////////////////////////////////////////////
+		tagType[0] = tagType[1] = 0;
+		if(bExplicitDataType && tagId != 0xfffe)
+		{
+			pStream->read((std::uint8_t*)tagType, 2);
+			pStream->read((std::uint8_t*)&tagLengthWord, sizeof(tagLengthWord));
+			pStream->adjustEndian((std::uint8_t*)&tagLengthWord, sizeof(tagLengthWord), endianType);
+			skippedLength += 2 + sizeof(tagLengthWord);
+
+			if(dicomDictionary::getDicomDictionary()->isDataTypeValid(tagType))
+			{
+				tagLengthDWord=(std::uint32_t)tagLengthWord;
+				if(dicomDictionary::getDicomDictionary()->getLongLength(tagType))
+				{
+					pStream->read((std::uint8_t*)&tagLengthDWord, sizeof(tagLengthDWord));
+					pStream->adjustEndian((std::uint8_t*)&tagLengthDWord, sizeof(tagLengthDWord), endianType);
+					skippedLength += sizeof(tagLengthDWord);
+				}
+			}
+			else
+			{
+				if(endianType == streamController::lowByteEndian)
+					tagLengthDWord=(((std::uint32_t)tagLengthWord)<<16) | ((std::uint32_t)tagType[0]) | (((std::uint32_t)tagType[1])<<8);
+				else
+					tagLengthDWord=(std::uint32_t)tagLengthWord | (((std::uint32_t)tagType[0])<<24) | (((std::uint32_t)tagType[1])<<16);
+				tagType[0] = tagType[1] = 0;
+			}
+		}
+		else
+		{
+			pStream->read((std::uint8_t*)&tagLengthDWord, sizeof(tagLengthDWord));
+			pStream->adjustEndian((std::uint8_t*)&tagLengthDWord, sizeof(tagLengthDWord), endianType);
+			skippedLength += sizeof(tagLengthDWord);
+		}
+
+		// The end of the item
+		///////////////////////////////////////////////////////////
+		if(tagId == 0xfffe && tagSubId == 0xe00d)
+		{
+			break;
+		}
+
+		// Skip the tag
+		///////////////////////////////////////////////////////////
+		if(tagLengthDWord == 0xffffffff)
+		{
+			if(tagType[0] == 0)
+			{
+				std::string defaultType(dicomDictionary::getDicomDictionary()->getTagType(tagId, tagSubId));
+				if(defaultType.length() == 2)
+				{
+					tagType[0] = defaultType[0];
+					tagType[1] = defaultType[1];
+				}
+			}
+			bool bSequence(::memcmp(tagType, "OB", 2) != 0 && ::memcmp(tagType, "OW", 2) != 0);
+			skippedLength += skipUndefinedLength(pStream, bExplicitDataType, endianType, bSequence, depth + 1);
+			continue;
+		}
+		pStream->seek((std::int64_t)tagLengthDWord, true);
+		skippedLength += tagLengthDWord;
+	}
+
+	return skippedLength;
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 //
@@ -979,12 +1188,221 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 {
 	PUNTOEXE_FUNCTION_START(L"dicomCodec::getImage");
 
-	streamReader* pSourceStream = pStream.get();
+	imageAttributes attributes;
+	readImageAttributes(pData, dataType, &attributes);
+
+	// Create an image
+	///////////////////////////////////////////////////////////
+	ptr<image> pImage(new image);
+	ptr<handlers::dataHandlerNumericBase> handler = pImage->create(attributes.m_imageSizeX, attributes.m_imageSizeY, attributes.m_depth, attributes.m_colorSpace, attributes.m_highBit);
+	std::uint32_t tempChannelsNumber = pImage->getChannelsNumber();
+
+	if(handler == 0 || tempChannelsNumber != attributes.m_channelsNumber)
+	{
+		PUNTOEXE_THROW(codecExceptionCorruptedFile, "Cannot allocate the image's buffer");
+	}
+
+	decodeChannels(attributes, pStream.get());
+
+	// Copy the dicom channels into the image
+	///////////////////////////////////////////////////////////
+	std::uint32_t maxSamplingFactorX = attributes.m_bSubSampledX ? 2 : 1;
+	std::uint32_t maxSamplingFactorY = attributes.m_bSubSampledY ? 2 : 1;
+	for(std::uint32_t copyChannels = 0; copyChannels < attributes.m_channelsNumber; ++copyChannels)
+	{
+		ptrChannel dicomChannel = m_channels[copyChannels];
+		handler->copyFromInt32Interleaved(
+			dicomChannel->m_pBuffer,
+			maxSamplingFactorX /dicomChannel->m_samplingFactorX,
+			maxSamplingFactorY /dicomChannel->m_samplingFactorY,
+			0, 0,
+			dicomChannel->m_sizeX * maxSamplingFactorX / dicomChannel->m_samplingFactorX,
+			dicomChannel->m_sizeY * maxSamplingFactorY / dicomChannel->m_samplingFactorY,
+			copyChannels,
+			attributes.m_imageSizeX,
+			attributes.m_imageSizeY,
+			attributes.m_channelsNumber);
+	}
+
+	// Return OK
+	///////////////////////////////////////////////////////////
+	return pImage;
+
+	PUNTOEXE_FUNCTION_END();
+
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Decode a DICOM raw or RLE image into a buffer allocated
+//  by the caller
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void dicomCodec::decodeImage(ptr<dataSet> pData, ptr<streamReader> pStream, std::string dataType, const frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"dicomCodec::decodeImage");
+
+	imageAttributes attributes;
+	readImageAttributes(pData, dataType, &attributes);
+
+	if(transforms::colorTransforms::colorTransformsFactory::getNumberOfChannels(attributes.m_colorSpace) != attributes.m_channelsNumber)
+	{
+		PUNTOEXE_THROW(codecExceptionCorruptedFile, "The number of channels doesn't match the color space");
+	}
+
+	checkDestination(destination, attributes.m_imageSizeX, attributes.m_imageSizeY, attributes.m_channelsNumber);
+
+	// Uncompressed images with one channel and the same
+	//  depth as the destination are read straight into the
+	//  destination's rows: the intermediate channel is not
+	//  allocated and only the rows in the destination's
+	//  region are read
+	///////////////////////////////////////////////////////////
+	if(!attributes.m_bRleCompressed &&
+		destination.m_scale == 1 &&
+		attributes.m_channelsNumber == 1 &&
+		destination.m_depth == attributes.m_depth &&
+		(attributes.m_allocatedBits == 8 || attributes.m_allocatedBits == 16) &&
+		frameDestination::getDepthSize(attributes.m_depth) == (std::uint32_t)(attributes.m_allocatedBits >> 3))
+	{
+		if(attributes.m_allocatedBits == 8)
+		{
+			readUncompressedToDestination<std::uint8_t>(attributes, pStream.get(), destination);
+		}
+		else
+		{
+			readUncompressedToDestination<std::uint16_t>(attributes, pStream.get(), destination);
+		}
+		return;
+	}
+
+	destination.updateProgress(0, 1);
+	decodeChannels(attributes, pStream.get());
+
+	// Copy the dicom channels into the destination
+	///////////////////////////////////////////////////////////
+	std::uint32_t maxSamplingFactorX = attributes.m_bSubSampledX ? 2 : 1;
+	std::uint32_t maxSamplingFactorY = attributes.m_bSubSampledY ? 2 : 1;
+	for(std::uint32_t copyChannels = 0; copyChannels < attributes.m_channelsNumber; ++copyChannels)
+	{
+		ptrChannel dicomChannel = m_channels[copyChannels];
+		if(destination.m_scale != 1)
+		{
+			scaleInt32ToDestination(
+				dicomChannel->m_pBuffer,
+				dicomChannel->m_sizeX,
+				maxSamplingFactorX /dicomChannel->m_samplingFactorX,
+				maxSamplingFactorY /dicomChannel->m_samplingFactorY,
+				attributes.m_imageSizeX,
+				attributes.m_imageSizeY,
+				copyChannels,
+				destination);
+			continue;
+		}
+		copyInt32ToDestination(
+			dicomChannel->m_pBuffer,
+			maxSamplingFactorX /dicomChannel->m_samplingFactorX,
+			maxSamplingFactorY /dicomChannel->m_samplingFactorY,
+			0, 0,
+			dicomChannel->m_sizeX * maxSamplingFactorX / dicomChannel->m_samplingFactorX,
+			dicomChannel->m_sizeY * maxSamplingFactorY / dicomChannel->m_samplingFactorY,
+			copyChannels,
+			destination);
+	}
+	destination.updateProgress(1, 1);
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Read a single channel uncompressed image directly into
+//  the destination's rows, seeking the stream to the
+//  destination's region
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+template<class valueType>
+void dicomCodec::readUncompressedToDestination(const imageAttributes& attributes, streamReader* pSourceStream, const frameDestination& destination)
+{
+	PUNTOEXE_FUNCTION_START(L"dicomCodec::readUncompressedToDestination");
+
+	const valueType mask((valueType)attributes.m_mask);
+	const valueType checkSign((valueType)((std::uint32_t)0x1 << attributes.m_highBit));
+	const valueType orMask((valueType)(((std::uint32_t)-1) << attributes.m_highBit));
+
+	// Skip the rows and the columns that precede the region
+	///////////////////////////////////////////////////////////
+	const std::uint32_t rowSize(attributes.m_imageSizeX * (std::uint32_t)sizeof(valueType));
+	const std::uint32_t readSize(destination.m_sizeX * (std::uint32_t)sizeof(valueType));
+	if(destination.m_top != 0 || destination.m_left != 0)
+	{
+		pSourceStream->seek((std::int64_t)((std::uint64_t)destination.m_top * rowSize + (std::uint64_t)destination.m_left * sizeof(valueType)), true);
+	}
+
+	for(std::uint32_t scanRow(0); scanRow != destination.m_sizeY; ++scanRow)
+	{
+		destination.updateProgress(scanRow, destination.m_sizeY);
+
+		// Skip the columns that follow the region in the
+		//  previous row and precede it in this one
+		///////////////////////////////////////////////////////////
+		if(scanRow != 0 && readSize != rowSize)
+		{
+			pSourceStream->seek((std::int64_t)(rowSize - readSize), true);
+		}
+
+		valueType* pRow = (valueType*)destination.getRow(scanRow);
+		pSourceStream->read((std::uint8_t*)pRow, readSize);
+		if(sizeof(valueType) > 1)
+		{
+			pSourceStream->adjustEndian((std::uint8_t*)pRow, sizeof(valueType), streamController::lowByteEndian, destination.m_sizeX);
+		}
+
+		// Apply the mask and extend the sign
+		///////////////////////////////////////////////////////////
+		for(valueType* pEndRow(pRow + destination.m_sizeX); pRow != pEndRow; ++pRow)
+		{
+			*pRow &= mask;
+			if(attributes.m_b2Complement && (*pRow & checkSign) != 0)
+			{
+				*pRow |= orMask;
+			}
+		}
+	}
+	destination.updateProgress(destination.m_sizeY, destination.m_sizeY);
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Read the attributes of the image embedded in a dicom
+//  structure
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void dicomCodec::readImageAttributes(const ptr<dataSet>& pData, std::string dataType, imageAttributes* pAttributes)
+{
+	PUNTOEXE_FUNCTION_START(L"dicomCodec::readImageAttributes");
 
 	// Check for RLE compression
 	///////////////////////////////////////////////////////////
 	std::wstring transferSyntax = pData->getUnicodeString(0x0002, 0x0, 0x0010, 0x0);
-	bool bRleCompressed = (transferSyntax == L"1.2.840.10008.1.2.5");
+	pAttributes->m_bRleCompressed = (transferSyntax == L"1.2.840.10008.1.2.5");
 
 	// Check for color space and subsampled channels
 	///////////////////////////////////////////////////////////
@@ -1008,6 +1426,9 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 		colorSpace = L"RGB";
 	}
 
+	pAttributes->m_colorSpace = colorSpace;
+	pAttributes->m_channelsNumber = channelsNumber;
+
 	// Retrieve the image's size
 	///////////////////////////////////////////////////////////
 	std::uint32_t imageSizeX=pData->getUnsignedLong(0x0028, 0x0, 0x0011, 0x0);
@@ -1025,13 +1446,17 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 		PUNTOEXE_THROW(codecExceptionCorruptedFile, "The size tags are not available");
 	}
 
+	pAttributes->m_imageSizeX = imageSizeX;
+	pAttributes->m_imageSizeY = imageSizeY;
+
 	// Check for interleaved planes.
 	///////////////////////////////////////////////////////////
-	bool bInterleaved(pData->getUnsignedLong(0x0028, 0x0, 0x0006, 0x0)==0x0);
+	pAttributes->m_bInterleaved = (pData->getUnsignedLong(0x0028, 0x0, 0x0006, 0x0)==0x0);
 
 	// Check for 2's complement
 	///////////////////////////////////////////////////////////
 	bool b2Complement=pData->getUnsignedLong(0x0028, 0x0, 0x0103, 0x0)!=0x0;
+	pAttributes->m_b2Complement = b2Complement;
 
 	// Retrieve the allocated/stored/high bits
 	///////////////////////////////////////////////////////////
@@ -1041,14 +1466,18 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 	if(highBit<storedBits-1)
 		highBit=storedBits-1;
 
+	pAttributes->m_allocatedBits = allocatedBits;
+	pAttributes->m_storedBits = storedBits;
+	pAttributes->m_highBit = highBit;
+	pAttributes->m_wordSizeBytes = (dataType=="OW") ? 2 : 1;
 
 	// If the chrominance channels are subsampled, then find
 	//  the right image's size
 	///////////////////////////////////////////////////////////
-	bool bSubSampledY=channelsNumber>0x1 && transforms::colorTransforms::colorTransformsFactory::isSubsampledY(colorSpace);
-	bool bSubSampledX=channelsNumber>0x1 && transforms::colorTransforms::colorTransformsFactory::isSubsampledX(colorSpace);
+	pAttributes->m_bSubSampledY=channelsNumber>0x1 && transforms::colorTransforms::colorTransformsFactory::isSubsampledY(colorSpace);
+	pAttributes->m_bSubSampledX=channelsNumber>0x1 && transforms::colorTransforms::colorTransformsFactory::isSubsampledX(colorSpace);
 
-	// Create an image
+	// Find the image's depth
 	///////////////////////////////////////////////////////////
 	image::bitDepth depth;
 	if(b2Complement)
@@ -1081,54 +1510,62 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 			depth = image::depthU8;
 		}
 	}
-
-	ptr<image> pImage(new image);
-	ptr<handlers::dataHandlerNumericBase> handler = pImage->create(imageSizeX, imageSizeY, depth, colorSpace, highBit);
-	std::uint32_t tempChannelsNumber = pImage->getChannelsNumber();
-
-	if(handler == 0 || tempChannelsNumber != channelsNumber)
-	{
-		PUNTOEXE_THROW(codecExceptionCorruptedFile, "Cannot allocate the image's buffer");
-	}
-
-	// Allocate the dicom channels
-	///////////////////////////////////////////////////////////
-	allocChannels(channelsNumber, imageSizeX, imageSizeY, bSubSampledX, bSubSampledY);
+	pAttributes->m_depth = depth;
 
 	std::uint32_t mask( (std::uint32_t)0x1 << highBit );
 	mask <<= 1;
 	--mask;
 	mask-=((std::uint32_t)0x1<<(highBit+1-storedBits))-1;
+	pAttributes->m_mask = mask;
+
+	PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Decode the image into the dicom channels
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void dicomCodec::decodeChannels(const imageAttributes& attributes, streamReader* pSourceStream)
+{
+	PUNTOEXE_FUNCTION_START(L"dicomCodec::decodeChannels");
+
+	// Allocate the dicom channels
+	///////////////////////////////////////////////////////////
+	allocChannels(attributes.m_channelsNumber, attributes.m_imageSizeX, attributes.m_imageSizeY, attributes.m_bSubSampledX, attributes.m_bSubSampledY);
 
 	//
 	// The image is not compressed
 	//
 	///////////////////////////////////////////////////////////
-	if(!bRleCompressed)
+	if(!attributes.m_bRleCompressed)
 	{
-		std::uint8_t wordSizeBytes= (dataType=="OW") ? 2 : 1;
-
 		// The planes are interleaved
 		///////////////////////////////////////////////////////////
-		if(bInterleaved && channelsNumber != 1)
+		if(attributes.m_bInterleaved && attributes.m_channelsNumber != 1)
 		{
 			readUncompressedInterleaved(
-				channelsNumber,
-				bSubSampledX,
-				bSubSampledY,
+				attributes.m_channelsNumber,
+				attributes.m_bSubSampledX,
+				attributes.m_bSubSampledY,
 				pSourceStream,
-				wordSizeBytes,
-				allocatedBits,
-				mask);
+				attributes.m_wordSizeBytes,
+				attributes.m_allocatedBits,
+				attributes.m_mask);
 		}
 		else
 		{
 			readUncompressedNotInterleaved(
-				channelsNumber,
+				attributes.m_channelsNumber,
 				pSourceStream,
-				wordSizeBytes,
-				allocatedBits,
-				mask);
+				attributes.m_wordSizeBytes,
+				attributes.m_allocatedBits,
+				attributes.m_mask);
 		}
 	}
 
@@ -1138,21 +1575,21 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 	///////////////////////////////////////////////////////////
 	else
 	{
-		if(bSubSampledX || bSubSampledY)
+		if(attributes.m_bSubSampledX || attributes.m_bSubSampledY)
 		{
 			PUNTOEXE_THROW(codecExceptionCorruptedFile, "Cannot read subsampled RLE images");
 		}
 
-		readRLECompressed(imageSizeX, imageSizeY, channelsNumber, pSourceStream, allocatedBits, mask, bInterleaved);
+		readRLECompressed(attributes.m_imageSizeX, attributes.m_imageSizeY, attributes.m_channelsNumber, pSourceStream, attributes.m_allocatedBits, attributes.m_mask, attributes.m_bInterleaved);
 
 	} // ...End of RLE decoding
 
 	// Adjust b2complement buffers
 	///////////////////////////////////////////////////////////
-	if(b2Complement)
+	if(attributes.m_b2Complement)
 	{
-		std::int32_t checkSign = (std::int32_t)0x1<<highBit;
-		std::int32_t orMask = ((std::int32_t)-1)<<highBit;
+		std::int32_t checkSign = (std::int32_t)0x1<<attributes.m_highBit;
+		std::int32_t orMask = ((std::int32_t)-1)<<attributes.m_highBit;
 
 		for(size_t adjChannels = 0; adjChannels < m_channels.size(); ++adjChannels)
 		{
@@ -1170,33 +1607,7 @@ ptr<image> dicomCodec::getImage(ptr<dataSet> pData, ptr<streamReader> pStream, s
 		}
 	}
 
-
-	// Copy the dicom channels into the image
-	///////////////////////////////////////////////////////////
-	std::uint32_t maxSamplingFactorX = bSubSampledX ? 2 : 1;
-	std::uint32_t maxSamplingFactorY = bSubSampledY ? 2 : 1;
-	for(std::uint32_t copyChannels = 0; copyChannels < channelsNumber; ++copyChannels)
-	{
-		ptrChannel dicomChannel = m_channels[copyChannels];
-		handler->copyFromInt32Interleaved(
-			dicomChannel->m_pBuffer,
-			maxSamplingFactorX /dicomChannel->m_samplingFactorX,
-			maxSamplingFactorY /dicomChannel->m_samplingFactorY,
-			0, 0,
-			dicomChannel->m_sizeX * maxSamplingFactorX / dicomChannel->m_samplingFactorX,
-			dicomChannel->m_sizeY * maxSamplingFactorY / dicomChannel->m_samplingFactorY,
-			copyChannels,
-			imageSizeX,
-			imageSizeY,
-			channelsNumber);
-	}
-
-	// Return OK
-	///////////////////////////////////////////////////////////
-	return pImage;
-
 	PUNTOEXE_FUNCTION_END();
-
 }
 
 
@@ -1742,7 +2153,7 @@ void dicomCodec::readRLECompressed(
 			// Prepare to scan all the RLE segment
 			///////////////////////////////////////////////////////////
 			std::uint32_t segmentOffset=segmentsOffset[++segmentNumber]; // Get the offset
-			pSourceStream->seek(segmentOffset - currentSegmentOffset, true);
+			pSourceStream->seek((std::int64_t)segmentOffset - (std::int64_t)currentSegmentOffset, true);
 			currentSegmentOffset = segmentOffset;
 
 			std::uint8_t  rleByte = 0;         // RLE code
@@ -2243,8 +2654,8 @@ std::uint32_t dicomCodec::suggestAllocatedBits(std::wstring transferSyntax, std:
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
 std::uint32_t dicomCodec::readTag(
-	ptr<streamReader> pStream,
-	ptr<dataSet> pDataSet,
+	const ptr<streamReader>& pStream,
+	const ptr<dataSet>& pDataSet,
 	std::uint32_t tagLengthDWord,
 	std::uint16_t tagId,
 	std::uint16_t order,
@@ -2263,10 +2674,10 @@ std::uint32_t dicomCodec::readTag(
 	///////////////////////////////////////////////////////////
 	if(tagLengthDWord > maxSizeBufferLoad)
 	{
-		std::uint32_t bufferPosition(pStream->position());
-		std::uint32_t streamPosition(pStream->getControlledStreamPosition());
+		std::uint64_t bufferPosition(pStream->position());
+		std::uint64_t streamPosition(pStream->getControlledStreamPosition());
 		pStream->seek(tagLengthDWord, true);
-		std::uint32_t bufferLength(pStream->position() - bufferPosition);
+		std::uint32_t bufferLength((std::uint32_t)(pStream->position() - bufferPosition));
 
 		if(bufferLength != tagLengthDWord)
 		{
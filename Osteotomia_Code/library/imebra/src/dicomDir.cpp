@@ -381,7 +381,7 @@ void directoryRecord::updateOffsets()
 	}
 	else
 	{
-		getRecordDataSet()->setUnsignedLong(0x0004, 0, 0x1400, 0, m_pNextRecord->getRecordDataSet()->getItemOffset());
+		getRecordDataSet()->setUnsignedLong(0x0004, 0, 0x1400, 0, (std::uint32_t)m_pNextRecord->getRecordDataSet()->getItemOffset());
 		m_pNextRecord->updateOffsets();
 	}
 
@@ -393,7 +393,7 @@ void directoryRecord::updateOffsets()
 	}
 	else
 	{
-		getRecordDataSet()->setUnsignedLong(0x0004, 0, 0x1420, 0, m_pFirstChildRecord->getRecordDataSet()->getItemOffset());
+		getRecordDataSet()->setUnsignedLong(0x0004, 0, 0x1420, 0, (std::uint32_t)m_pFirstChildRecord->getRecordDataSet()->getItemOffset());
 		m_pFirstChildRecord->updateOffsets();
 	}
 
@@ -405,7 +405,7 @@ void directoryRecord::updateOffsets()
 	}
 	else
 	{
-		getRecordDataSet()->setUnsignedLong(0x0004, 0, 0x1504, 0, m_pReferencedRecord->getRecordDataSet()->getItemOffset());
+		getRecordDataSet()->setUnsignedLong(0x0004, 0, 0x1504, 0, (std::uint32_t)m_pReferencedRecord->getRecordDataSet()->getItemOffset());
 		m_pReferencedRecord->updateOffsets();
 	}
 }
@@ -484,7 +484,7 @@ dicomDir::dicomDir(ptr<dataSet> pDataSet):
 
 	// Get the DICOMDIR sequence
 	///////////////////////////////////////////////////////////
-	typedef std::map<std::uint32_t, ptr<directoryRecord> > tOffsetsToRecords;
+	typedef std::map<std::uint64_t, ptr<directoryRecord> > tOffsetsToRecords;
 	tOffsetsToRecords offsetsToRecords;
 	for(std::uint32_t scanItems(0); ; ++scanItems)
 	{
@@ -651,7 +651,7 @@ ptr<dataSet> dicomDir::buildDataSet()
 	if(m_pFirstRootRecord != 0)
 	{
 		m_pFirstRootRecord->updateOffsets();
-		m_pDataSet->setUnsignedLong(0x0004, 0, 0x1200, 0, m_pFirstRootRecord->getRecordDataSet()->getItemOffset());
+		m_pDataSet->setUnsignedLong(0x0004, 0, 0x1200, 0, (std::uint32_t)m_pFirstRootRecord->getRecordDataSet()->getItemOffset());
 	}
 
 	return m_pDataSet;
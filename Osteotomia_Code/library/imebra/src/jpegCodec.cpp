@@ -62,6 +62,7 @@ The author can be contacted by email at info@binarno.com or by mail at
 #include <vector>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 namespace puntoexe
 {
@@ -399,10 +400,10 @@ jpegCodec::jpegCodec()
     ///////////////////////////////////////////////////////////
     for(int resetHuffmanTables = 0; resetHuffmanTables<16; ++resetHuffmanTables)
     {
-        ptr<huffmanTable> huffmanDC(new huffmanTable(9));
+        ptr<huffmanTable> huffmanDC(new huffmanTable(9, 0x1f));
         m_pHuffmanTableDC[resetHuffmanTables]=huffmanDC;
 
-        ptr<huffmanTable> huffmanAC(new huffmanTable(9));
+        ptr<huffmanTable> huffmanAC(new huffmanTable(9, 0x0f));
         m_pHuffmanTableAC[resetHuffmanTables]=huffmanAC;
     }
 
@@ -908,7 +909,7 @@ void jpegCodec::findMcuSize()
 //
 /////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////
-void jpegCodec::readStream(ptr<streamReader> pSourceStream, ptr<dataSet> pDataSet, std::uint32_t /* maxSizeBufferLoad = 0xffffffff */)
+void jpegCodec::readStream(ptr<streamReader> pSourceStream, ptr<dataSet> pDataSet, std::uint32_t /* maxSizeBufferLoad = 0xffffffff */, const parseFilter* /* pFilter = 0 */)
 {
     PUNTOEXE_FUNCTION_START(L"jpegCodec::readStream");
 
@@ -922,7 +923,7 @@ void jpegCodec::readStream(ptr<streamReader> pSourceStream, ptr<dataSet> pDataSe
     // This will be used later, in order to reread all the
     //  stream's content and store it into the dataset
     ///////////////////////////////////////////////////////////
-    std::uint32_t startPosition=pStream->position();
+    std::uint64_t startPosition=pStream->position();
 
     try
     {
@@ -1057,9 +1058,9 @@ void jpegCodec::readStream(ptr<streamReader> pSourceStream, ptr<dataSet> pDataSe
 
     // Reread all the stream's content and write it into the dataset
     ////////////////////////////////////////////////////////////////
-    std::uint32_t finalPosition=pStream->position();
+    std::uint64_t finalPosition=pStream->position();
     std::uint32_t streamLength=(std::uint32_t)(finalPosition-startPosition);
-    pStream->seek((std::int32_t)startPosition);
+    pStream->seek((std::int64_t)startPosition);
 
     ptr<handlers::dataHandlerRaw> imageHandler=pDataSet->getDataHandlerRaw(0x7fe0, 0, 0x0010, 1, true, "OB");
     if(imageHandler != 0 && streamLength != 0)
@@ -1188,7 +1189,87 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
 {
     PUNTOEXE_FUNCTION_START(L"jpegCodec::getImage");
 
-    streamReader* pSourceStream = pStream.get();
+    decodeChannels(pStream.get(), 1);
+
+    bool b2complement;
+    std::wstring colorSpace;
+    getImageAttributes(sourceDataSet, &b2complement, &colorSpace);
+
+    ptr<image> returnImage(new image());
+    copyJpegChannelsToImage(returnImage, b2complement, colorSpace);
+
+    return returnImage;
+
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Decode a jpeg image into a buffer allocated by the caller
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void jpegCodec::decodeImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pStream, std::string /* dataType not used */, const frameDestination& destination)
+{
+    PUNTOEXE_FUNCTION_START(L"jpegCodec::decodeImage");
+
+    // Reduced resolutions of 1/2, 1/4 and 1/8 are obtained
+    //  with a reduced IDCT
+    ///////////////////////////////////////////////////////////
+    std::uint32_t idctScale(1);
+    if(destination.m_scale == 2 || destination.m_scale == 4 || destination.m_scale == 8)
+    {
+        idctScale = destination.m_scale;
+    }
+
+    // Find the destination's region in image's pixels
+    ///////////////////////////////////////////////////////////
+    std::uint32_t regionLeft(destination.m_left * destination.m_scale);
+    std::uint32_t regionTop(destination.m_top * destination.m_scale);
+    std::uint32_t regionRight(regionLeft + destination.m_sizeX * destination.m_scale);
+    std::uint32_t regionBottom(regionTop + destination.m_sizeY * destination.m_scale);
+
+    decodeChannels(pStream.get(), idctScale, regionLeft, regionTop, regionRight, regionBottom, destination.m_pProgress, &destination);
+
+    bool b2complement;
+    std::wstring colorSpace;
+    getImageAttributes(sourceDataSet, &b2complement, &colorSpace);
+
+    // Other reductions of lossy images are calculated on the
+    //  full resolution image
+    ///////////////////////////////////////////////////////////
+    if(!m_bLossless && idctScale != destination.m_scale)
+    {
+        ptr<image> fullImage(new image());
+        copyJpegChannelsToImage(fullImage, b2complement, colorSpace);
+        copyImageToDestination(fullImage, destination);
+        return;
+    }
+
+    copyJpegChannelsToDestination(destination, b2complement, idctScale);
+
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Decode the jpeg stream into the jpeg channels
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void jpegCodec::decodeChannels(streamReader* pSourceStream, std::uint32_t idctScale,
+        std::uint32_t regionLeft, std::uint32_t regionTop, std::uint32_t regionRight, std::uint32_t regionBottom,
+        decodeProgress* pProgress, const frameDestination* pDestination)
+{
+    PUNTOEXE_FUNCTION_START(L"jpegCodec::decodeChannels");
 
     // Reset the internal variables
     ////////////////////////////////////////////////////////////////
@@ -1227,13 +1308,17 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
 
     int scanBlock;              // scan lossless blocks
     int scanBlockX, scanBlockY; // scan lossy blocks
-    std::uint32_t amplitudeLength; // lossless amplitude's length
     std::int32_t amplitude;        // lossless amplitude
 
     // Used to read the channels' content
     ///////////////////////////////////////////////////////////
     std::uint32_t bufferPointer = 0;
 
+    // The region, in MCUs
+    ///////////////////////////////////////////////////////////
+    std::uint32_t regionFirstMcuX, regionFirstMcuY, regionLastMcuX, regionLastMcuY;
+    bool bMcuInRegion;
+
     // Read until the end of the image is reached
     ///////////////////////////////////////////////////////////
     for(m_bEndOfImage=false; !m_bEndOfImage; pSourceStream->resetInBitsBuffer())
@@ -1292,11 +1377,80 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
 
         }
 
+        // The frame header has been read: a wrong destination
+        //  is rejected before anything is decoded
+        ///////////////////////////////////////////////////////////
+        if(pDestination != 0)
+        {
+            checkDestination(*pDestination, m_imageSizeX, m_imageSizeY, (std::uint32_t)m_channelsMap.size());
+            pDestination = 0;
+        }
+
+        // Find the MCUs that contain the region. The size of the
+        //  lossy MCUs, in image's pixels, is calculated from the
+        //  first channel in the scan
+        ///////////////////////////////////////////////////////////
+        regionFirstMcuX = regionFirstMcuY = 0;
+        regionLastMcuX = regionLastMcuY = 0xffffffff;
+        if(!m_bLossless)
+        {
+            jpeg::jpegChannel* pFirstChannel = m_channelsList[0];
+            std::uint32_t mcuSizeX = 8 * pFirstChannel->m_blockMcuX * m_maxSamplingFactorX / pFirstChannel->m_samplingFactorX;
+            std::uint32_t mcuSizeY = 8 * pFirstChannel->m_blockMcuY * m_maxSamplingFactorY / pFirstChannel->m_samplingFactorY;
+            regionFirstMcuX = regionLeft / mcuSizeX;
+            regionFirstMcuY = regionTop / mcuSizeY;
+            regionLastMcuX = (regionRight - 1) / mcuSizeX;
+            regionLastMcuY = (regionBottom - 1) / mcuSizeY;
+        }
+
+        // A lossy restart interval that doesn't contain any MCU
+        //  of the region is skipped without decoding it: the
+        //  following RST tag resets the DC predictors and the
+        //  MCU counter
+        ///////////////////////////////////////////////////////////
+        if(!m_bLossless && m_mcuPerRestartInterval != 0 && m_mcuProcessed == m_mcuLastRestart)
+        {
+            bool bIntervalInRegion(false);
+            std::uint32_t lastMcu(nextMcuStop - 1);
+            std::uint32_t firstRow(m_mcuProcessed / m_mcuNumberX);
+            std::uint32_t lastRow(lastMcu / m_mcuNumberX);
+            for(std::uint32_t scanRow(firstRow); scanRow <= lastRow && !bIntervalInRegion; ++scanRow)
+            {
+                std::uint32_t firstCol(scanRow == firstRow ? m_mcuProcessed % m_mcuNumberX : 0);
+                std::uint32_t lastCol(scanRow == lastRow ? lastMcu % m_mcuNumberX : m_mcuNumberX - 1);
+                bIntervalInRegion = scanRow >= regionFirstMcuY && scanRow <= regionLastMcuY &&
+                        firstCol <= regionLastMcuX && lastCol >= regionFirstMcuX;
+            }
+            if(!bIntervalInRegion)
+            {
+                skipEntropyCodedSegment(pSourceStream);
+                m_mcuProcessed = nextMcuStop;
+                m_mcuProcessedY = m_mcuProcessed / m_mcuNumberX;
+                m_mcuProcessedX = m_mcuProcessed - m_mcuProcessedY * m_mcuNumberX;
+                continue;
+            }
+        }
+
+        // When the scan contains all the coefficients of all
+        //  the channels then the decoding ends after the
+        //  region's last row of MCUs
+        ///////////////////////////////////////////////////////////
+        std::uint32_t scanChannels(0);
+        while(m_channelsList[scanChannels] != 0)
+        {
+            ++scanChannels;
+        }
+        bool bStopAfterRegion(!m_bLossless &&
+                              m_spectralIndexStart == 0 && m_spectralIndexEnd >= 63 &&
+                              scanChannels == m_channelsMap.size());
+
         jpeg::jpegChannel* pChannel; // Used in the loops
         while(m_mcuProcessed < nextMcuStop && !pSourceStream->endReached())
         {
             // Read an MCU
             ///////////////////////////////////////////////////////////
+            bMcuInRegion = m_mcuProcessedX >= regionFirstMcuX && m_mcuProcessedX <= regionLastMcuX &&
+                    m_mcuProcessedY >= regionFirstMcuY && m_mcuProcessedY <= regionLastMcuY;
 
             // Scan all components
             ///////////////////////////////////////////////////////////
@@ -1313,19 +1467,7 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
                         scanBlock != pChannel->m_blockMcuXY;
                         ++scanBlock)
                     {
-                        amplitudeLength = pChannel->m_pActiveHuffmanTableDC->readHuffmanCode(pSourceStream);
-                        if(amplitudeLength)
-                        {
-                            amplitude = pSourceStream->readBits(amplitudeLength);
-                            if(amplitude < ((std::int32_t)1<<(amplitudeLength-1)))
-                            {
-                                amplitude -= ((std::int32_t)1<<amplitudeLength)-1;
-                            }
-                        }
-                        else
-                        {
-                            amplitude = 0;
-                        }
+                        pChannel->m_pActiveHuffmanTableDC->readHuffmanCode(pSourceStream, &amplitude);
 
                         pChannel->addUnprocessedAmplitude(amplitude, m_spectralIndexStart, m_mcuLastRestart == m_mcuProcessed && scanBlock == 0);
                     }
@@ -1342,12 +1484,23 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
                     {
                         readBlock(pSourceStream, &(pChannel->m_pBuffer[bufferPointer]), pChannel);
 
-                        if(m_spectralIndexEnd>=63 && m_bitLow==0)
+                        if(bMcuInRegion && m_spectralIndexEnd>=63 && m_bitLow==0)
                         {
-                            IDCT(
-                                        &(pChannel->m_pBuffer[bufferPointer]),
-                                        m_decompressionQuantizationTable[pChannel->m_quantTable]
-                                    );
+                            if(idctScale == 1)
+                            {
+                                IDCT(
+                                            &(pChannel->m_pBuffer[bufferPointer]),
+                                            m_decompressionQuantizationTable[pChannel->m_quantTable]
+                                        );
+                            }
+                            else
+                            {
+                                scaledIDCT(
+                                            &(pChannel->m_pBuffer[bufferPointer]),
+                                            m_quantizationTable[pChannel->m_quantTable],
+                                            8 / idctScale
+                                            );
+                            }
                         }
                         bufferPointer += 64;
                     }
@@ -1360,6 +1513,19 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
             {
                 m_mcuProcessedX = 0;
                 ++m_mcuProcessedY;
+
+                // Notify the progress once per row of MCUs
+                ///////////////////////////////////////////////////////////
+                if(pProgress != 0)
+                {
+                    pProgress->update(m_mcuProcessedY, m_mcuNumberY);
+                }
+            }
+
+            if(bStopAfterRegion && m_mcuProcessedY > regionLastMcuY)
+            {
+                m_bEndOfImage = true;
+                break;
             }
         }
     }
@@ -1373,6 +1539,65 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
         processLosslessIterator->second->processUnprocessedAmplitudes();
     }
 
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Skip the entropy coded data until the next tag
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void jpegCodec::skipEntropyCodedSegment(streamReader* pSourceStream)
+{
+    PUNTOEXE_FUNCTION_START(L"jpegCodec::skipEntropyCodedSegment");
+
+    // A tag is a 0xff byte followed by a byte different from
+    //  0 (stuffed 0xff) and from 0xff (fill bytes)
+    ///////////////////////////////////////////////////////////
+    std::uint8_t readByte(0);
+    for(;;)
+    {
+        pSourceStream->read(&readByte, 1);
+        if(readByte != 0xff)
+        {
+            continue;
+        }
+        while(readByte == 0xff)
+        {
+            pSourceStream->read(&readByte, 1);
+        }
+        if(readByte != 0)
+        {
+            break;
+        }
+    }
+
+    // Leave the tag in the stream
+    ///////////////////////////////////////////////////////////
+    pSourceStream->seek(-2, true);
+
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Retrieve the sign and the color space of the jpeg image
+//  from the dataset
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void jpegCodec::getImageAttributes(ptr<dataSet> sourceDataSet, bool* pb2complement, std::wstring* pColorSpace)
+{
+    PUNTOEXE_FUNCTION_START(L"jpegCodec::getImageAttributes");
 
     // Check for 2's complement
     ///////////////////////////////////////////////////////////
@@ -1392,10 +1617,8 @@ ptr<image> jpegCodec::getImage(ptr<dataSet> sourceDataSet, ptr<streamReader> pSt
         }
     }
 
-    ptr<image> returnImage(new image());
-    copyJpegChannelsToImage(returnImage, b2complement, colorSpace);
-
-    return returnImage;
+    *pb2complement = b2complement;
+    *pColorSpace = colorSpace;
 
     PUNTOEXE_FUNCTION_END();
 }
@@ -1422,20 +1645,13 @@ void jpegCodec::copyJpegChannelsToImage(ptr<image> destImage, bool b2complement,
 
     ptr<handlers::dataHandlerNumericBase> handler = destImage->create(m_imageSizeX, m_imageSizeY, depth, colorSpace, (std::uint8_t)(m_precision-1));
 
-    std::int32_t offsetValue=(std::int32_t)1<<(m_precision-1);
-    std::int32_t maxClipValue=((std::int32_t)1<<m_precision)-1;
-    std::int32_t minClipValue = 0;
-    if(b2complement)
-    {
-        maxClipValue-=offsetValue;
-        minClipValue-=offsetValue;
-    }
-
     if(handler == 0)
     {
         return;
     }
 
+    adjustJpegChannels(b2complement);
+
     // Copy the jpeg channels into the new image
     ///////////////////////////////////////////////////////////
     std::uint32_t destChannelNumber = 0;
@@ -1445,6 +1661,98 @@ void jpegCodec::copyJpegChannelsToImage(ptr<image> destImage, bool b2complement,
     {
         ptr<jpeg::jpegChannel> pChannel = copyChannelsIterator->second;
 
+        // If only one channel is present, then use the fast copy
+        ///////////////////////////////////////////////////////////
+        if(m_bLossless && m_channelsMap.size() == 1)
+        {
+            handler->copyFrom(pChannel->m_pBuffer, pChannel->m_bufferSize);
+            return;
+        }
+
+        // Lossless interleaved
+        ///////////////////////////////////////////////////////////
+        std::uint32_t runX = m_maxSamplingFactorX / pChannel->m_samplingFactorX;
+        std::uint32_t runY = m_maxSamplingFactorY / pChannel->m_samplingFactorY;
+        if(m_bLossless)
+        {
+            handler->copyFromInt32Interleaved(
+                        pChannel->m_pBuffer,
+                        runX, runY,
+                        0, 0, pChannel->m_sizeX * runX, pChannel->m_sizeY * runY,
+                        destChannelNumber++,
+                        m_imageSizeX, m_imageSizeY,
+                        (std::uint32_t)m_channelsMap.size());
+
+            continue;
+        }
+
+        // Lossy interleaved
+        ///////////////////////////////////////////////////////////
+        std::uint32_t totalBlocksY(pChannel->m_sizeY >> 3);
+        std::uint32_t totalBlocksX(pChannel->m_sizeX >> 3);
+
+        std::int32_t* pSourceBuffer(pChannel->m_pBuffer);
+
+        std::uint32_t startRow(0);
+        for(std::uint32_t scanBlockY = 0; scanBlockY < totalBlocksY; ++scanBlockY)
+        {
+            std::uint32_t startCol(0);
+            std::uint32_t endRow(startRow + (runY << 3));
+
+            for(std::uint32_t scanBlockX = 0; scanBlockX < totalBlocksX; ++scanBlockX)
+            {
+                std::uint32_t endCol = startCol + (runX << 3);
+                handler->copyFromInt32Interleaved(
+                            pSourceBuffer,
+                            runX, runY,
+                            startCol,
+                            startRow,
+                            endCol,
+                            endRow,
+                            destChannelNumber,
+                            m_imageSizeX, m_imageSizeY,
+                            (std::uint32_t)m_channelsMap.size());
+
+                pSourceBuffer += 64;
+                startCol = endCol;
+            }
+            startRow = endRow;
+        }
+        ++destChannelNumber;
+    }
+
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Adjust the offset and the sign of the decoded channels
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void jpegCodec::adjustJpegChannels(bool b2complement)
+{
+    PUNTOEXE_FUNCTION_START(L"jpegCodec::adjustJpegChannels");
+
+    std::int32_t offsetValue=(std::int32_t)1<<(m_precision-1);
+    std::int32_t maxClipValue=((std::int32_t)1<<m_precision)-1;
+    std::int32_t minClipValue = 0;
+    if(b2complement)
+    {
+        maxClipValue-=offsetValue;
+        minClipValue-=offsetValue;
+    }
+
+    for(tChannelsMap::iterator adjustChannelsIterator=m_channelsMap.begin();
+        adjustChannelsIterator!=m_channelsMap.end();
+        ++adjustChannelsIterator)
+    {
+        ptr<jpeg::jpegChannel> pChannel = adjustChannelsIterator->second;
+
         // Adjust 2complement
         ///////////////////////////////////////////////////////////
         std::int32_t* pChannelBuffer = pChannel->m_pBuffer;
@@ -1482,58 +1790,115 @@ void jpegCodec::copyJpegChannelsToImage(ptr<image> destImage, bool b2complement,
                 ++pChannelBuffer;
             }
         }
+    }
 
-        // If only one channel is present, then use the fast copy
-        ///////////////////////////////////////////////////////////
-        if(m_bLossless && m_channelsMap.size() == 1)
-        {
-            handler->copyFrom(pChannel->m_pBuffer, pChannel->m_bufferSize);
-            return;
-        }
+    PUNTOEXE_FUNCTION_END();
+}
+
+
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+//
+//
+// Copy the loaded image into a buffer allocated by the
+//  caller
+//
+//
+///////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////
+void jpegCodec::copyJpegChannelsToDestination(const frameDestination& destination, bool b2complement, std::uint32_t idctScale)
+{
+    PUNTOEXE_FUNCTION_START(L"jpegCodec::copyJpegChannelsToDestination");
+
+    // Also checked by decodeChannels(), unless the stream
+    //  didn't contain any scan
+    ///////////////////////////////////////////////////////////
+    checkDestination(destination, m_imageSizeX, m_imageSizeY, (std::uint32_t)m_channelsMap.size());
+
+    adjustJpegChannels(b2complement);
+
+    // Copy the jpeg channels into the destination
+    ///////////////////////////////////////////////////////////
+    std::uint32_t destChannelNumber = 0;
+    for(tChannelsMap::iterator copyChannelsIterator=m_channelsMap.begin();
+        copyChannelsIterator!=m_channelsMap.end();
+        ++copyChannelsIterator)
+    {
+        ptr<jpeg::jpegChannel> pChannel = copyChannelsIterator->second;
 
-        // Lossless interleaved
-        ///////////////////////////////////////////////////////////
         std::uint32_t runX = m_maxSamplingFactorX / pChannel->m_samplingFactorX;
         std::uint32_t runY = m_maxSamplingFactorY / pChannel->m_samplingFactorY;
+
+        // Lossless
+        ///////////////////////////////////////////////////////////
+        if(m_bLossless && destination.m_scale != 1)
+        {
+            scaleInt32ToDestination(
+                        pChannel->m_pBuffer,
+                        pChannel->m_sizeX,
+                        runX, runY,
+                        m_imageSizeX, m_imageSizeY,
+                        destChannelNumber++,
+                        destination);
+
+            continue;
+        }
         if(m_bLossless)
         {
-            handler->copyFromInt32Interleaved(
+            copyInt32ToDestination(
                         pChannel->m_pBuffer,
                         runX, runY,
                         0, 0, pChannel->m_sizeX * runX, pChannel->m_sizeY * runY,
                         destChannelNumber++,
-                        m_imageSizeX, m_imageSizeY,
-                        (std::uint32_t)m_channelsMap.size());
+                        destination);
 
             continue;
         }
 
-        // Lossy interleaved
+        // Lossy: the channel's buffer is organized in 8x8
+        //  blocks. When a reduced IDCT has been used, then
+        //  only the first blockSize x blockSize values of
+        //  each block are meaningful
         ///////////////////////////////////////////////////////////
         std::uint32_t totalBlocksY(pChannel->m_sizeY >> 3);
         std::uint32_t totalBlocksX(pChannel->m_sizeX >> 3);
+        std::uint32_t blockSize(8 / idctScale);
 
         std::int32_t* pSourceBuffer(pChannel->m_pBuffer);
 
+        // Only the blocks that intersect the destination's
+        //  region are copied
+        ///////////////////////////////////////////////////////////
+        std::uint32_t regionEndCol(destination.m_left + destination.m_sizeX);
+        std::uint32_t regionEndRow(destination.m_top + destination.m_sizeY);
+
         std::uint32_t startRow(0);
-        for(std::uint32_t scanBlockY = 0; scanBlockY < totalBlocksY; ++scanBlockY)
+        for(std::uint32_t scanBlockY = 0; scanBlockY < totalBlocksY && startRow < regionEndRow; ++scanBlockY)
         {
             std::uint32_t startCol(0);
-            std::uint32_t endRow(startRow + (runY << 3));
+            std::uint32_t endRow(startRow + runY * blockSize);
+            if(endRow <= destination.m_top)
+            {
+                pSourceBuffer += 64 * totalBlocksX;
+                startRow = endRow;
+                continue;
+            }
 
             for(std::uint32_t scanBlockX = 0; scanBlockX < totalBlocksX; ++scanBlockX)
             {
-                std::uint32_t endCol = startCol + (runX << 3);
-                handler->copyFromInt32Interleaved(
-                            pSourceBuffer,
-                            runX, runY,
-                            startCol,
-                            startRow,
-                            endCol,
-                            endRow,
-                            destChannelNumber,
-                            m_imageSizeX, m_imageSizeY,
-                            (std::uint32_t)m_channelsMap.size());
+                std::uint32_t endCol = startCol + runX * blockSize;
+                if(startCol < regionEndCol && endCol > destination.m_left)
+                {
+                    copyInt32ToDestination(
+                                pSourceBuffer,
+                                runX, runY,
+                                startCol,
+                                startRow,
+                                endCol,
+                                endRow,
+                                destChannelNumber,
+                                destination);
+                }
 
                 pSourceBuffer += 64;
                 startCol = endCol;
@@ -2012,6 +2377,7 @@ inline void jpegCodec::readBlock(streamReader* pStream, std::int32_t* pBuffer, j
     }
 
     std::uint32_t amplitude;
+    std::int32_t hufAmplitude(0);
     std::uint32_t hufCode;
     std::int32_t value = 0;
     std::int32_t oldValue;
@@ -2055,7 +2421,7 @@ inline void jpegCodec::readBlock(streamReader* pStream, std::int32_t* pBuffer, j
         /////////////////////////////////////////////////////////////////
         if(spectralIndex != 0)
         {
-            hufCode = pChannel->m_pActiveHuffmanTableAC->readHuffmanCode(pStream);
+            hufCode = pChannel->m_pActiveHuffmanTableAC->readHuffmanCode(pStream, &hufAmplitude);
 
             // End of block reached
             /////////////////////////////////////////////////////////////////
@@ -2078,7 +2444,7 @@ inline void jpegCodec::readBlock(streamReader* pStream, std::int32_t* pBuffer, j
             }
             else
             {
-                hufCode = pChannel->m_pActiveHuffmanTableDC->readHuffmanCode(pStream);
+                hufCode = pChannel->m_pActiveHuffmanTableDC->readHuffmanCode(pStream, &hufAmplitude);
             }
         }
 
@@ -2107,20 +2473,9 @@ inline void jpegCodec::readBlock(streamReader* pStream, std::int32_t* pBuffer, j
             /////////////////////////////////////////////////////////////////
             if(m_bitHigh == 0 || spectralIndex != 0)
             {
-                // Read coeff
+                // The coeff has been read together with the huffman code
                 /////////////////////////////////////////////////////////////////
-                if(amplitudeLength != 0)
-                {
-                    value = (std::int32_t)(pStream->readBits(amplitudeLength));
-                    if(value < ((std::int32_t)1 << (amplitudeLength-1)) )
-                    {
-                        value -= ((std::int32_t)1 << amplitudeLength) - 1;
-                    }
-                }
-                else
-                {
-                    value = 0;
-                }
+                value = hufAmplitude;
 
                 // Move spectral index forward by zero run length
                 /////////////////////////////////////////////////////////////////
@@ -2686,6 +3041,100 @@ void jpegCodec::IDCT(std::int32_t* pIOMatrix, long long* pScaleFactors)
 }
 
 
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+//
+//
+// Calculate a reduced IDCT: only the lowest outputSize x
+//  outputSize coefficients are used and the result is a
+//  block of outputSize x outputSize pixels, each one
+//  representing the average of the corresponding pixels
+//  in the full 8x8 block
+//
+//
+/////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////
+void jpegCodec::scaledIDCT(std::int32_t* pIOMatrix, const std::uint32_t* pQuantizationTable, std::uint32_t outputSize)
+{
+    // DC only: the average value of the block
+    /////////////////////////////////////////////////////////////////
+    if(outputSize == 1)
+    {
+        *pIOMatrix = (std::int32_t)::floor((double)((long long)*pIOMatrix * (long long)*pQuantizationTable) / 8.0 + 0.5);
+        return;
+    }
+
+    // Basis tables for the 2 and 4 points IDCT: each value is
+    //  the average of the 8 points IDCT basis over the pixels
+    //  that form an output pixel, so the result approximates
+    //  the average of the full resolution block
+    /////////////////////////////////////////////////////////////////
+    struct idctTables
+    {
+        idctTables()
+        {
+            calculate(&(m_cos2[0][0]), 2);
+            calculate(&(m_cos4[0][0]), 4);
+        }
+        static void calculate(double* pTable, int outputSize)
+        {
+            const double pi(3.14159265358979323846);
+            const int groupSize(8 / outputSize);
+            for(int x(0); x != outputSize; ++x)
+            {
+                for(int u(0); u != outputSize; ++u)
+                {
+                    double total(0);
+                    for(int k(x * groupSize); k != (x + 1) * groupSize; ++k)
+                    {
+                        total += ::cos((double)((2 * k + 1) * u) * pi / 16.0);
+                    }
+                    double cu(u == 0 ? 0.70710678118654752440 : 1.0);
+                    pTable[x * outputSize + u] = cu / 2.0 * total / (double)groupSize;
+                }
+            }
+        }
+        double m_cos4[4][4];
+        double m_cos2[2][2];
+    };
+    static const idctTables tables;
+
+    const double* pCos(outputSize == 2 ? &(tables.m_cos2[0][0]) : &(tables.m_cos4[0][0]));
+
+    // Rows IDCT on the dequantized coefficients
+    /////////////////////////////////////////////////////////////////
+    double tempMatrix[16];
+    for(std::uint32_t v(0); v != outputSize; ++v)
+    {
+        for(std::uint32_t x(0); x != outputSize; ++x)
+        {
+            double value(0);
+            for(std::uint32_t u(0); u != outputSize; ++u)
+            {
+                value += pCos[x * outputSize + u] * (double)((long long)pIOMatrix[v * 8 + u] * (long long)pQuantizationTable[v * 8 + u]);
+            }
+            tempMatrix[v * outputSize + x] = value;
+        }
+    }
+
+    // Columns IDCT. The result is stored in the first
+    //  outputSize x outputSize values of the matrix
+    /////////////////////////////////////////////////////////////////
+    for(std::uint32_t y(0); y != outputSize; ++y)
+    {
+        for(std::uint32_t x(0); x != outputSize; ++x)
+        {
+            double value(0);
+            for(std::uint32_t v(0); v != outputSize; ++v)
+            {
+                value += pCos[y * outputSize + v] * tempMatrix[v * outputSize + x];
+            }
+            pIOMatrix[y * outputSize + x] = (std::int32_t)::floor(value + 0.5);
+        }
+    }
+}
+
+
 namespace jpeg
 {
 ///////////////////////////////////////////////////////////
@@ -1,6 +1,18 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+namespace
+{
+// Function posted by the loading thread to run in the UI thread
+class UiTaskEvent : public QEvent
+{
+public:
+    UiTaskEvent(std::function<void()> task) : QEvent(QEvent::User), task_(task) {}
+    void run() { task_(); }
+private:
+    std::function<void()> task_;
+};
+}
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -20,23 +32,79 @@ MainWindow::MainWindow(QWidget *parent) :
         this->eventHandler(event, parameters);
     }));
     layoutWindow_->setEnabled(false);
+    asyncLoader_.reset(new AsyncLoader([this](DicomLoader::Stage stage, int percent)
+    {
+        this->postToUi([this, stage, percent]() { this->showLoadProgress(stage, percent); });
+    },
+    [this](const std::wstring& path, std::shared_ptr<DicomImage> image)
+    {
+        this->postToUi([this, path, image]() { this->imageLoaded(path, image); });
+    },
+    [this](const std::wstring& path, std::shared_ptr<DicomImage> preview)
+    {
+        this->postToUi([this, path, preview]() { this->imagePreviewed(path, preview); });
+    },
+    LOADER_CACHE_SIZE));
+    pngExporter_.reset(new PngExporter([this](int percent)
+    {
+        this->postToUi([this, percent]() { this->showExportProgress(percent); });
+    },
+    [this](const std::string& filename, bool ok)
+    {
+        this->postToUi([this, filename, ok]() { this->exportFinished(filename, ok); });
+    }));
 
     statusLabel_.reset(new QLabel(this));
     statusBar()->addPermanentWidget(statusLabel_.get());
 
     displayRoi_.reset(new cv::Rect());
+    renderWorker_.reset(new RenderWorker([this]()
+    {
+        this->postToUi([this]() { this->presentFrame(); });
+    }));
+    zoomFactor_ = 1.0f;
+    windowCenter_ = WINDOW_DEFAULT_CENTER;
+    windowWidth_ = WINDOW_DEFAULT_WIDTH;
     points_.reset(new std::vector<std::shared_ptr<Point>>());
     lastIdx_ = -1;
     leg_ = Leg::LEFT;
 
+    // The input events only change the view: the frame is drawn once per FRAME_INTERVAL at most
+    imageDirty_ = false;
+    previewShown_ = false;
+    frameTimer_.reset(new QTimer());
+    frameTimer_->setSingleShot(true);
+    connect(frameTimer_.get(), &QTimer::timeout, this, [this]()
+    {
+        this->renderFrame();
+    });
+    lastFrame_.start();
+
     loadSettings("settings.ini");
 }
 
 MainWindow::~MainWindow()
 {
+    // Stop the loading and rendering threads before the window goes away
+    asyncLoader_.reset();
+    renderWorker_.reset();
+    pngExporter_.reset();
     delete ui;
 }
 
+void MainWindow::postToUi(std::function<void()> task)
+{
+    QCoreApplication::postEvent(this, new UiTaskEvent(task));
+}
+
+void MainWindow::customEvent(QEvent* event)
+{
+    if(event->type() == QEvent::User)
+    {
+        static_cast<UiTaskEvent*>(event)->run();
+    }
+}
+
 void MainWindow::loadSettings(const char* filePath)
 {
     settings_.reset(new QSettings(filePath, QSettings::IniFormat));
@@ -57,60 +125,69 @@ void MainWindow::loadSettings(const char* filePath)
     if(settings_->contains("autoLinearStep") == false) settings_->setValue("autoLinearStep", SET_AUTO_LINEAR_STEP);
     if(settings_->contains("autoLinearSize") == false) settings_->setValue("autoLinearSize", SET_AUTO_LINEAR_SIZE);
     if(settings_->contains("autoScale") == false) settings_->setValue("autoScale", SET_AUTO_SCALE);
+    if(settings_->contains("prefetchNext") == false) settings_->setValue("prefetchNext", SET_PREFETCH_NEXT);
+    if(settings_->contains("loadPreviewScale") == false) settings_->setValue("loadPreviewScale", SET_LOAD_PREVIEW_SCALE);
+    if(settings_->contains("pngCompression") == false) settings_->setValue("pngCompression", SET_PNG_COMPRESSION);
+    if(settings_->contains("dicomPreviewSize") == false) settings_->setValue("dicomPreviewSize", SET_DICOM_PREVIEW_SIZE);
+    if(settings_->contains("memoryPoolSize") == false) settings_->setValue("memoryPoolSize", SET_MEMORY_POOL_SIZE);
 
     settings_->sync();
 }
 
-void MainWindow::initialize(IplImage* image)
+void MainWindow::initialize(const cv::Mat& image)
 {
-    loadedImage_.reset(new cv::Mat(cv::cvarrToMat(image)));
-    positionAndSize_.reset(new cv::Rect(Utils::getGoodRect(loadedImage_.get(), imageWidget_->width(), imageWidget_->height())));
-    setMatToCorrectAspectRatio (loadedImage_.get(), positionAndSize_.get());
+    // The image is shared, not copied: it is never modified
+    loadedImage_.reset(new cv::Mat(image));
+    updateCanvas();
+    // The reduced copies used when zoomed out are built in background
+    pyramid_.reset(new ImagePyramid(*loadedImage_, PYRAMID_MIN_SIZE));
     minWidth_ = ZOOM_IN_MAX;
-    visibleWidth_ = loadedImage_->cols;
-    px_ = loadedImage_->cols/2;
-    py_ = loadedImage_->rows/2;
+    visibleWidth_ = positionAndSize_->width;
+    px_ = positionAndSize_->width/2;
+    py_ = positionAndSize_->height/2;
 }
 
-void MainWindow::setMatToCorrectAspectRatio (cv::Mat* img, cv::Rect* size)
+void MainWindow::updateCanvas()
 {
-    cv::Rect roi(size->x, size->y, img->cols, img->rows);
-    //cv::Scalar color(pow(2,img->depth()*8)-1);
-    cv::Scalar color(0);
-    cv::Mat image = cv::Mat( size->height, size->width, img->type(), color);
-    img->copyTo(image(roi));
-    image.copyTo(*img);
+    // The view moves over a canvas with the aspect ratio of the widget and the image centered in it
+    // (positionAndSize_). The canvas is only a view transform: its borders are drawn black by the renderer
+    positionAndSize_.reset(new cv::Rect(Utils::getGoodRect(loadedImage_.get(), imageWidget_->width(), imageWidget_->height())));
 }
 
-cv::Mat MainWindow::getImage( cv::Mat& img, float& x, float& y, int width, int target_width, int target_height, cv::Rect* roi)
+cv::Mat MainWindow::getImage( cv::Mat& img, float& x, float& y, int width, int target_width, int target_height, cv::Rect* roi, cv::Rect* region)
 {
-    assert(img.cols / target_width == img.rows / target_height);
+    const cv::Rect& canvas = *positionAndSize_;
+    assert(canvas.width / target_width == canvas.height / target_height);
     int height = (width * target_height) / target_width;
     int hWidth = width/2;
     int hHeight = height/2;
     //Fix bad points
-    x = (x < hWidth ? hWidth : ((x-hWidth)+width > img.cols ? (img.cols-width)+hWidth : x));
-    y = (y < hHeight ? hHeight : ((y-hHeight)+height > img.rows ? (img.rows-height)+hHeight : y));
-    //new image
-    cv::Mat image = cv::Mat( target_height, target_width, img.type());
+    x = (x < hWidth ? hWidth : ((x-hWidth)+width > canvas.width ? (canvas.width-width)+hWidth : x));
+    y = (y < hHeight ? hHeight : ((y-hHeight)+height > canvas.height ? (canvas.height-height)+hHeight : y));
     roi->x = x-hWidth;
     roi->y = y-hHeight;
     roi->width = width;
     roi->height = height;
-    cv::resize(img(*roi), image, image.size());
-    return image;
+    // Return the roi in the coarsest pyramid level that still has enough pixels for the screen:
+    // the cost of the resampling depends on the screen's size, not on the image's size
+    int levelScale = 1;
+    cv::Mat level = pyramid_ ? pyramid_->getLevel(static_cast<float>(width) / target_width, levelScale) : img;
+    // The roi in the level's pixels: it can exceed the image at the canvas' borders
+    float scale = static_cast<float>(levelScale);
+    region->x = static_cast<int>(std::floor((roi->x - canvas.x) / scale));
+    region->y = static_cast<int>(std::floor((roi->y - canvas.y) / scale));
+    region->width = roi->width / levelScale;
+    region->height = roi->height / levelScale;
+    return level;
 }
 
-void MainWindow::drawGraphics(cv::Mat* image, bool adjustToScreen)
+void MainWindow::drawGraphics(Overlay* overlay, bool adjustToScreen)
 {
     for(auto point : *points_.get())
     {
         cv::Point pt(point->intX(), point->intY());
-        if(adjustToScreen)
-        {
-            pt = worldPointToScreenPoint(pt);
-        }
-        cv::circle(*image, pt, POINT_RADIUS, cv::Scalar(127, 255, 127), CV_FILLED);
+        pt = (adjustToScreen ? worldPointToScreenPoint(pt) : worldPointToImagePoint(pt));
+        overlay->addCircle(pt, POINT_RADIUS, cv::Scalar(127, 255, 127));
     }
     if(points_->size() == 3)
     {
@@ -134,12 +211,12 @@ void MainWindow::drawGraphics(cv::Mat* image, bool adjustToScreen)
         }
         else
         {
-            sa = cv::Point(a->intX(), a->intY());
-            sb = cv::Point(b->intX(), b->intY());
-            sc = cv::Point(c->intX(), c->intY());
+            sa = worldPointToImagePoint(cv::Point(a->intX(), a->intY()));
+            sb = worldPointToImagePoint(cv::Point(b->intX(), b->intY()));
+            sc = worldPointToImagePoint(cv::Point(c->intX(), c->intY()));
         }
-        cv::line(*image, sa, sb, red);
-        cv::line(*image, sb, sc, red);
+        overlay->addLine(sa, sb, red);
+        overlay->addLine(sb, sc, red);
 
         //
         cv::Point v1(a->x-b->x, a->y-b->y);
@@ -150,11 +227,11 @@ void MainWindow::drawGraphics(cv::Mat* image, bool adjustToScreen)
         float ang = (rads * 180) / PI;
         float start = std::atan2(v1.y, v1.x);
         start = (start * 180) / PI;
-        ellipse( *image, sb, cv::Size(POINT_RADIUS+10,POINT_RADIUS+10), start, 0, ang, blue);
+        overlay->addArc(sb, POINT_RADIUS+10, start, ang, blue);
 
         //
         cv::Point sd(Utils::rotatePoint(sc, sb, (PI-rads)));
-        cv::line(*image, sb, sd, orange);
+        overlay->addLine(sb, sd, orange);
 
         cv::Point vecB1 ( sb + ((sc - sb) * WEDGE_LOCATION_FACTOR));
         cv::Point vecB0(Utils::rotatePoint(vecB1, sb, -(PI*WEDGE_SIZE_ANGLE)));
@@ -165,17 +242,17 @@ void MainWindow::drawGraphics(cv::Mat* image, bool adjustToScreen)
         {
             vecB0 = Utils::rotatePoint(vecB0, vecB0 + (vecB2 - vecB0), WEDGE_ANGLE);
             vecB2 = Utils::rotatePoint(vecB2, vecB0 + (vecB2 - vecB0), WEDGE_ANGLE);
-            cv::line(*image, vecB0, vecB2, orange);
+            overlay->addLine(vecB0, vecB2, orange);
             cv::Point vecB3(Utils::rotatePoint(vecB0, vecB2, (PI-rads)));
-            cv::line(*image, vecB2, vecB3, orange);
+            overlay->addLine(vecB2, vecB3, orange);
         }
         else if(ang < 0.0)
         {
             vecB0 = Utils::rotatePoint(vecB0, vecB2 + (vecB0 - vecB2), -WEDGE_ANGLE);
             vecB2 = Utils::rotatePoint(vecB2, vecB2 + (vecB0 - vecB2), -WEDGE_ANGLE);
-            cv::line(*image, vecB0, vecB2, orange);
+            overlay->addLine(vecB0, vecB2, orange);
             cv::Point vecB3(Utils::rotatePoint(vecB2, vecB0, (PI-rads)));
-            cv::line(*image, vecB0, vecB3, orange);
+            overlay->addLine(vecB0, vecB3, orange);
         }
 
         //Text
@@ -199,36 +276,86 @@ void MainWindow::drawGraphics(cv::Mat* image, bool adjustToScreen)
         cv::Size textSize = cv::getTextSize(text, fontFace, fontScale, thickness, &baseline);
         cv::Point textOrg(sb.x + POINT_RADIUS+20, sb.y + (textSize.height/2));
         // then put the text itself
-        cv::putText(*image, text, textOrg, fontFace, fontScale, white, thickness, 8);
-        cv::putText(*image, std::string("o"), textOrg + cv::Point(textSize.width, -textSize.height/2), fontFace, fontScale *(2.0/3.0), white, thickness, 8);
+        overlay->addText(textOrg, text, fontScale, white);
+        overlay->addText(textOrg + cv::Point(textSize.width, -textSize.height/2), std::string("o"), fontScale *(2.0/3.0), white);
         ss.str(std::string());
         ss << "wedge size: " << (180.0f - ang) << " mm";
-        cv::putText(*image, ss.str(), textOrg + cv::Point(0, +textSize.height*1.3f), fontFace, fontScale, white, thickness, 8);
+        overlay->addText(textOrg + cv::Point(0, +textSize.height*1.3f), ss.str(), fontScale, white);
         ss.str(std::string());
         ss << type;
-        cv::putText(*image, ss.str(), textOrg + cv::Point(0, -textSize.height*1.3f), fontFace, fontScale, white, thickness, 8);
+        overlay->addText(textOrg + cv::Point(0, -textSize.height*1.3f), ss.str(), fontScale, white);
     }
 }
 
 void MainWindow::updateScreenImage()
 {
-    if(loadedImage_.get() == NULL)
+    // The preview of the image being loaded stays on screen until the loading ends
+    if(loadedImage_.get() == NULL || previewShown_)
     {
         return;
     }
-    cv::Mat displayImage = getImage(*loadedImage_, px_, py_, visibleWidth_, imageWidget_->width(), imageWidget_->height(), displayRoi_.get());
-    zoomFactor_ = static_cast<float>(visibleWidth_)/static_cast<float>(imageWidget_->width());
-    //convert to 8bits color
-    cv::Mat colorImage;
-    convertTo8BitColor(displayImage, colorImage);
-    // draw points, lines, etc if they exist in a different image
-    cv::Mat draws(colorImage.rows, colorImage.cols, colorImage.type(), cv::Scalar::all(0));
-    drawGraphics(&draws);
-    // sum the 2 images (the dicom image wuth the draws image)
-    cv::add(colorImage, draws, displayImage);
+    int width = imageWidget_->width();
+    int height = imageWidget_->height();
+    // the frame is rendered in background: the view is applied when it is presented
+    RenderWorker::View view;
+    view.source = getImage(*loadedImage_, px_, py_, visibleWidth_, width, height, &view.roi, &view.region);
+    view.size = cv::Size(width, height);
+    view.windowCenter = windowCenter_;
+    view.windowWidth = windowWidth_;
+    view.preview = false;
+    renderWorker_->request(view);
+}
+
+void MainWindow::presentFrame()
+{
+    if(!renderWorker_->swapFrame())
+    {
+        return;
+    }
+    const RenderWorker::Frame& frame = renderWorker_->front();
     //display the final image
-    imageWidget_->showImage(displayImage);
+    imageWidget_->showFrame(frame.image);
+    if(frame.view.preview)
+    {
+        // The preview has no annotations and doesn't change the view of the current image
+        imageWidget_->setOverlay(Overlay());
+        return;
+    }
+    *displayRoi_ = frame.view.roi;
+    zoomFactor_ = static_cast<float>(frame.view.roi.width)/static_cast<float>(frame.image.cols);
+    // points, lines, etc are painted by the widget over the pixels
+    updateOverlay();
+}
 
+void MainWindow::updateOverlay()
+{
+    Overlay overlay;
+    drawGraphics(&overlay);
+    imageWidget_->setOverlay(overlay);
+}
+
+void MainWindow::scheduleRender(bool image)
+{
+    imageDirty_ |= image;
+    if(!frameTimer_->isActive())
+    {
+        // The 1st change after an idle period is drawn immediately, the following ones in the next frame
+        frameTimer_->start(std::max(0, FRAME_INTERVAL - static_cast<int>(lastFrame_.elapsed())));
+    }
+}
+
+void MainWindow::renderFrame()
+{
+    if(imageDirty_)
+    {
+        updateScreenImage();
+    }
+    else
+    {
+        updateOverlay();
+    }
+    imageDirty_ = false;
+    lastFrame_.restart();
 }
 
 void MainWindow::updateStatus()
@@ -242,7 +369,7 @@ void MainWindow::updateStatus()
     std::string gp = "<font color=\"green\">";
     std::string rp = "<font color=\"red\">";
     std::string s = "</font>";
-    ss << gp<<dicomImage_->image->width<<s<< "x" << gp<<dicomImage_->image->height<<s;
+    ss << gp<<dicomImage_->image.cols<<s<< "x" << gp<<dicomImage_->image.rows<<s;
     ss << "  Name: " << bp<<dicomImage_->name<<s;
     ss << ", Birthday: " << bp<<dicomImage_->birthday<<s;
     ss << ", Gender: " << bp<<dicomImage_->gender<<s;
@@ -252,49 +379,182 @@ void MainWindow::updateStatus()
 
 void MainWindow::loadImage(const wchar_t* filename)
 {
-    clearPoints();
-    dicomImage_.reset();
-    dicomImage_ = DicomLoader().loadImage(filename);
-    if(dicomImage_.get() == NULL)
+    // The current image stays on screen until the new one is loaded
+    statusBar()->showMessage(tr("Loading..."));
+    // The decoding buffers of the previous images are kept (up to this size, in MB) to be reused by the next ones
+    puntoexe::memoryPool::getMemoryPool()->setMaxSize((size_t)settings_->value("memoryPoolSize").toInt() << 20);
+    asyncLoader_->setPreviewScale((std::uint32_t)std::max(settings_->value("loadPreviewScale").toInt(), 0));
+    asyncLoader_->load(filename);
+}
+
+void MainWindow::imagePreviewed(const std::wstring& path, std::shared_ptr<DicomImage> preview)
+{
+    // A preview posted before the cancellation can arrive after it
+    if(!asyncLoader_->isLoading() || preview->image.type() != CV_16UC1)
+    {
+        return;
+    }
+    // The whole preview letterboxed in the widget, through the window of the file
+    int width = imageWidget_->width();
+    int height = imageWidget_->height();
+    cv::Rect canvas = Utils::getGoodRect(&preview->image, width, height);
+    RenderWorker::View view;
+    view.source = preview->image;
+    view.region = cv::Rect(-canvas.x, -canvas.y, canvas.width, canvas.height);
+    view.size = cv::Size(width, height);
+    view.windowCenter = preview->windowWidth > 0 ? preview->windowCenter : WINDOW_DEFAULT_CENTER;
+    view.windowWidth = preview->windowWidth > 0 ? preview->windowWidth : WINDOW_DEFAULT_WIDTH;
+    view.preview = true;
+    previewShown_ = true;
+    renderWorker_->request(view);
+}
+
+void MainWindow::hidePreview()
+{
+    if(!previewShown_)
+    {
+        return;
+    }
+    previewShown_ = false;
+    if(loadedImage_.get() == NULL)
+    {
+        imageWidget_->showFrame(cv::Mat());
+    }
+    else
+    {
+        updateScreenImage();
+    }
+}
+
+void MainWindow::imageLoaded(const std::wstring& path, std::shared_ptr<DicomImage> image)
+{
+    statusBar()->clearMessage();
+    hidePreview();
+    if(image.get() == NULL)
     {
         QMessageBox messageBox;
         messageBox.critical(0,"Error","It's not possible to load this DICOM.");
         messageBox.show();
         return;
     }
+    clearPoints();
+    dicomImage_ = image;
     initialize(dicomImage_->image);
     assert(loadedImage_ != NULL);
+    resetWindow();
     updateScreenImage();
     updateStatus();
     layoutWindow_->setEnabled(true);
+
+    // Read the next file of the folder while this one is viewed
+    if(settings_->value("prefetchNext").toBool())
+    {
+        std::wstring next = Utils::siblingFile(path, QStringList() << "*.dcm" << "*.dicom", 1);
+        if(!next.empty())
+        {
+            asyncLoader_->prefetch(next);
+        }
+    }
 }
 
-void MainWindow::convertTo8BitColor(cv::Mat& src, cv::Mat& dst)
+void MainWindow::showLoadProgress(DicomLoader::Stage stage, int percent)
 {
-    cv::Mat img(src);
-    //convert to 8bits if necessary
-    if(img.depth() == CV_16U)
+    // A progress posted before the cancellation can arrive after it
+    if(!asyncLoader_->isLoading())
     {
-        img.convertTo(img, CV_8U, FACTOR_16TO8);
+        return;
+    }
+    const char* stages[] = {"Reading", "Decoding", "Converting"};
+    std::stringstream ss;
+    ss << stages[stage] << "... " << percent << "% (Esc to cancel)";
+    statusBar()->showMessage(ss.str().c_str());
+}
+
+void MainWindow::resetWindow()
+{
+    // The window of the file, or the whole 16bit range
+    if(dicomImage_.get() != NULL && dicomImage_->windowWidth > 0)
+    {
+        windowCenter_ = dicomImage_->windowCenter;
+        windowWidth_ = dicomImage_->windowWidth;
+    }
+    else
+    {
+        windowCenter_ = WINDOW_DEFAULT_CENTER;
+        windowWidth_ = WINDOW_DEFAULT_WIDTH;
+    }
+}
+
+void MainWindow::openSibling(int step)
+{
+    if(dicomImage_.get() == NULL)
+    {
+        return;
+    }
+    std::wstring sibling = Utils::siblingFile(dicomImage_->path, QStringList() << "*.dcm" << "*.dicom", step);
+    if(!sibling.empty())
+    {
+        loadImage(sibling.c_str());
     }
-    //convert to a color image (cv::Mat with 3 channels)
-    std::vector<cv::Mat> channels(3);
-    channels.at(0) = img; //for blue channel
-    channels.at(1) = img; //for green channel
-    channels.at(2) = img; //for red channel
-    //merge the 3 channels in one single cv::Mat
-    cv::merge(channels, dst);
 }
 
 void MainWindow::saveImage(cv::Mat& image, const char* filename)
 {
-    std::vector<int> params;
-    params.push_back(CV_IMWRITE_PNG_COMPRESSION);
-    params.push_back(0);
-    cv::Mat colorImage;
-    convertTo8BitColor(image, colorImage);
-    drawGraphics(&colorImage, false);
-    cv::imwrite(filename, colorImage, params);
+    // Rendered through the current window and written in strips in background
+    Overlay overlay;
+    drawGraphics(&overlay, false);
+    pngExporter_->start(filename, image, overlay, windowCenter_, windowWidth_, settings_->value("pngCompression").toInt());
+}
+
+void MainWindow::showExportProgress(int percent)
+{
+    // A progress posted before the cancellation can arrive after it
+    if(!pngExporter_->isExporting())
+    {
+        return;
+    }
+    std::stringstream ss;
+    ss << "Saving... " << percent << "% (Esc to cancel)";
+    statusBar()->showMessage(ss.str().c_str());
+}
+
+void MainWindow::exportFinished(const std::string& filename, bool ok)
+{
+    if(ok)
+    {
+        statusBar()->showMessage(tr("Saved %1").arg(QString::fromStdString(filename)), 2000);
+    }
+    else
+    {
+        statusBar()->clearMessage();
+        QMessageBox::warning(this, tr(APP_NAME), tr("The image could not be saved"), QMessageBox::Ok, QMessageBox::Ok);
+    }
+}
+
+void MainWindow::exportDicom(const std::wstring& filename)
+{
+    // Only the annotations and the window are written: the presentation state references the loaded file
+    Overlay overlay;
+    drawGraphics(&overlay, false);
+    bool ok = DicomExporter::writePresentationState(filename, *dicomImage_, overlay, windowCenter_, windowWidth_);
+    int previewSize = settings_->value("dicomPreviewSize").toInt();
+    if(ok && previewSize > 0)
+    {
+        // Reduced copy with the annotations, rendered from the pyramid level closest to its size
+        int levelScale = 1;
+        float factor = static_cast<float>(std::max(loadedImage_->cols, loadedImage_->rows)) / previewSize;
+        cv::Mat level = pyramid_->getLevel(factor, levelScale);
+        std::wstring previewName = filename.substr(0, filename.find_last_of(L'.')) + L"_preview.dcm";
+        ok = DicomExporter::writeSecondaryCapture(previewName, *dicomImage_, level, overlay, windowCenter_, windowWidth_, previewSize);
+    }
+    if(ok)
+    {
+        statusBar()->showMessage(tr("Exported %1").arg(QString::fromStdWString(filename)), 2000);
+    }
+    else
+    {
+        QMessageBox::warning(this, tr(APP_NAME), tr("The plan could not be exported"), QMessageBox::Ok, QMessageBox::Ok);
+    }
 }
 
 void MainWindow::wheelEvent(QWheelEvent * event){ioProcessor_->wheelEvent(event);}
@@ -326,7 +586,8 @@ void MainWindow::resizeEvent(QResizeEvent*)
         int h = availableSize.height() - availableSize.height()%2;
         imageWidget_->setFixedSize(w, h);
 
-        initialize(dicomImage_->image);
+        // Only the view changes: the image and its pyramid are kept
+        updateCanvas();
 
         while(points.size() > 0)
         {
@@ -341,7 +602,7 @@ void MainWindow::resizeEvent(QResizeEvent*)
         py_ = static_cast<int>(fy * positionAndSize_->height);
         visibleWidth_ = static_cast<int>(fw * positionAndSize_->width);
 
-        updateScreenImage();
+        scheduleRender();
     }
 }
 
@@ -358,6 +619,12 @@ cv::Point MainWindow::screenPointToWorldPoint (cv::Point point)
     return point;
 }
 
+cv::Point MainWindow::worldPointToImagePoint (cv::Point point)
+{
+    // remove the canvas' border
+    return cv::Point(point.x - positionAndSize_->x, point.y - positionAndSize_->y);
+}
+
 cv::Point MainWindow::worldPointToScreenPoint (cv::Point point)
 {
     point.x -= displayRoi_->x;
@@ -423,7 +690,7 @@ void MainWindow::automatic()
     assert(scale > 0);
 
     cv::Mat img;
-    cv::Mat temp(cv::cvarrToMat(dicomImage_->image));
+    const cv::Mat& temp = dicomImage_->image;
     cv::resize( temp, img, cv::Size(temp.cols / scale, temp.rows / scale));
     if(img.depth() == CV_16U)
     {
@@ -477,7 +744,7 @@ void MainWindow::automatic()
     addPoint( positionAndSize_->x + pointsB.first[0]*scale, positionAndSize_->y + pointsB.first[1]*scale);
     addPoint( positionAndSize_->x + pointsB.second[0]*scale, positionAndSize_->y + pointsB.second[1]*scale);
 
-    updateScreenImage();
+    scheduleRender(false);
 }
 
 void MainWindow::addPoint( int x, int y)
@@ -491,9 +758,9 @@ void MainWindow::centerImage()
     {
         return;
     }
-    visibleWidth_ = loadedImage_->cols;
-    px_ = loadedImage_->cols/2;
-    py_ = loadedImage_->rows/2;
+    visibleWidth_ = positionAndSize_->width;
+    px_ = positionAndSize_->width/2;
+    py_ = positionAndSize_->height/2;
 }
 
 void MainWindow::eventHandler(Events event, void* parameters)
@@ -516,7 +783,7 @@ void MainWindow::eventHandler(Events event, void* parameters)
             if(step > 0)
             {
                 visibleWidth_ -= step;
-                updateScreenImage();
+                scheduleRender();
             }
         }
         break;
@@ -532,12 +799,12 @@ void MainWindow::eventHandler(Events event, void* parameters)
             unsigned int numberOfZoom = (parameters != NULL ? *static_cast<int*>(parameters) : 1);
             for(; numberOfZoom !=0 ; --numberOfZoom)
             {
-                step += ((visibleWidth_+step) + ZOOM_STEP <= loadedImage_->cols ? ZOOM_STEP : loadedImage_->cols - (visibleWidth_+step));
+                step += ((visibleWidth_+step) + ZOOM_STEP <= positionAndSize_->width ? ZOOM_STEP : positionAndSize_->width - (visibleWidth_+step));
             }
             if(step > 0)
             {
                 visibleWidth_ += step;
-                updateScreenImage();
+                scheduleRender();
             }
         }
         break;
@@ -545,28 +812,28 @@ void MainWindow::eventHandler(Events event, void* parameters)
         case MOVE_UP:
         {
             py_ -= MOVE_STEP;
-            updateScreenImage();
+            scheduleRender();
         }
         break;
 
         case MOVE_DOWN:
         {
             py_ += MOVE_STEP;
-            updateScreenImage();
+            scheduleRender();
         }
         break;
 
         case MOVE_LEFT:
         {
             px_ -= MOVE_STEP;
-            updateScreenImage();
+            scheduleRender();
         }
         break;
 
         case MOVE_RIGHT:
         {
             px_ += MOVE_STEP;
-            updateScreenImage();
+            scheduleRender();
         }
         break;
 
@@ -586,31 +853,33 @@ void MainWindow::eventHandler(Events event, void* parameters)
                 idx = (idx == -1 ? lastIdx_ : idx);
                 if(idx != -1)
                 {
+                    // only the annotations change: the image is not rendered again
                     Point* p = points_->at(idx).get();
                     p->x += x;
                     p->y += y;
                     lastIdx_ = idx;
+                    scheduleRender(false);
                 }
                 else
                 {
                     px_ -= x;
                     py_ -= y;
+                    scheduleRender();
                 }
-                updateScreenImage();
             }
         }
         break;
 
         case MOUSE_LEFT_RELEASE:
         {
-            if(lastIdx_ == -1 && points_->size() < 3 && parameters != NULL)
+            if(lastIdx_ == -1 && points_->size() < 3 && parameters != NULL && !previewShown_)
             {
                 std::pair<int,int> data = *static_cast<std::pair<int,int>*>(parameters);
                 cv::Point point = screenPointToWorldPoint(cv::Point(data.first, data.second));
                 if(point.x >= 0 && point.y >= 0)
                 {
                     addPoint(point.x,point.y);
-                    updateScreenImage();
+                    scheduleRender(false);
                 }
             }
             lastIdx_ = -1;
@@ -627,7 +896,7 @@ void MainWindow::eventHandler(Events event, void* parameters)
                 if(idx != -1)
                 {
                     points_->erase(points_->begin() + idx);
-                    updateScreenImage();
+                    scheduleRender(false);
                 }
             }
         }
@@ -636,7 +905,7 @@ void MainWindow::eventHandler(Events event, void* parameters)
         case CENTER:
         {
             centerImage();
-            updateScreenImage();
+            scheduleRender();
         }
         break;
 
@@ -657,10 +926,20 @@ void MainWindow::eventHandler(Events event, void* parameters)
         }
         break;
 
+        case EXPORT_DICOM:
+        {
+            const wchar_t* filename = const_cast<const wchar_t*>(static_cast<wchar_t*>(parameters));
+            if(dicomImage_ != NULL)
+            {
+                exportDicom(filename);
+            }
+        }
+        break;
+
         case CLEAR_POINTS:
         {
             clearPoints();
-            updateScreenImage();
+            scheduleRender(false);
         }
         break;
 
@@ -671,7 +950,7 @@ void MainWindow::eventHandler(Events event, void* parameters)
                 leg_ = Leg::LEFT;
                 updateStatus();
                 clearPoints();
-                updateScreenImage();
+                scheduleRender(false);
             }
         }
         break;
@@ -682,14 +961,14 @@ void MainWindow::eventHandler(Events event, void* parameters)
                 leg_ = Leg::RIGHT;
                 updateStatus();
                 clearPoints();
-                updateScreenImage();
+                scheduleRender(false);
             }
         }
         break;
 
         case HELP:
         {
-            WindowDialog helpWindow(this, "<b>Key - function</b><p><b>Esc</b> - Close<p><b>Space</b> - Center image<p><b>c</b> - Clear points<p><b>wasd/directional</b> - Move<p><b>+-</b> - zoom<p><b>Left Click</b> - Add point<p><b>Right Click</b> - Remove point<p><b>Mouse click and drag</b> - Pan<p><b>Mouse click and drag over point</b> - Move point<p><b>Mouse Scroll</b> - Zoom");
+            WindowDialog helpWindow(this, "<b>Key - function</b><p><b>Esc</b> - Cancel loading / Close<p><b>Page Down/Up</b> - Open next/previous DICOM of the folder<p><b>Space</b> - Center image<p><b>c</b> - Clear points<p><b>r</b> - Reset window/level<p><b>wasd/directional</b> - Move<p><b>+-</b> - zoom<p><b>Left Click</b> - Add point<p><b>Right Click</b> - Remove point<p><b>Right click and drag</b> - Window/level<p><b>Mouse click and drag</b> - Pan<p><b>Mouse click and drag over point</b> - Move point<p><b>Mouse Scroll</b> - Zoom");
             helpWindow.exec();
         }
         break;
@@ -713,5 +992,60 @@ void MainWindow::eventHandler(Events event, void* parameters)
             settingsWindow.exec();
         }
         break;
+
+        case CANCEL:
+        {
+            if(asyncLoader_->isLoading())
+            {
+                asyncLoader_->cancel();
+                hidePreview();
+                statusBar()->showMessage(tr("Loading cancelled"), 2000);
+            }
+            else if(pngExporter_->isExporting())
+            {
+                pngExporter_->cancel();
+                statusBar()->showMessage(tr("Saving cancelled"), 2000);
+            }
+            else
+            {
+                exit(0);
+            }
+        }
+        break;
+
+        case WINDOW:
+        {
+            if(loadedImage_.get() != NULL && parameters != NULL)
+            {
+                // horizontal drag changes the width (contrast), vertical drag the center (brightness)
+                std::pair<int,int> delta = *static_cast<std::pair<int,int>*>(parameters);
+                windowWidth_ = std::max(windowWidth_ + delta.first * WINDOW_STEP, 2.0);
+                windowCenter_ += delta.second * WINDOW_STEP;
+                scheduleRender();
+            }
+        }
+        break;
+
+        case WINDOW_RESET:
+        {
+            if(loadedImage_.get() != NULL)
+            {
+                resetWindow();
+                scheduleRender();
+            }
+        }
+        break;
+
+        case OPEN_NEXT:
+        {
+            openSibling(1);
+        }
+        break;
+
+        case OPEN_PREVIOUS:
+        {
+            openSibling(-1);
+        }
+        break;
     }
 }
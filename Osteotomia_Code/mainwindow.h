@@ -4,11 +4,18 @@
 #include <QMainWindow>
 #include <QMessageBox>
 #include <QSettings>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <opencv2/opencv.hpp>
 #include "config.h"
 #include "utils.h"
 #include "cvimagewidget.h"
 #include "dicomloader.h"
+#include "asyncloader.h"
+#include "imagepyramid.h"
+#include "renderworker.h"
+#include "pngexporter.h"
+#include "dicomexporter.h"
 #include "layoutwindow.h"
 #include "ioprocessor.h"
 #include "events.h"
@@ -87,25 +94,37 @@ protected:
      void mousePressEvent(QMouseEvent * event);
      void mouseReleaseEvent(QMouseEvent * event);
      void resizeEvent(QResizeEvent* event);
+     void customEvent(QEvent* event);
 private:
     Ui::MainWindow *ui;
 
     std::shared_ptr<DicomImage> dicomImage_;
+    std::shared_ptr<AsyncLoader> asyncLoader_;
     std::shared_ptr<IOProcessor> ioProcessor_;
     std::shared_ptr<CVImageWidget> imageWidget_;
     std::shared_ptr<cv::Mat> loadedImage_;
+    std::shared_ptr<ImagePyramid> pyramid_;
+    std::shared_ptr<RenderWorker> renderWorker_;
+    std::shared_ptr<PngExporter> pngExporter_;
     std::shared_ptr<LayoutWindow> layoutWindow_;
     std::shared_ptr<QLabel> statusLabel_;
     std::shared_ptr<cv::Rect> positionAndSize_;
     std::shared_ptr<cv::Rect> displayRoi_;
     std::shared_ptr<std::vector<std::shared_ptr<Point>>> points_;
     std::shared_ptr<QSettings> settings_;
+    std::shared_ptr<QTimer> frameTimer_;
+    QElapsedTimer lastFrame_;
+    bool imageDirty_;
+    // A reduced image is shown while the image is being loaded
+    bool previewShown_;
     int minWidth_;
     int visibleWidth_;
     float px_;
     float py_;
     int lastIdx_;
     float zoomFactor_;
+    double windowCenter_;
+    double windowWidth_;
     Leg leg_;
 
 
@@ -116,20 +135,35 @@ public:
     void eventHandler(Events event, void* parameters);
 
 private:
-    void initialize(IplImage* image);
-    void setMatToCorrectAspectRatio (cv::Mat* image, cv::Rect* positionAndSize);
-    cv::Mat getImage( cv::Mat& img, float& x, float& y, int width, int target_width, int target_height, cv::Rect* roi);
+    void initialize(const cv::Mat& image);
+    void updateCanvas();
+    cv::Mat getImage( cv::Mat& img, float& x, float& y, int width, int target_width, int target_height, cv::Rect* roi, cv::Rect* region);
     void updateScreenImage();
+    void updateOverlay();
+    void presentFrame();
+    void scheduleRender(bool image = true);
+    void renderFrame();
     void loadImage(const wchar_t* filename);
+    void imageLoaded(const std::wstring& path, std::shared_ptr<DicomImage> image);
+    void imagePreviewed(const std::wstring& path, std::shared_ptr<DicomImage> preview);
+    // Show the current image again instead of the preview
+    void hidePreview();
+    void showLoadProgress(DicomLoader::Stage stage, int percent);
+    void openSibling(int step);
+    void resetWindow();
+    void postToUi(std::function<void()> task);
     void saveImage(cv::Mat& image, const char* filename);
+    void showExportProgress(int percent);
+    void exportFinished(const std::string& filename, bool ok);
+    void exportDicom(const std::wstring& filename);
     int mouseOverPoint (cv::Point mousePoint);
     cv::Point screenPointToWorldPoint (cv::Point point);
     cv::Point worldPointToScreenPoint (cv::Point point);
+    cv::Point worldPointToImagePoint (cv::Point point);
     void centerImage();
     void clearPoints();
     void updateStatus();
-    void drawGraphics(cv::Mat* image, bool adjustToScreen = true);
-    void convertTo8BitColor(cv::Mat& src, cv::Mat& dst);
+    void drawGraphics(Overlay* overlay, bool adjustToScreen = true);
     void automatic();
     void addPoint( int x, int y);
     Vec2iPair getAutoPoint( cv::Mat& bone, cv::Mat& image, BoneDetector::Bone boneName, double& factor);
@@ -0,0 +1,149 @@
+#include "overlay.h"
+
+namespace
+{
+const int FONT_FACE = cv::FONT_HERSHEY_SIMPLEX;
+// Pixels around the shapes touched by the lines' width and antialiasing
+const int MARGIN = 2;
+
+QColor toQColor(const cv::Scalar& color)
+{
+    return QColor(static_cast<int>(color[2]), static_cast<int>(color[1]), static_cast<int>(color[0]));
+}
+}
+
+void Overlay::clear()
+{
+    shapes_.clear();
+}
+
+bool Overlay::empty() const
+{
+    return shapes_.empty();
+}
+
+void Overlay::addCircle(const cv::Point& center, int radius, const cv::Scalar& color)
+{
+    Shape shape = {CIRCLE, center, center, radius, 0, 0, std::string(), 0, color};
+    shapes_.push_back(shape);
+}
+
+void Overlay::addLine(const cv::Point& a, const cv::Point& b, const cv::Scalar& color)
+{
+    Shape shape = {LINE, a, b, 0, 0, 0, std::string(), 0, color};
+    shapes_.push_back(shape);
+}
+
+void Overlay::addArc(const cv::Point& center, int radius, double start, double sweep, const cv::Scalar& color)
+{
+    Shape shape = {ARC, center, center, radius, start, sweep, std::string(), 0, color};
+    shapes_.push_back(shape);
+}
+
+void Overlay::addText(const cv::Point& origin, const std::string& text, double fontScale, const cv::Scalar& color)
+{
+    Shape shape = {TEXT, origin, origin, 0, 0, 0, text, fontScale, color};
+    shapes_.push_back(shape);
+}
+
+const std::vector<Overlay::Shape>& Overlay::shapes() const
+{
+    return shapes_;
+}
+
+cv::Rect Overlay::shapeBounds(const Shape& shape)
+{
+    cv::Rect rect;
+    switch(shape.type)
+    {
+        case CIRCLE:
+        case ARC:
+            rect = cv::Rect(shape.a.x - shape.radius, shape.a.y - shape.radius, shape.radius * 2 + 1, shape.radius * 2 + 1);
+            break;
+        case LINE:
+            rect = cv::Rect(shape.a, shape.b);
+            rect.width += 1;
+            rect.height += 1;
+            break;
+        case TEXT:
+        {
+            int baseline = 0;
+            cv::Size size = cv::getTextSize(shape.text, FONT_FACE, shape.fontScale, 1, &baseline);
+            // QPainter's font is a bit wider than the Hershey font
+            rect = cv::Rect(shape.a.x, shape.a.y - size.height, size.width + size.width / 4, size.height + baseline);
+        }
+        break;
+    }
+    return cv::Rect(rect.x - MARGIN, rect.y - MARGIN, rect.width + MARGIN * 2, rect.height + MARGIN * 2);
+}
+
+cv::Rect Overlay::bounds() const
+{
+    cv::Rect rect;
+    for(const Shape& shape : shapes_)
+    {
+        rect = (rect.area() == 0 ? shapeBounds(shape) : rect | shapeBounds(shape));
+    }
+    return rect;
+}
+
+void Overlay::paint(QPainter& painter) const
+{
+    painter.setRenderHint(QPainter::Antialiasing);
+    for(const Shape& shape : shapes_)
+    {
+        QColor color(toQColor(shape.color));
+        painter.setPen(color);
+        painter.setBrush(Qt::NoBrush);
+        switch(shape.type)
+        {
+            case CIRCLE:
+                painter.setBrush(color);
+                painter.drawEllipse(QPoint(shape.a.x, shape.a.y), shape.radius, shape.radius);
+                break;
+            case LINE:
+                painter.drawLine(shape.a.x, shape.a.y, shape.b.x, shape.b.y);
+                break;
+            case ARC:
+                // QPainter's angles are counterclockwise, in 1/16 of degree
+                painter.drawArc(shape.a.x - shape.radius, shape.a.y - shape.radius, shape.radius * 2, shape.radius * 2,
+                                static_cast<int>(-shape.start * 16), static_cast<int>(-shape.sweep * 16));
+                break;
+            case TEXT:
+            {
+                int baseline = 0;
+                cv::Size size = cv::getTextSize(shape.text, FONT_FACE, shape.fontScale, 1, &baseline);
+                QFont font(painter.font());
+                // Hershey's height is the capitals' height, about 70% of the font's size
+                font.setPixelSize(std::max(1, static_cast<int>(size.height / 0.7)));
+                painter.setFont(font);
+                painter.drawText(shape.a.x, shape.a.y, QString::fromStdString(shape.text));
+            }
+            break;
+        }
+    }
+}
+
+void Overlay::rasterize(cv::Mat& image, const cv::Point& offset, double scale) const
+{
+    for(const Shape& shape : shapes_)
+    {
+        cv::Point a(cvRound(shape.a.x * scale) + offset.x, cvRound(shape.a.y * scale) + offset.y);
+        cv::Point b(cvRound(shape.b.x * scale) + offset.x, cvRound(shape.b.y * scale) + offset.y);
+        switch(shape.type)
+        {
+            case CIRCLE:
+                cv::circle(image, a, shape.radius, shape.color, CV_FILLED);
+                break;
+            case LINE:
+                cv::line(image, a, b, shape.color);
+                break;
+            case ARC:
+                cv::ellipse(image, a, cv::Size(shape.radius, shape.radius), shape.start, 0, shape.sweep, shape.color);
+                break;
+            case TEXT:
+                cv::putText(image, shape.text, a, FONT_FACE, shape.fontScale, shape.color, 1, 8);
+                break;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <QPainter>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <string>
+
+// Retained vector scene of the annotations (points, lines, angle, wedge and labels) drawn over the image.
+// The widget paints it with QPainter over the rendered frame, so changing an annotation only repaints the
+// area it covers; the same scene is rasterized with OpenCV when the image is saved.
+class Overlay
+{
+public:
+    void clear();
+    bool empty() const;
+    void addCircle(const cv::Point& center, int radius, const cv::Scalar& color);
+    void addLine(const cv::Point& a, const cv::Point& b, const cv::Scalar& color);
+    // Arc of a circle, angles in degrees (clockwise, as cv::ellipse)
+    void addArc(const cv::Point& center, int radius, double start, double sweep, const cv::Scalar& color);
+    // origin is the bottom-left corner of the text, as cv::putText
+    void addText(const cv::Point& origin, const std::string& text, double fontScale, const cv::Scalar& color);
+    // Area covered by the shapes (empty if there aren't any)
+    cv::Rect bounds() const;
+    void paint(QPainter& painter) const;
+    // Draw the shapes with their positions multiplied by scale and moved by offset: a strip of rows starting at
+    // row y is drawn with offset (0, -y). The sizes (radius, text) are not scaled
+    void rasterize(cv::Mat& image, const cv::Point& offset = cv::Point(), double scale = 1.0) const;
+
+    enum Type
+    {
+        CIRCLE,
+        LINE,
+        ARC,
+        TEXT
+    };
+
+    struct Shape
+    {
+        Type type;
+        cv::Point a;
+        cv::Point b;
+        int radius;
+        double start;
+        double sweep;
+        std::string text;
+        double fontScale;
+        cv::Scalar color;
+    };
+
+    const std::vector<Shape>& shapes() const;
+
+private:
+    static cv::Rect shapeBounds(const Shape& shape);
+
+    std::vector<Shape> shapes_;
+};
+
+#endif // OVERLAY_H
@@ -0,0 +1,287 @@
+#include "pngexporter.h"
+#include "renderer.h"
+#include <fstream>
+#include <cstdio>
+#include <vector>
+#ifdef _WIN32
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+namespace
+{
+// Rows of a strip
+const int STRIP_ROWS = 64;
+// deflate's window: the bytes of the previous strip that can be referenced
+const size_t DICTIONARY_SIZE = 32768;
+
+struct Strip
+{
+    // filtered rows
+    std::vector<Bytef> raw;
+    std::vector<Bytef> compressed;
+    uLong adler;
+    bool ok;
+};
+
+// Converts the BGRA rows of the strips to PNG rows (RGB, filter Sub)
+class FilterStrips : public cv::ParallelLoopBody
+{
+public:
+    FilterStrips(const cv::Mat& batch, std::vector<Strip>& strips) :
+        batch_(batch), strips_(strips)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        const size_t rowBytes = batch_.cols * 3 + 1;
+        for(int i = range.start; i < range.end; ++i)
+        {
+            Strip& strip = strips_[i];
+            int first = i * STRIP_ROWS;
+            int rows = std::min(STRIP_ROWS, batch_.rows - first);
+            strip.raw.resize(rows * rowBytes);
+            for(int y = 0; y < rows; ++y)
+            {
+                const std::uint8_t* in = batch_.ptr<std::uint8_t>(first + y);
+                Bytef* out = &strip.raw[y * rowBytes];
+                // filter type 1 (Sub): difference with the pixel on the left
+                *out++ = 1;
+                std::uint8_t r = 0, g = 0, b = 0;
+                for(int x = 0; x < batch_.cols; ++x, in += 4)
+                {
+                    *out++ = static_cast<Bytef>(in[2] - r);
+                    *out++ = static_cast<Bytef>(in[1] - g);
+                    *out++ = static_cast<Bytef>(in[0] - b);
+                    r = in[2];
+                    g = in[1];
+                    b = in[0];
+                }
+            }
+            strip.adler = adler32(adler32(0L, Z_NULL, 0), strip.raw.data(), static_cast<uInt>(strip.raw.size()));
+        }
+    }
+
+private:
+    const cv::Mat& batch_;
+    std::vector<Strip>& strips_;
+};
+
+// Compresses each strip as raw deflate blocks ending on a byte boundary (or the final block), so the strips can
+// be concatenated in a single zlib stream
+class CompressStrips : public cv::ParallelLoopBody
+{
+public:
+    CompressStrips(std::vector<Strip>& strips, const std::vector<Bytef>& dictionary, int compression, int finalStrip) :
+        strips_(strips), dictionary_(dictionary), compression_(compression), finalStrip_(finalStrip)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        for(int i = range.start; i < range.end; ++i)
+        {
+            Strip& strip = strips_[i];
+            // The decoder has the previous strip in its window: use it as dictionary
+            const std::vector<Bytef>& previous = (i == 0 ? dictionary_ : strips_[i - 1].raw);
+            size_t dictionarySize = std::min(previous.size(), DICTIONARY_SIZE);
+
+            z_stream stream = z_stream();
+            strip.ok = deflateInit2(&stream, compression_, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            if(!strip.ok)
+            {
+                continue;
+            }
+            if(dictionarySize > 0)
+            {
+                deflateSetDictionary(&stream, &previous[previous.size() - dictionarySize], static_cast<uInt>(dictionarySize));
+            }
+            // deflateBound doesn't count the flush marker
+            strip.compressed.resize(deflateBound(&stream, static_cast<uLong>(strip.raw.size())) + 16);
+            stream.next_in = strip.raw.data();
+            stream.avail_in = static_cast<uInt>(strip.raw.size());
+            stream.next_out = strip.compressed.data();
+            stream.avail_out = static_cast<uInt>(strip.compressed.size());
+            bool last = (i == finalStrip_);
+            int result = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            strip.ok = last ? result == Z_STREAM_END : (result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0);
+            strip.compressed.resize(stream.total_out);
+            deflateEnd(&stream);
+        }
+    }
+
+private:
+    std::vector<Strip>& strips_;
+    const std::vector<Bytef>& dictionary_;
+    int compression_;
+    // index of the last strip of the image in this batch, -1 if it isn't in it
+    int finalStrip_;
+};
+
+void putUInt32(std::vector<Bytef>& buffer, size_t position, std::uint32_t value)
+{
+    buffer[position] = static_cast<Bytef>(value >> 24);
+    buffer[position + 1] = static_cast<Bytef>(value >> 16);
+    buffer[position + 2] = static_cast<Bytef>(value >> 8);
+    buffer[position + 3] = static_cast<Bytef>(value);
+}
+
+void writeChunk(std::ofstream& file, const char* type, const std::vector<Bytef>& data)
+{
+    std::vector<Bytef> header(8);
+    putUInt32(header, 0, static_cast<std::uint32_t>(data.size()));
+    std::copy(type, type + 4, header.begin() + 4);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, &header[4], 4);
+    if(!data.empty())
+    {
+        // crc32() with a NULL buffer returns the initial value
+        crc = crc32(crc, data.data(), static_cast<uInt>(data.size()));
+    }
+    std::vector<Bytef> footer(4);
+    putUInt32(footer, 0, static_cast<std::uint32_t>(crc));
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+}
+}
+
+PngExporter::PngExporter(ProgressCallback progressCallback, FinishedCallback finishedCallback) :
+    progressCallback_(progressCallback),
+    finishedCallback_(finishedCallback),
+    cancel_(false),
+    exporting_(false)
+{
+}
+
+PngExporter::~PngExporter()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancel_ = true;
+    if(thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void PngExporter::start(const std::string& filename, const cv::Mat& image, const Overlay& overlay, double windowCenter,
+                        double windowWidth, int compression)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancel_ = true;
+    if(thread_.joinable())
+    {
+        thread_.join();
+    }
+    cancel_ = false;
+    exporting_ = true;
+    thread_ = std::thread(&PngExporter::run, this, filename, image, overlay, windowCenter, windowWidth, compression);
+}
+
+void PngExporter::cancel()
+{
+    cancel_ = true;
+}
+
+bool PngExporter::isExporting()
+{
+    return exporting_ && !cancel_;
+}
+
+void PngExporter::run(std::string filename, cv::Mat image, Overlay overlay, double windowCenter, double windowWidth, int compression)
+{
+    bool ok = write(filename, image, overlay, windowCenter, windowWidth, compression, [this](int percent)
+    {
+        if(cancel_)
+        {
+            return false;
+        }
+        progressCallback_(percent);
+        return true;
+    });
+    exporting_ = false;
+    if(!cancel_)
+    {
+        finishedCallback_(filename, ok);
+    }
+}
+
+bool PngExporter::write(const std::string& filename, const cv::Mat& image, const Overlay& overlay, double windowCenter,
+                        double windowWidth, int compression, std::function<bool(int percent)> progress)
+{
+    CV_Assert(image.type() == CV_16UC1 && !image.empty());
+    compression = std::min(std::max(compression, 0), 9);
+    std::ofstream file(filename.c_str(), std::ios::binary);
+    if(!file)
+    {
+        return false;
+    }
+    const char signature[] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+    file.write(signature, sizeof(signature));
+    // 8bit RGB, not interlaced
+    std::vector<Bytef> header(13, 0);
+    putUInt32(header, 0, image.cols);
+    putUInt32(header, 4, image.rows);
+    header[8] = 8;
+    header[9] = 2;
+    writeChunk(file, "IHDR", header);
+
+    Renderer renderer;
+    renderer.setWindow(windowCenter, windowWidth);
+    const int batchStrips = std::max(1, cv::getNumThreads());
+    const int batchRows = batchStrips * STRIP_ROWS;
+    cv::Mat batch;
+    std::vector<Strip> strips(batchStrips);
+    std::vector<Bytef> dictionary;
+    uLong adler = adler32(0L, Z_NULL, 0);
+    bool ok = true;
+    for(int y = 0; ok && y < image.rows; y += batchRows)
+    {
+        // 1:1 rendering: every pixel goes through the window's lookup table
+        int rows = std::min(batchRows, image.rows - y);
+        batch.create(rows, image.cols, CV_8UC4);
+        renderer.render(image, cv::Rect(0, y, image.cols, rows), batch);
+        overlay.rasterize(batch, cv::Point(0, -y));
+
+        int count = (rows + STRIP_ROWS - 1) / STRIP_ROWS;
+        bool lastBatch = (y + rows == image.rows);
+        cv::parallel_for_(cv::Range(0, count), FilterStrips(batch, strips));
+        cv::parallel_for_(cv::Range(0, count), CompressStrips(strips, dictionary, compression, lastBatch ? count - 1 : -1));
+        for(int i = 0; ok && i < count; ++i)
+        {
+            Strip& strip = strips[i];
+            ok = strip.ok;
+            adler = adler32_combine(adler, strip.adler, static_cast<z_off_t>(strip.raw.size()));
+            if(y == 0 && i == 0)
+            {
+                // zlib header: deflate, 32K window
+                const Bytef zlibHeader[] = {0x78, 0x9c};
+                strip.compressed.insert(strip.compressed.begin(), zlibHeader, zlibHeader + 2);
+            }
+            if(lastBatch && i == count - 1)
+            {
+                strip.compressed.resize(strip.compressed.size() + 4);
+                putUInt32(strip.compressed, strip.compressed.size() - 4, static_cast<std::uint32_t>(adler));
+            }
+            writeChunk(file, "IDAT", strip.compressed);
+        }
+        // The next batch starts with the window of the last strip
+        const std::vector<Bytef>& tail = strips[count - 1].raw;
+        dictionary.assign(tail.end() - std::min(tail.size(), DICTIONARY_SIZE), tail.end());
+
+        ok = ok && file.good() && (!progress || progress(static_cast<int>(100LL * (y + rows) / image.rows)));
+    }
+    if(ok)
+    {
+        writeChunk(file, "IEND", std::vector<Bytef>());
+    }
+    file.close();
+    ok = ok && !file.fail();
+    if(!ok)
+    {
+        std::remove(filename.c_str());
+    }
+    return ok;
+}
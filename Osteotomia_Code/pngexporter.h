@@ -0,0 +1,49 @@
+#ifndef PNGEXPORTER_H
+#define PNGEXPORTER_H
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "overlay.h"
+
+// Saves an image with its annotations as a PNG (8bit RGB) in a background thread. The image is rendered through
+// the window/level and encoded in strips of rows, so the memory used is a few strips whatever the size of the
+// image: the strips of a batch are filtered and compressed in parallel as independent deflate blocks of a single
+// zlib stream (each one primed with the end of the previous strip) and written in order.
+class PngExporter
+{
+public:
+    typedef std::function<void(int percent)> ProgressCallback;
+    // ok is false when the file cannot be written; cancelled exports are not notified
+    typedef std::function<void(const std::string& filename, bool ok)> FinishedCallback;
+
+    // The callbacks are called from the exporting thread
+    PngExporter(ProgressCallback progressCallback, FinishedCallback finishedCallback);
+    ~PngExporter();
+    // Export image (CV_16UC1, shared, not copied: it must not change), cancelling the current export.
+    // compression is the zlib level (0-9)
+    void start(const std::string& filename, const cv::Mat& image, const Overlay& overlay, double windowCenter,
+               double windowWidth, int compression);
+    void cancel();
+    bool isExporting();
+
+    // Export in the calling thread; false if the file cannot be written or progress returns false (the
+    // incomplete file is removed)
+    static bool write(const std::string& filename, const cv::Mat& image, const Overlay& overlay, double windowCenter,
+                      double windowWidth, int compression, std::function<bool(int percent)> progress);
+
+private:
+    void run(std::string filename, cv::Mat image, Overlay overlay, double windowCenter, double windowWidth, int compression);
+
+    ProgressCallback progressCallback_;
+    FinishedCallback finishedCallback_;
+    std::atomic<bool> cancel_;
+    std::atomic<bool> exporting_;
+    std::mutex mutex_;
+    std::thread thread_;
+};
+
+#endif // PNGEXPORTER_H
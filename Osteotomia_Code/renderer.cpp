@@ -0,0 +1,127 @@
+#include "renderer.h"
+#include "config.h"
+
+namespace
+{
+// Renders a block of frame rows
+class RenderRows : public cv::ParallelLoopBody
+{
+public:
+    RenderRows(const cv::Mat& source, cv::Mat& frame, const std::vector<int>& columns, const std::vector<int>& rows,
+               const cv::Range& inside, const std::uint8_t* lut) :
+        source_(source), frame_(frame), columns_(columns), rows_(rows), inside_(inside), lut_(lut)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        const int* columns = columns_.data();
+        const std::uint32_t black = 0xff000000u;
+        for(int y = range.start; y < range.end; ++y)
+        {
+            const int* row = &rows_[y * 3];
+            std::uint32_t* out = frame_.ptr<std::uint32_t>(y);
+            if(row[0] < 0)
+            {
+                std::fill(out, out + frame_.cols, black);
+                continue;
+            }
+            const std::uint16_t* top = source_.ptr<std::uint16_t>(row[0]);
+            const std::uint16_t* bottom = source_.ptr<std::uint16_t>(row[1]);
+            const std::uint32_t fy = static_cast<std::uint32_t>(row[2]);
+            std::fill(out, out + inside_.start, black);
+            std::fill(out + inside_.end, out + frame_.cols, black);
+            for(int x = inside_.start; x < inside_.end; ++x)
+            {
+                const int* column = &columns[x * 3];
+                const std::uint32_t fx = static_cast<std::uint32_t>(column[2]);
+                std::uint32_t upper = top[column[0]] * (256 - fx) + top[column[1]] * fx;
+                std::uint32_t lower = bottom[column[0]] * (256 - fx) + bottom[column[1]] * fx;
+                std::uint32_t gray = lut_[(upper * (256 - fy) + lower * fy) >> 16];
+                // 0xffRRGGBB
+                out[x] = 0xff000000u | (gray * 0x010101u);
+            }
+        }
+    }
+
+private:
+    const cv::Mat& source_;
+    cv::Mat& frame_;
+    const std::vector<int>& columns_;
+    const std::vector<int>& rows_;
+    const cv::Range inside_;
+    const std::uint8_t* lut_;
+};
+}
+
+Renderer::Renderer() :
+    lut_(65536),
+    center_(0),
+    width_(0)
+{
+    setWindow(WINDOW_DEFAULT_CENTER, WINDOW_DEFAULT_WIDTH);
+}
+
+void Renderer::setWindow(double center, double width)
+{
+    width = std::max(width, 2.0);
+    if(center == center_ && width == width_)
+    {
+        return;
+    }
+    center_ = center;
+    width_ = width;
+    // Linear VOI function of the DICOM standard (PS3.3 C.11.2.1.2)
+    double low = center - 0.5 - (width - 1) / 2;
+    double high = center - 0.5 + (width - 1) / 2;
+    for(int value = 0; value < 65536; ++value)
+    {
+        if(value <= low)
+        {
+            lut_[value] = 0;
+        }
+        else if(value > high)
+        {
+            lut_[value] = 255;
+        }
+        else
+        {
+            lut_[value] = cv::saturate_cast<std::uint8_t>(((value - (center - 0.5)) / (width - 1) + 0.5) * 255);
+        }
+    }
+}
+
+cv::Range Renderer::buildSamples(std::vector<int>& samples, int regionStart, int regionSize, int sourceSize, int frameSize)
+{
+    samples.resize(frameSize * 3);
+    cv::Range inside(frameSize, frameSize);
+    double ratio = static_cast<double>(regionSize) / frameSize;
+    for(int i = 0; i < frameSize; ++i)
+    {
+        double position = regionStart + (i + 0.5) * ratio - 0.5;
+        if(position < -0.5 || position >= sourceSize - 0.5)
+        {
+            samples[i * 3] = -1;
+            samples[i * 3 + 1] = -1;
+            samples[i * 3 + 2] = 0;
+            continue;
+        }
+        inside.start = std::min(inside.start, i);
+        inside.end = i + 1;
+        position = std::max(position, 0.0);
+        int first = std::min(static_cast<int>(position), sourceSize - 1);
+        samples[i * 3] = first;
+        samples[i * 3 + 1] = std::min(first + 1, sourceSize - 1);
+        samples[i * 3 + 2] = std::min(static_cast<int>((position - first) * 256), 256);
+    }
+    inside.start = std::min(inside.start, inside.end);
+    return inside;
+}
+
+void Renderer::render(const cv::Mat& source, const cv::Rect& region, cv::Mat& frame)
+{
+    CV_Assert(source.type() == CV_16UC1 && frame.type() == CV_8UC4);
+    cv::Range inside = buildSamples(columns_, region.x, region.width, source.cols, frame.cols);
+    buildSamples(rows_, region.y, region.height, source.rows, frame.rows);
+    cv::parallel_for_(cv::Range(0, frame.rows), RenderRows(source, frame, columns_, rows_, inside, lut_.data()));
+}
@@ -0,0 +1,35 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <cstdint>
+
+// Draws a 16bit image in a 32bit BGRA frame (QImage::Format_RGB32) in a single pass: every frame pixel is
+// sampled (bilinear) from the source, converted to 8bit with the window/level lookup table and written as a
+// gray BGR value.
+// The rows are rendered in parallel and the buffers are reused, so a frame doesn't allocate memory.
+// The region drawn can exceed the source: the pixels outside of it are black (letterboxing).
+class Renderer
+{
+public:
+    Renderer();
+    // Window/level in 16bit values: the table is rebuilt only when they change
+    void setWindow(double center, double width);
+    // Render region (in source pixels) of source (CV_16UC1, usually a pyramid level) stretched over the whole
+    // frame (CV_8UC4)
+    void render(const cv::Mat& source, const cv::Rect& region, cv::Mat& frame);
+
+private:
+    // For each frame column (or row): the two source pixels to interpolate and the weight of the second one
+    // (8bit fixed point), or -1 outside of the source. Returns the range of frame columns (or rows) inside it
+    static cv::Range buildSamples(std::vector<int>& samples, int regionStart, int regionSize, int sourceSize, int frameSize);
+
+    std::vector<int> columns_;
+    std::vector<int> rows_;
+    std::vector<std::uint8_t> lut_;
+    double center_;
+    double width_;
+};
+
+#endif // RENDERER_H
@@ -0,0 +1,75 @@
+#include "renderworker.h"
+
+RenderWorker::RenderWorker(ReadyCallback readyCallback) :
+    readyCallback_(readyCallback),
+    hasPending_(false),
+    hasReady_(false),
+    stop_(false)
+{
+    thread_ = std::thread(&RenderWorker::run, this);
+}
+
+RenderWorker::~RenderWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    thread_.join();
+}
+
+void RenderWorker::request(const View& view)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_ = view;
+    hasPending_ = true;
+    condition_.notify_all();
+}
+
+bool RenderWorker::swapFrame()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!hasReady_)
+    {
+        return false;
+    }
+    std::swap(ready_, front_);
+    hasReady_ = false;
+    return true;
+}
+
+const RenderWorker::Frame& RenderWorker::front() const
+{
+    return front_;
+}
+
+void RenderWorker::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true)
+    {
+        condition_.wait(lock, [this]() { return stop_ || hasPending_; });
+        if(stop_)
+        {
+            return;
+        }
+        View view = pending_;
+        pending_ = View();
+        hasPending_ = false;
+        lock.unlock();
+
+        // the back frame belongs to this thread: it is rendered without the lock
+        back_.image.create(view.size, CV_8UC4);
+        renderer_.setWindow(view.windowCenter, view.windowWidth);
+        renderer_.render(view.source, view.region, back_.image);
+        back_.view = view;
+
+        lock.lock();
+        std::swap(back_, ready_);
+        hasReady_ = true;
+        lock.unlock();
+        readyCallback_();
+        lock.lock();
+    }
+}
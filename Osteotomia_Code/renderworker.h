@@ -0,0 +1,68 @@
+#ifndef RENDERWORKER_H
+#define RENDERWORKER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "renderer.h"
+
+// Renders the frames in a background thread, so zooming and panning never block the UI thread. Only the latest
+// requested view is rendered: a request made while a frame is being rendered replaces the pending one, and the
+// intermediate views are dropped.
+// The frames are double buffered: the thread renders into the back frame while the UI shows the front one. A
+// finished frame waits as the ready frame until the UI takes it with swapFrame().
+class RenderWorker
+{
+public:
+    struct View
+    {
+        // CV_16UC1 image (or pyramid level) and its region drawn over the whole frame, in its pixels
+        cv::Mat source;
+        cv::Rect region;
+        cv::Size size;
+        // region of the canvas shown (the image letterboxed to the widget's aspect ratio), in image pixels
+        cv::Rect roi;
+        double windowCenter;
+        double windowWidth;
+        // A preview of the image being loaded: roi is not set
+        bool preview;
+    };
+
+    struct Frame
+    {
+        // CV_8UC4 (QImage::Format_RGB32)
+        cv::Mat image;
+        View view;
+    };
+
+    // Called from the render thread when a frame is ready
+    typedef std::function<void()> ReadyCallback;
+
+    RenderWorker(ReadyCallback readyCallback);
+    ~RenderWorker();
+    void request(const View& view);
+    // Make the ready frame the front frame; false if no frame has been finished since the last call.
+    // The thread doesn't touch the front frame until the next call
+    bool swapFrame();
+    const Frame& front() const;
+
+private:
+    void run();
+
+    ReadyCallback readyCallback_;
+    Renderer renderer_;
+    View pending_;
+    bool hasPending_;
+    Frame back_;
+    Frame ready_;
+    bool hasReady_;
+    Frame front_;
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread thread_;
+};
+
+#endif // RENDERWORKER_H
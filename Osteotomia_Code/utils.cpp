@@ -100,3 +100,15 @@ void Utils::print(cv::Rect& roi)
 {
     std::cout << "x=" << roi.x << "y=" << roi.y << "w=" << roi.width << "h=" << roi.height << std::endl;
 }
+
+std::wstring Utils::siblingFile(const std::wstring& path, const QStringList& nameFilters, int step)
+{
+    QFileInfo fileInfo(QString::fromStdWString(path));
+    QStringList files = fileInfo.dir().entryList(nameFilters, QDir::Files, QDir::Name);
+    int idx = files.indexOf(fileInfo.fileName());
+    if(idx == -1 || idx + step < 0 || idx + step >= files.size())
+    {
+        return std::wstring();
+    }
+    return fileInfo.dir().absoluteFilePath(files.at(idx + step)).toStdWString();
+}
@@ -2,6 +2,9 @@
 #define UTILS_H
 
 #include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -24,6 +27,8 @@ public:
     static cv::Point rotatePoint(const cv::Point& inPoint, const cv::Point& center, const double& angRad);
     static cv::Vec2i rotate2d(const cv::Vec2i& inPoint, const double& angRad);
     static cv::Vec2i rotatePoint(const cv::Vec2i& inPoint, const cv::Vec2i& center, const double& angRad);
+    // File at the given distance (+1 next, -1 previous) from path in its folder, by name; empty if there isn't one
+    static std::wstring siblingFile(const std::wstring& path, const QStringList& nameFilters, int step);
 };
 
 #endif // UTILS_H
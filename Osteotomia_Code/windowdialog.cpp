@@ -70,18 +70,21 @@ WindowDialog::WindowDialog(QMainWindow *parent, QSettings& settings) :
     QGroupBox *groupBoxD = new QGroupBox(tr("Phase 4 - Reduce details"));
     QGroupBox *groupBoxE = new QGroupBox(tr("Phase 5 - Segmentation"));
     QGroupBox *groupBoxF = new QGroupBox(tr("Phase 6 - Bone detection"));
+    QGroupBox *groupBoxG = new QGroupBox(tr("Export"));
     QVBoxLayout *vboxA = new QVBoxLayout;
     QVBoxLayout *vboxB = new QVBoxLayout;
     QVBoxLayout *vboxC = new QVBoxLayout;
     QVBoxLayout *vboxD = new QVBoxLayout;
     QVBoxLayout *vboxE = new QVBoxLayout;
     QVBoxLayout *vboxF = new QVBoxLayout;
+    QVBoxLayout *vboxG = new QVBoxLayout;
     groupBoxA->setLayout(vboxA);
     groupBoxB->setLayout(vboxB);
     groupBoxC->setLayout(vboxC);
     groupBoxD->setLayout(vboxD);
     groupBoxE->setLayout(vboxE);
     groupBoxF->setLayout(vboxF);
+    groupBoxG->setLayout(vboxG);
     QVBoxLayout *vboxL = new QVBoxLayout;
     QVBoxLayout *vboxR = new QVBoxLayout;
     vboxL->addWidget(groupBoxA);
@@ -90,6 +93,7 @@ WindowDialog::WindowDialog(QMainWindow *parent, QSettings& settings) :
     vboxL->addWidget(groupBoxD);
     vboxR->addWidget(groupBoxE);
     vboxR->addWidget(groupBoxF);
+    vboxR->addWidget(groupBoxG);
     QHBoxLayout *hbox = new QHBoxLayout;
     hbox->addLayout(vboxL);
     hbox->addLayout(vboxR);
@@ -111,6 +115,10 @@ WindowDialog::WindowDialog(QMainWindow *parent, QSettings& settings) :
     addLabelSpinBox("Automatic maximum size. Enter a value between %1 and %2. Default is %3.",    0, 9999, SET_AUTO_MAX_LINEAR,             1, settings, "autoMaxLinear",          vboxF, vecA);
     addLabelSpinBox("Automatic size step. Enter a value between %1 and %2. Default is %3.",       0, 9999, SET_AUTO_LINEAR_STEP,            1, settings, "autoLinearStep",         vboxF, vecA);
     addLabelSpinBox("Automatic linear size. Enter a value between %1 and %2. Default is %3.",     0, 9999, SET_AUTO_LINEAR_SIZE,            1, settings, "autoLinearSize",         vboxF, vecA);
+    addLabelSpinBox("Loading preview scale (1 for none). Enter a value between %1 and %2. Default is %3.", 1, 32, SET_LOAD_PREVIEW_SCALE, 1, settings, "loadPreviewScale", vboxG, vecA);
+    addLabelSpinBox("PNG compression. Enter a value between %1 and %2. Default is %3.",           0,    9, SET_PNG_COMPRESSION,             1, settings, "pngCompression",         vboxG, vecA);
+    addLabelSpinBox("DICOM preview size (0 for none). Enter a value between %1 and %2. Default is %3.", 0, 4096, SET_DICOM_PREVIEW_SIZE, 64, settings, "dicomPreviewSize", vboxG, vecA);
+    addLabelSpinBox("Memory kept for reuse in MB. Enter a value between %1 and %2. Default is %3.", 0, 4095, SET_MEMORY_POOL_SIZE, 64, settings, "memoryPoolSize", vboxG, vecA);
 
     QPushButton *button = new QPushButton("&Reset All");
     vboxL->addWidget(button);